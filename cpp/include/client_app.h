@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/thread_util.h"
 #include "quickfix/Application.h"
 #include "quickfix/Message.h"
 #include "quickfix/Session.h"
@@ -43,6 +44,12 @@ class Application : public FIX::Application, public FIX42::MessageCracker {
         });
   }
 
+  // Placement for QuickFIX's socket thread, applied on its first callback.
+  auto SetIoThreadPlacement(const common::ThreadPlacement& placement)
+      -> void {
+    io_placement_ = placement;
+  }
+
   auto onCreate(const FIX::SessionID& session_id) -> void override {
     spdlog::info("session created: {}", session_id.toString());
   }
@@ -67,6 +74,7 @@ class Application : public FIX::Application, public FIX42::MessageCracker {
   auto fromAdmin(const FIX::Message& message, const FIX::SessionID&)
       EXCEPT(FIX::FieldNotFound, FIX::IncorrectDataFormat,
              FIX::IncorrectTagValue, FIX::RejectLogon) -> void override {
+    common::ThreadUtil::PlaceOnce(io_placement_, "io");
     spdlog::info("fromAdmin: {}", message.toString());
   }
 
@@ -74,6 +82,7 @@ class Application : public FIX::Application, public FIX42::MessageCracker {
       EXCEPT(FIX::FieldNotFound, FIX::IncorrectDataFormat,
              FIX::IncorrectTagValue, FIX::UnsupportedMessageType)
           -> void override {
+    common::ThreadUtil::PlaceOnce(io_placement_, "io");
     crack(message, sessionID);
   }
 
@@ -142,6 +151,7 @@ class Application : public FIX::Application, public FIX42::MessageCracker {
 
  private:
   EventQueuePtr queue_;
+  common::ThreadPlacement io_placement_;
 };
 
 }  // namespace fixclient
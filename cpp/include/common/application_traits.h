@@ -8,6 +8,10 @@
 #include <mutex>
 #include <string>
 
+#include "common/pool_allocator.h"
+#include "common/pooled_frame.h"
+#include "common/priority_queue_list.h"
+#include "common/queue_metrics.h"
 #include "common/time_util.h"
 #include "eventpp/eventqueue.h"
 #include "quickfix/FileLog.h"
@@ -21,11 +25,53 @@
 
 namespace common {
 
+// Lane 0: cancels and session-level messages, lane 1: cancel/replace,
+// lane 2: new orders and everything else.
+struct MsgTypePriority {
+  static constexpr std::size_t kLaneCount = 3;
+  static constexpr std::size_t kStarvationLimit = 64;
+
+  template <typename QueuedEvent>
+  auto operator()(const QueuedEvent& queued) const -> std::size_t {
+    const auto& msg_type = queued.event;
+    if (msg_type == FIX::MsgType_OrderCancelRequest ||
+        FIX::Message::isAdminMsgType(msg_type)) {
+      return 0;
+    }
+    if (msg_type == FIX::MsgType_OrderCancelReplaceRequest) {
+      return 1;
+    }
+    return 2;
+  }
+};
+
+struct EventQueuePolicies {
+  using Mixins = eventpp::MixinList<QueueMetrics>;
+
+  template <typename Item>
+  using QueueList =
+      PriorityQueueList<Item, MsgTypePriority, MsgTypePriority::kLaneCount,
+                        MsgTypePriority::kStarvationLimit, PoolAllocator<Item>>;
+};
+
 struct CommonTraits {
   using EventQueue =
       eventpp::EventQueue<FIX::MsgType,
-                          void(const FIX::Message&, const FIX::SessionID&)>;
+                          void(const FIX::Message&, const FIX::SessionID&),
+                          EventQueuePolicies>;
   using EventQueuePtr = std::shared_ptr<EventQueue>;
+
+  // Size of the pre-faulted hugepage arena backing event queue nodes; 0 or
+  // unset leaves them on the heap. Book worker rings stay on the heap either
+  // way, see PoolAllocator.
+  static constexpr auto kHugePageArenaMB = "HugePageArenaMB";
+
+  static auto ReserveArena(const FIX::Dictionary& settings) -> void {
+    if (settings.has(kHugePageArenaMB)) {
+      HugePageArena::Global().Reserve(
+          static_cast<std::size_t>(settings.getInt(kHugePageArenaMB)) << 20U);
+    }
+  }
 };
 
 struct ClientTraits : public CommonTraits {
@@ -37,7 +83,40 @@ struct ClientTraits : public CommonTraits {
 };
 
 struct ServerTraits : public CommonTraits {
+  // Orders travel from the I/O thread as the bytes they arrived in, see
+  // common::PooledFrame, rather than as FIX::Message copies.
+  using EventQueue =
+      eventpp::EventQueue<FIX::MsgType,
+                          void(PooledFrame&, const FIX::SessionID&),
+                          EventQueuePolicies>;
+  using EventQueuePtr = std::shared_ptr<EventQueue>;
+
   static constexpr auto kQueueWait = std::chrono::milliseconds(100);
+  static constexpr std::size_t kBookShards = 4;
+  static constexpr std::size_t kBookRingSize = 4096;
+
+  // Warm-up before accepting logons, overridable with WarmupQueueDepth and
+  // WarmupMessages in [DEFAULT].
+  static constexpr auto kWarmupQueueDepthKey = "WarmupQueueDepth";
+  static constexpr auto kWarmupMessagesKey = "WarmupMessages";
+  static constexpr std::size_t kWarmupQueueDepth = 1024;
+  static constexpr std::size_t kWarmupMessages = 256;
+  // Past this the warm-up responses are given up on and logons accepted.
+  static constexpr auto kWarmupTimeout = std::chrono::seconds(5);
+
+  // Comma-separated symbols the book accepts; unset accepts any symbol.
+  static constexpr auto kSymbolsKey = "Symbols";
+
+  // A warning is logged, at most once per kMonitorInterval, while the
+  // event queue holds more than QueueAlarmDepth events or its oldest has
+  // waited longer than QueueAlarmWaitMicros; unset checks neither.
+  static constexpr auto kQueueAlarmDepthKey = "QueueAlarmDepth";
+  static constexpr auto kQueueAlarmWaitMicrosKey = "QueueAlarmWaitMicros";
+  static constexpr auto kMonitorInterval = std::chrono::seconds(1);
+
+  // File, normally under /dev/shm, that counters and histograms are
+  // published to every kMonitorInterval for fix_stat; unset publishes none.
+  static constexpr auto kMetricsPathKey = "MetricsPath";
 
   static auto GetSessionID() -> FIX::SessionID {
     return FIX::SessionID("FIX.4.2", "FIXSERVER", "FIXCLIENT");
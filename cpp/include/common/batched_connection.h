@@ -0,0 +1,313 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/time_util.h"
+#include "common/transport_config.h"
+#include "quickfix/Responder.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+class BatchedConnection;
+
+// Holds back writes made through BatchedConnection on the calling thread
+// until Flush(), so everything one pass of work sends to a connection goes
+// out in a single write. A connection is written early once it holds
+// max_messages, and the whole batch once its oldest message has waited
+// max_delay_nanos. Threads that never call Enable() write every message as
+// it is sent.
+//
+// A connection is held by the thread that queues onto it while its queue is
+// empty; sends from other threads join the queue and leave the write to
+// that thread's flush (or, if the socket is full, to the loop seeing it
+// writable).
+class OutboundBatch {
+ public:
+  static auto Enable(std::size_t max_messages, std::uint64_t max_delay_nanos)
+      -> void {
+    auto& state = Local();
+    state.enabled = max_messages > 1;
+    state.max_messages = max_messages;
+    state.max_delay_nanos = max_delay_nanos;
+  }
+
+  // Writes every connection this thread has held back since the last flush.
+  static auto Flush() -> void;
+
+  // Flush(), once the oldest held-back message has waited max_delay_nanos.
+  // Loops call it between messages, so a long pass still keeps the delay.
+  static auto FlushDue() -> void {
+    auto& state = Local();
+    if (!state.held.empty() &&
+        TimeUtil::CyclesToNanos(TimeUtil::Cycles() - state.first_held) >=
+            state.max_delay_nanos) {
+      Flush();
+    }
+  }
+
+ private:
+  friend class BatchedConnection;
+
+  struct State {
+    bool enabled{false};
+    std::size_t max_messages{1};
+    std::uint64_t max_delay_nanos{0};
+    std::uint64_t first_held{0};  // TimeUtil::Cycles()
+    std::vector<std::shared_ptr<BatchedConnection>> held;
+  };
+
+  static auto Local() -> State& {
+    thread_local State state;
+    return state;
+  }
+
+  // first: the connection's queue was empty, so no thread holds it yet.
+  static auto Hold(BatchedConnection& connection, bool first) -> void;
+};
+
+// The FIX::Responder a session sends through on the epoll and io_uring
+// transports: a connected, non-blocking socket with an output queue written
+// by one sendmsg (writev without SIGPIPE) per flush. Whatever the socket
+// does not take stays queued until the event loop sees it writable and
+// calls Flush(); loops that do not watch for that all the time ask to be
+// told with OnBlocked().
+//
+// The event loop owns the descriptor: disconnect(), called by the session,
+// only shuts the socket down, and the loop calls Close() once it sees the
+// hangup. Sends after that are dropped. A peer that stops reading is
+// disconnected the same way once more than max_queued_bytes are waiting
+// for it; the session resends from its store when it logs on again.
+class BatchedConnection
+    : public FIX::Responder,
+      public std::enable_shared_from_this<BatchedConnection> {
+ private:
+  static constexpr std::size_t kMaxIov = 64;
+
+ public:
+  explicit BatchedConnection(
+      int fd,
+      std::size_t max_queued_bytes = TransportConfig::kDefaultSendQueueBytes)
+      : fd_(fd), max_queued_bytes_(max_queued_bytes) {}
+
+  ~BatchedConnection() override { Close(); }
+
+  BatchedConnection(const BatchedConnection&) = delete;
+  auto operator=(const BatchedConnection&) -> BatchedConnection& = delete;
+
+  auto Fd() const -> int { return fd_; }
+
+  // Called, from whichever thread was writing, when the socket stops taking
+  // the queue. Set before the connection is shared.
+  auto OnBlocked(std::function<void()> blocked) -> void {
+    blocked_ = std::move(blocked);
+  }
+
+  auto send(const std::string& message) -> bool override {
+    return Queue(message);
+  }
+
+  // send(), taking message's bytes: it is swapped with a spare string from
+  // the queue rather than copied.
+  auto Send(std::string& message) -> bool { return Queue(message); }
+
+  auto disconnect() -> void override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!closed_) {
+      ::shutdown(fd_, SHUT_RDWR);
+    }
+  }
+
+  // Writes as much of the queue as the socket takes.
+  auto Flush() -> void {
+    auto blocked{false};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blocked = Write();
+    }
+    if (blocked) {
+      blocked_();
+    }
+  }
+
+  auto Close() -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!closed_) {
+      closed_ = true;
+      ::close(fd_);
+    }
+  }
+
+  auto WriteCount() const -> std::size_t {
+    return write_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Queues message, then writes the queue or holds it back for the batch.
+  template <typename Message>
+  auto Queue(Message& message) -> bool {
+    auto hold{false};
+    auto first{false};
+    auto blocked{false};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closed_ || overflowed_) {
+        return false;
+      }
+      first = head_ == tail_;
+      Append(message);
+      if (queued_bytes_ > max_queued_bytes_) {
+        Overflow();
+        return false;
+      }
+
+      const auto& batch = OutboundBatch::Local();
+      hold = batch.enabled && tail_ - head_ < batch.max_messages;
+      if (!hold) {
+        blocked = Write();
+      }
+    }
+    if (hold) {
+      OutboundBatch::Hold(*this, first);
+    }
+    if (blocked) {
+      blocked_();
+    }
+    return true;
+  }
+
+  // Queued strings are reused, so a steady state allocates nothing.
+  auto Append(const std::string& message) -> void {
+    Slot().assign(message);
+    queued_bytes_ += message.size();
+  }
+
+  auto Append(std::string& message) -> void {
+    queued_bytes_ += message.size();
+    Slot().swap(message);
+  }
+
+  // The loop sees the hangup and tears the session down.
+  auto Overflow() -> void {
+    spdlog::warn("connection {}: {} bytes queued for a peer not reading, "
+                 "over the limit of {}, disconnecting",
+                 fd_, queued_bytes_, max_queued_bytes_);
+    overflowed_ = true;
+    ::shutdown(fd_, SHUT_RDWR);
+    head_ = tail_ = offset_ = queued_bytes_ = 0;
+  }
+
+  auto Slot() -> std::string& {
+    if (tail_ == queue_.size()) {
+      if (head_ > 0) {
+        std::rotate(queue_.begin(), queue_.begin() + head_, queue_.end());
+        tail_ -= head_;
+        head_ = 0;
+      } else {
+        queue_.emplace_back();
+      }
+    }
+    return queue_[tail_++];
+  }
+
+  // Returns whether the socket was full and OnBlocked() wants to know.
+  auto Write() -> bool {
+    auto blocked{false};
+    while (!closed_ && head_ < tail_) {
+      std::array<iovec, kMaxIov> iov{};
+      std::size_t count{0};
+      for (auto index = head_; index < tail_ && count < kMaxIov; ++index) {
+        auto& message = queue_[index];
+        auto skip = index == head_ ? offset_ : 0;
+        iov[count++] = {message.data() + skip, message.size() - skip};
+      }
+
+      msghdr header{};
+      header.msg_iov = iov.data();
+      header.msg_iovlen = count;
+      auto written = ::sendmsg(fd_, &header, MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          blocked = static_cast<bool>(blocked_);
+        } else {
+          // The loop sees the hangup and tears the session down.
+          ::shutdown(fd_, SHUT_RDWR);
+          head_ = tail_;
+        }
+        break;
+      }
+      write_count_.fetch_add(1, std::memory_order_relaxed);
+      Advance(static_cast<std::size_t>(written));
+    }
+
+    if (head_ == tail_) {
+      head_ = tail_ = offset_ = queued_bytes_ = 0;
+    }
+    return blocked;
+  }
+
+  auto Advance(std::size_t written) -> void {
+    queued_bytes_ -= written;
+    while (written > 0) {
+      auto left = queue_[head_].size() - offset_;
+      if (written < left) {
+        offset_ += written;
+        return;
+      }
+      written -= left;
+      offset_ = 0;
+      ++head_;
+    }
+  }
+
+  int fd_;
+  std::size_t max_queued_bytes_;
+  std::function<void()> blocked_;
+  std::mutex mutex_;
+  bool closed_{false};
+  bool overflowed_{false};
+  std::vector<std::string> queue_;
+  std::size_t head_{0};
+  std::size_t tail_{0};
+  std::size_t offset_{0};  // bytes of queue_[head_] already written
+  std::size_t queued_bytes_{0};
+  std::atomic<std::size_t> write_count_{0};
+};
+
+inline auto OutboundBatch::Flush() -> void {
+  auto& state = Local();
+  for (auto& connection : state.held) {
+    connection->Flush();
+  }
+  state.held.clear();
+}
+
+inline auto OutboundBatch::Hold(BatchedConnection& connection, bool first)
+    -> void {
+  auto& state = Local();
+  if (first) {
+    if (state.held.empty()) {
+      state.first_held = TimeUtil::Cycles();
+    }
+    state.held.push_back(connection.shared_from_this());
+  }
+  FlushDue();
+}
+
+}  // namespace common
@@ -0,0 +1,765 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <charconv>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "quickfix/DataDictionary.h"
+#include "quickfix/FieldTypes.h"
+#include "quickfix/Message.h"
+#include "quickfix/SessionSettings.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// The session-level reject reasons DataDictionary::validate can raise.
+enum class ValidationError : std::uint8_t {
+  kNone,
+  kInvalidMsgType,
+  kRequiredTagMissing,
+  kInvalidTagNumber,
+  kTagNotDefinedForMessage,
+  kTagSpecifiedWithoutValue,
+  kIncorrectTagValue,
+  kIncorrectDataFormat,
+  kTagOutOfOrder,
+  kRepeatedTag,
+  kRepeatingGroupCountMismatch,
+};
+
+struct ValidationResult {
+  ValidationError error{ValidationError::kNone};
+  int tag{0};
+
+  explicit operator bool() const { return error == ValidationError::kNone; }
+
+  // Raises the exception QuickFIX's own validation would have, so Session
+  // answers with the same Reject.
+  auto Throw() const -> void {
+    switch (error) {
+      case ValidationError::kNone:
+        return;
+      case ValidationError::kInvalidMsgType:
+        throw FIX::InvalidMessageType();
+      case ValidationError::kRequiredTagMissing:
+        throw FIX::RequiredTagMissing(tag);
+      case ValidationError::kInvalidTagNumber:
+        throw FIX::InvalidTagNumber(tag);
+      case ValidationError::kTagNotDefinedForMessage:
+        throw FIX::TagNotDefinedForMessage(tag);
+      case ValidationError::kTagSpecifiedWithoutValue:
+        throw FIX::NoTagValue(tag);
+      case ValidationError::kIncorrectTagValue:
+        throw FIX::IncorrectTagValue(tag);
+      case ValidationError::kIncorrectDataFormat:
+        throw FIX::IncorrectDataFormat(tag);
+      case ValidationError::kTagOutOfOrder:
+        throw FIX::TagOutOfOrder(tag);
+      case ValidationError::kRepeatedTag:
+        throw FIX::RepeatedTag(tag);
+      case ValidationError::kRepeatingGroupCountMismatch:
+        throw FIX::RepeatingGroupCountMismatch(tag);
+    }
+  }
+};
+
+// Per-session switches, read from the same settings QuickFIX uses, plus
+// ValidateRequiredOnly: message types for which only required-field presence
+// is checked.
+struct ValidationOptions {
+  bool check_fields_out_of_order{true};
+  bool check_fields_have_values{true};
+  bool check_user_defined_fields{true};
+  bool allow_unknown_message_fields{false};
+  std::vector<bool> required_only;  // by CompiledDictionary message index
+};
+
+// A FIX::DataDictionary flattened into dense tables: field attributes indexed
+// by tag, message types indexed by their one or two characters, and per
+// message type a table of what each tag is to it (allowed, required, a
+// repeating group's counter or delimiter). Validate() checks a flat-parsed
+// message in one pass over its fields, without touching the dictionary's
+// maps. Enumerated values are checked from a bitset for char and boolean
+// fields; the rarer multi-character enumerations still ask the dictionary.
+//
+// The checks are DataDictionary::validate's, with these differences, all
+// down to the message arriving without its groups parsed:
+//  - a tag may repeat when it belongs to one of the message's groups;
+//  - NumInGroup is checked against the number of times the group's
+//    delimiter appears, summed over a nested group's instances, and groups
+//    starting with the same delimiter are counted together;
+//  - required fields inside group instances are not checked;
+//  - the header and trailer fields required are the standard ones the
+//    dictionary defines (the dictionary does not expose its own list);
+//  - with several faults, the one reported may differ.
+//
+// The dictionary only exposes point queries, so the tables are built by
+// probing every tag and every one- and two-character message type once at
+// startup.
+class CompiledDictionary {
+ private:
+  static constexpr int kMaxTag = 39999;
+  static constexpr int kMsgTypeTag = 35;
+  static constexpr int kUserMin = 5000;
+  static constexpr std::size_t kMsgTypeSlots = 128 + 128 * 128;
+  static constexpr std::size_t kMaxRequired = 64;
+  static constexpr std::size_t kMaxGroups = 32;
+  static constexpr std::uint8_t kNoSlot = 0xff;
+  // Required in the header and trailer of every FIX 4.x message.
+  static constexpr std::array<int, 8> kEnvelopeRequired{8,  9,  35, 49,
+                                                        56, 34, 52, 10};
+  static constexpr auto kMsgTypeChars =
+      "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+  // The value formats DataDictionary::checkValidFormat converts; everything
+  // else is accepted as a string.
+  enum class Format : std::uint8_t {
+    kString,
+    kChar,
+    kInt,
+    kFloat,
+    kBoolean,
+    kUtcTimeStamp,
+    kUtcTimeOnly,
+    kUtcDate,
+    kCheckSum,
+  };
+
+  static constexpr std::uint16_t kNoValues = 0xffff;
+
+  struct Field {
+    bool defined{false};
+    bool header{false};
+    bool trailer{false};
+    bool enumerated{false};
+    Format format{Format::kString};
+    std::uint16_t values{kNoValues};  // index into char_values_
+    std::uint8_t envelope{kNoSlot};   // index into envelope_required_
+  };
+
+  // What a tag is to one message type. Group slots are shared by every
+  // counter whose group starts with the same delimiter, since a flat-parsed
+  // message cannot tell those groups' members apart.
+  struct TagRole {
+    bool allowed{false};
+    bool in_group{false};
+    std::uint8_t required{kNoSlot};   // bit in the required mask
+    std::uint8_t counter{kNoSlot};    // group slot this NumInGroup counts
+    std::uint8_t delimiter{kNoSlot};  // group slot this tag starts
+  };
+
+  struct Group {
+    int counter;
+    int delimiter;
+  };
+
+  struct MessageType {
+    std::string name;
+    std::vector<TagRole> roles;  // by tag, up to the highest defined
+    std::vector<int> required;   // at most kMaxRequired
+    std::vector<Group> groups;   // at most kMaxGroups
+
+    auto Role(int tag) const -> const TagRole* {
+      return tag > 0 && tag < static_cast<int>(roles.size()) ? &roles[tag]
+                                                             : nullptr;
+    }
+  };
+
+ public:
+  static constexpr auto kValidateRequiredOnly = "ValidateRequiredOnly";
+
+  explicit CompiledDictionary(std::shared_ptr<const FIX::DataDictionary> source)
+      : source_(std::move(source)) {
+    msg_types_.fill(-1);
+    CompileFields();
+    CompileEnvelope();
+    CompileMessageTypes();
+    spdlog::info("compiled dictionary: {} fields up to tag {}, {} msg types",
+                 defined_fields_, fields_.size() - 1, messages_.size());
+  }
+
+  static auto Load(const std::string& path)
+      -> std::shared_ptr<const CompiledDictionary> {
+    return std::make_shared<const CompiledDictionary>(
+        std::make_shared<const FIX::DataDictionary>(path));
+  }
+
+  // Index of msg_type in this dictionary, or -1.
+  auto MessageIndex(std::string_view msg_type) const -> int {
+    auto slot = MsgTypeSlot(msg_type);
+    return slot < kMsgTypeSlots ? msg_types_[slot] : -1;
+  }
+
+  auto MakeOptions(const FIX::Dictionary& settings) const -> ValidationOptions {
+    ValidationOptions options;
+    options.check_fields_out_of_order =
+        GetBool(settings, "ValidateFieldsOutOfOrder", true);
+    options.check_fields_have_values =
+        GetBool(settings, "ValidateFieldsHaveValues", true);
+    options.check_user_defined_fields =
+        GetBool(settings, "ValidateUserDefinedFields", true);
+    options.allow_unknown_message_fields =
+        GetBool(settings, "AllowUnknownMsgFields", false);
+    options.required_only.assign(messages_.size(), false);
+
+    if (settings.has(kValidateRequiredOnly)) {
+      std::stringstream msg_types(settings.getString(kValidateRequiredOnly));
+      std::string msg_type;
+      while (std::getline(msg_types, msg_type, ',')) {
+        auto index = MessageIndex(msg_type);
+        if (index < 0) {
+          throw FIX::ConfigError(std::string(kValidateRequiredOnly) +
+                                 ": unknown message type " + msg_type);
+        }
+        options.required_only[index] = true;
+      }
+    }
+    return options;
+  }
+
+  auto Validate(const FIX::Message& message,
+                const ValidationOptions& options) const -> ValidationResult {
+    int out_of_order{0};
+    if (options.check_fields_out_of_order &&
+        !message.hasValidStructure(out_of_order)) {
+      return {ValidationError::kTagOutOfOrder, out_of_order};
+    }
+
+    int index{-1};
+    for (const auto& field : message.getHeader()) {
+      if (field.getTag() == kMsgTypeTag) {
+        index = MessageIndex(field.getString());
+        break;
+      }
+    }
+    if (index < 0) {
+      return {ValidationError::kInvalidMsgType, kMsgTypeTag};
+    }
+
+    const auto& type = messages_[index];
+    auto required_only = options.required_only[index];
+
+    std::uint32_t envelope{0};
+    if (auto result = CheckEnvelope(message.getHeader(), required_only,
+                                    options, envelope);
+        !result) {
+      return result;
+    }
+    if (auto result = CheckEnvelope(message.getTrailer(), required_only,
+                                    options, envelope);
+        !result) {
+      return result;
+    }
+
+    // Fields are ordered by tag, so a repeated tag is a run.
+    std::uint64_t seen{0};
+    std::array<std::int64_t, kMaxGroups> unmatched{};
+    int last{0};
+    for (const auto& field : message) {
+      auto tag = field.getTag();
+      const auto* role = type.Role(tag);
+      if (!required_only) {
+        if (tag == last && (role == nullptr || !role->in_group)) {
+          return {ValidationError::kRepeatedTag, tag};
+        }
+        if (auto result = CheckField(field, &type, options); !result) {
+          return result;
+        }
+        if (role != nullptr && role->counter != kNoSlot) {
+          const auto& value = field.getString();
+          int count{0};
+          const auto* value_end = value.data() + value.size();
+          if (std::from_chars(value.data(), value_end, count).ptr !=
+              value_end) {
+            return {ValidationError::kIncorrectDataFormat, tag};
+          }
+          unmatched[role->counter] += count;
+        }
+        if (role != nullptr && role->delimiter != kNoSlot) {
+          --unmatched[role->delimiter];
+        }
+      }
+      if (role != nullptr && role->required != kNoSlot) {
+        seen |= std::uint64_t{1} << role->required;
+      }
+      last = tag;
+    }
+
+    for (std::size_t slot = 0; slot < type.groups.size(); ++slot) {
+      if (unmatched[slot] != 0) {
+        return {ValidationError::kRepeatingGroupCountMismatch,
+                type.groups[slot].counter};
+      }
+    }
+
+    auto all_envelope = (std::uint32_t{1} << envelope_required_.size()) - 1;
+    if (envelope != all_envelope) {
+      for (std::size_t slot = 0; slot < envelope_required_.size(); ++slot) {
+        if ((envelope & (std::uint32_t{1} << slot)) == 0) {
+          return {ValidationError::kRequiredTagMissing,
+                  envelope_required_[slot]};
+        }
+      }
+    }
+
+    auto expected = type.required.size() == kMaxRequired
+                        ? ~std::uint64_t{0}
+                        : (std::uint64_t{1} << type.required.size()) - 1;
+    if (seen != expected) {
+      for (std::size_t slot = 0; slot < type.required.size(); ++slot) {
+        if ((seen & (std::uint64_t{1} << slot)) == 0) {
+          return {ValidationError::kRequiredTagMissing, type.required[slot]};
+        }
+      }
+    }
+    return {};
+  }
+
+ private:
+  static auto MsgTypeSlot(std::string_view msg_type) -> std::size_t {
+    auto valid = [](char c) { return c > 0; };
+    if (msg_type.size() == 1 && valid(msg_type[0])) {
+      return static_cast<std::size_t>(msg_type[0]);
+    }
+    if (msg_type.size() == 2 && valid(msg_type[0]) && valid(msg_type[1])) {
+      return 128 + static_cast<std::size_t>(msg_type[0]) * 128 +
+             static_cast<std::size_t>(msg_type[1]);
+    }
+    return kMsgTypeSlots;
+  }
+
+  static auto GetBool(const FIX::Dictionary& settings, const std::string& key,
+                      bool fallback) -> bool {
+    return settings.has(key) ? settings.getBool(key) : fallback;
+  }
+
+  static auto ToFormat(FIX::TYPE::Type type) -> Format {
+    switch (type) {
+      case FIX::TYPE::Char:
+        return Format::kChar;
+      case FIX::TYPE::Int:
+      case FIX::TYPE::DayOfMonth:
+      case FIX::TYPE::NumInGroup:
+      case FIX::TYPE::SeqNum:
+      case FIX::TYPE::Length:
+        return Format::kInt;
+      case FIX::TYPE::Price:
+      case FIX::TYPE::Amt:
+      case FIX::TYPE::Qty:
+      case FIX::TYPE::Float:
+      case FIX::TYPE::PriceOffset:
+      case FIX::TYPE::Percentage:
+        return Format::kFloat;
+      case FIX::TYPE::Boolean:
+        return Format::kBoolean;
+      case FIX::TYPE::UtcTimeStamp:
+        return Format::kUtcTimeStamp;
+      case FIX::TYPE::UtcTimeOnly:
+        return Format::kUtcTimeOnly;
+      case FIX::TYPE::UtcDate:
+      case FIX::TYPE::UtcDateOnly:
+        return Format::kUtcDate;
+      case FIX::TYPE::CheckSum:
+        return Format::kCheckSum;
+      default:
+        return Format::kString;
+    }
+  }
+
+  auto CompileFields() -> void {
+    int max_tag{0};
+    for (int tag = 1; tag <= kMaxTag; ++tag) {
+      if (source_->isField(tag)) {
+        max_tag = tag;
+      }
+    }
+
+    fields_.resize(max_tag + 1);
+    for (int tag = 1; tag <= max_tag; ++tag) {
+      if (!source_->isField(tag)) {
+        continue;
+      }
+
+      auto& field = fields_[tag];
+      field.defined = true;
+      field.header = source_->isHeaderField(tag);
+      field.trailer = source_->isTrailerField(tag);
+      field.enumerated = source_->hasFieldValue(tag);
+      ++defined_fields_;
+
+      FIX::TYPE::Type type{FIX::TYPE::Unknown};
+      if (source_->getFieldType(tag, type)) {
+        field.format = ToFormat(type);
+      }
+
+      if (field.enumerated && (field.format == Format::kChar ||
+                               field.format == Format::kBoolean)) {
+        std::bitset<128> values;
+        for (char c = ' '; c < 127; ++c) {
+          values[c] = source_->isFieldValue(tag, std::string(1, c));
+        }
+        field.values = static_cast<std::uint16_t>(char_values_.size());
+        char_values_.push_back(values);
+      }
+    }
+  }
+
+  auto CompileEnvelope() -> void {
+    for (auto tag : kEnvelopeRequired) {
+      if (tag < static_cast<int>(fields_.size()) &&
+          (fields_[tag].header || fields_[tag].trailer)) {
+        fields_[tag].envelope =
+            static_cast<std::uint8_t>(envelope_required_.size());
+        envelope_required_.push_back(tag);
+      }
+    }
+  }
+
+  auto CompileMessageTypes() -> void {
+    std::string_view chars(kMsgTypeChars);
+    std::vector<std::string> names;
+    for (auto first : chars) {
+      names.emplace_back(1, first);
+      for (auto second : chars) {
+        names.push_back({first, second});
+      }
+    }
+
+    for (const auto& name : names) {
+      if (!source_->isMsgType(name)) {
+        continue;
+      }
+
+      MessageType type{name, std::vector<TagRole>(fields_.size()), {}, {}};
+      AddFields(type, name, *source_, true);
+
+      msg_types_[MsgTypeSlot(name)] =
+          static_cast<std::int16_t>(messages_.size());
+      messages_.push_back(std::move(type));
+    }
+  }
+
+  // Messages are parsed flat, so repeating group members are allowed
+  // wherever their group is.
+  auto AddFields(MessageType& type, const std::string& msg_type,
+                 const FIX::DataDictionary& dictionary, bool top_level) const
+      -> void {
+    for (int tag = 1; tag < static_cast<int>(fields_.size()); ++tag) {
+      auto member = top_level ? dictionary.isMsgField(msg_type, tag)
+                              : dictionary.isField(tag);
+      if (!member) {
+        continue;
+      }
+
+      auto& role = type.roles[tag];
+      role.allowed = true;
+      role.in_group = role.in_group || !top_level;
+      if (top_level && dictionary.isRequiredField(msg_type, tag)) {
+        AddRequired(type, tag);
+      }
+
+      int delimiter{0};
+      const FIX::DataDictionary* group{nullptr};
+      if (dictionary.isGroup(msg_type, tag) &&
+          dictionary.getGroup(msg_type, tag, delimiter, group) &&
+          group != nullptr && group != &dictionary) {
+        AddGroup(type, tag, delimiter);
+        AddFields(type, msg_type, *group, false);
+      }
+    }
+  }
+
+  static auto AddRequired(MessageType& type, int tag) -> void {
+    if (type.required.size() == kMaxRequired) {
+      spdlog::warn("compiled dictionary: {} requires more than {} fields, "
+                   "{} is not checked",
+                   type.name, kMaxRequired, tag);
+      return;
+    }
+    type.roles[tag].required = static_cast<std::uint8_t>(type.required.size());
+    type.required.push_back(tag);
+  }
+
+  static auto AddGroup(MessageType& type, int counter, int delimiter)
+      -> void {
+    if (delimiter <= 0 || delimiter >= static_cast<int>(type.roles.size())) {
+      return;
+    }
+    auto slot = type.roles[delimiter].delimiter;
+    if (slot == kNoSlot) {
+      if (type.groups.size() == kMaxGroups) {
+        spdlog::warn("compiled dictionary: {} has more than {} groups, the "
+                     "count in {} is not checked",
+                     type.name, kMaxGroups, counter);
+        return;
+      }
+      slot = static_cast<std::uint8_t>(type.groups.size());
+      type.groups.push_back({counter, delimiter});
+      type.roles[delimiter].delimiter = slot;
+    }
+    type.roles[counter].counter = slot;
+  }
+
+  // Header or trailer fields: DataDictionary::iterate without the message
+  // type checks, and the required ones marked in envelope.
+  auto CheckEnvelope(const FIX::FieldMap& map, bool required_only,
+                     const ValidationOptions& options,
+                     std::uint32_t& envelope) const -> ValidationResult {
+    int last{0};
+    for (const auto& field : map) {
+      auto tag = field.getTag();
+      if (!required_only) {
+        if (tag == last) {
+          return {ValidationError::kRepeatedTag, tag};
+        }
+        if (auto result = CheckField(field, nullptr, options); !result) {
+          return result;
+        }
+      }
+      if (tag > 0 && tag < static_cast<int>(fields_.size()) &&
+          fields_[tag].envelope != kNoSlot) {
+        envelope |= std::uint32_t{1} << fields_[tag].envelope;
+      }
+      last = tag;
+    }
+    return {};
+  }
+
+  // Mirrors DataDictionary::iterate for one field; type is null for header
+  // and trailer fields.
+  auto CheckField(const FIX::FieldBase& field, const MessageType* type,
+                  const ValidationOptions& options) const -> ValidationResult {
+    auto tag = field.getTag();
+    const auto& value = field.getString();
+
+    if (options.check_fields_have_values && value.empty()) {
+      return {ValidationError::kTagSpecifiedWithoutValue, tag};
+    }
+
+    const auto* info = tag > 0 && tag < static_cast<int>(fields_.size())
+                           ? &fields_[tag]
+                           : nullptr;
+    if (info != nullptr && info->defined) {
+      if (!CheckFormat(info->format, value)) {
+        return {ValidationError::kIncorrectDataFormat, tag};
+      }
+      if (info->enumerated && !CheckValue(*info, tag, value)) {
+        return {ValidationError::kIncorrectTagValue, tag};
+      }
+    }
+
+    if (options.allow_unknown_message_fields && tag < kUserMin) {
+      return {};
+    }
+    if (!options.check_user_defined_fields && tag >= kUserMin) {
+      return {};
+    }
+
+    if (info == nullptr || !info->defined) {
+      return {ValidationError::kInvalidTagNumber, tag};
+    }
+    if (type != nullptr && !info->header && !info->trailer &&
+        !type->roles[tag].allowed) {
+      return {ValidationError::kTagNotDefinedForMessage, tag};
+    }
+    return {};
+  }
+
+  auto CheckValue(const Field& info, int tag, const std::string& value) const
+      -> bool {
+    if (info.values == kNoValues) {
+      return source_->isFieldValue(tag, value);
+    }
+    return value.size() == 1 && value[0] > 0 &&
+           char_values_[info.values][static_cast<std::size_t>(value[0])];
+  }
+
+  static auto IsDigit(char c) -> bool { return c >= '0' && c <= '9'; }
+
+  static auto Digits(std::string_view value, std::size_t at, std::size_t count,
+                     int min, int max) -> bool {
+    if (value.size() < at + count) {
+      return false;
+    }
+    int number{0};
+    for (auto i = at; i < at + count; ++i) {
+      if (!IsDigit(value[i])) {
+        return false;
+      }
+      number = number * 10 + (value[i] - '0');
+    }
+    return number >= min && number <= max;
+  }
+
+  // HH:MM:SS with optional .f up to nanoseconds.
+  static auto CheckTime(std::string_view value) -> bool {
+    if (value.size() < 8 || value[2] != ':' || value[5] != ':' ||
+        !Digits(value, 0, 2, 0, 23) || !Digits(value, 3, 2, 0, 59) ||
+        !Digits(value, 6, 2, 0, 60)) {
+      return false;
+    }
+    if (value.size() == 8) {
+      return true;
+    }
+    if (value[8] != '.' || value.size() == 9 || value.size() > 18) {
+      return false;
+    }
+    for (auto i = std::size_t{9}; i < value.size(); ++i) {
+      if (!IsDigit(value[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static auto CheckDate(std::string_view value) -> bool {
+    return Digits(value, 0, 4, 0, 9999) && Digits(value, 4, 2, 1, 12) &&
+           Digits(value, 6, 2, 1, 31);
+  }
+
+  static auto CheckFormat(Format format, std::string_view value) -> bool {
+    switch (format) {
+      case Format::kString:
+        return true;
+      case Format::kChar:
+        return value.size() == 1;
+      case Format::kBoolean:
+        return value == "Y" || value == "N";
+      case Format::kInt: {
+        auto digits = value.substr(!value.empty() && value[0] == '-' ? 1 : 0);
+        if (digits.empty()) {
+          return false;
+        }
+        for (auto c : digits) {
+          if (!IsDigit(c)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      case Format::kFloat: {
+        auto digits = value.substr(!value.empty() && value[0] == '-' ? 1 : 0);
+        auto have_digit{false};
+        auto have_point{false};
+        for (auto c : digits) {
+          if (IsDigit(c)) {
+            have_digit = true;
+          } else if (c == '.' && !have_point) {
+            have_point = true;
+          } else {
+            return false;
+          }
+        }
+        return have_digit;
+      }
+      case Format::kUtcTimeStamp:
+        return value.size() >= 17 && CheckDate(value.substr(0, 8)) &&
+               value[8] == '-' && CheckTime(value.substr(9));
+      case Format::kUtcTimeOnly:
+        return CheckTime(value);
+      case Format::kUtcDate:
+        return value.size() == 8 && CheckDate(value);
+      case Format::kCheckSum:
+        return value.size() == 3 && Digits(value, 0, 3, 0, 255);
+    }
+    return true;
+  }
+
+  std::shared_ptr<const FIX::DataDictionary> source_;
+  std::vector<Field> fields_;
+  std::size_t defined_fields_{0};
+  std::vector<std::bitset<128>> char_values_;
+  std::vector<int> envelope_required_;
+  std::array<std::int16_t, kMsgTypeSlots> msg_types_{};
+  std::vector<MessageType> messages_;
+};
+
+// Compiled validators for every session with PrecompiledDictionary=Y. Built
+// before the sessions start and read-only afterwards, so lookups need no
+// locking. Sessions sharing a DataDictionary file share its tables.
+//
+//   UseDataDictionary=N           keep Session from validating a second time
+//   PrecompiledDictionary=Y
+//   DataDictionary=/path/FIX42.xml
+//   ValidateRequiredOnly=D,F      optional
+class SessionValidators {
+ public:
+  static constexpr auto kPrecompiledDictionary = "PrecompiledDictionary";
+  static constexpr auto kDataDictionary = "DataDictionary";
+  static constexpr auto kUseDataDictionary = "UseDataDictionary";
+
+  struct Validator {
+    std::shared_ptr<const CompiledDictionary> dictionary;
+    ValidationOptions options;
+  };
+
+  static auto FromSettings(const FIX::SessionSettings& settings)
+      -> SessionValidators {
+    SessionValidators validators;
+    std::vector<std::pair<std::string,
+                          std::shared_ptr<const CompiledDictionary>>>
+        compiled;
+
+    for (const auto& session_id : settings.getSessions()) {
+      const auto& dictionary = settings.get(session_id);
+      if (!dictionary.has(kPrecompiledDictionary) ||
+          !dictionary.getBool(kPrecompiledDictionary)) {
+        continue;
+      }
+
+      if (dictionary.has(kUseDataDictionary) &&
+          dictionary.getBool(kUseDataDictionary)) {
+        spdlog::warn("{}: {}=Y with {}=Y validates every message twice",
+                     session_id.toString(), kPrecompiledDictionary,
+                     kUseDataDictionary);
+      }
+
+      auto path = dictionary.getString(kDataDictionary);
+      auto cached = std::find_if(compiled.begin(), compiled.end(),
+                                 [&](const auto& entry) {
+                                   return entry.first == path;
+                                 });
+      if (cached == compiled.end()) {
+        compiled.emplace_back(path, CompiledDictionary::Load(path));
+        cached = std::prev(compiled.end());
+      }
+
+      validators.validators_.emplace_back(
+          session_id,
+          Validator{cached->second, cached->second->MakeOptions(dictionary)});
+    }
+    return validators;
+  }
+
+  auto Find(const FIX::SessionID& session_id) const -> const Validator* {
+    for (const auto& [id, validator] : validators_) {
+      if (id == session_id) {
+        return &validator;
+      }
+    }
+    return nullptr;
+  }
+
+  // Throws what DataDictionary::validate would; a no-op for sessions
+  // without a compiled dictionary.
+  auto Check(const FIX::Message& message,
+             const FIX::SessionID& session_id) const -> void {
+    if (const auto* validator = Find(session_id); validator != nullptr) {
+      validator->dictionary->Validate(message, validator->options).Throw();
+    }
+  }
+
+ private:
+  std::vector<std::pair<FIX::SessionID, Validator>> validators_;
+};
+
+}  // namespace common
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/batched_connection.h"
+#include "common/direct_sender.h"
+#include "common/fix_framing.h"
+#include "common/pool_allocator.h"
+#include "common/pooled_frame.h"
+#include "common/thread_util.h"
+#include "common/time_util.h"
+#include "common/transport_config.h"
+#include "quickfix/Exceptions.h"
+#include "quickfix/Session.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// What an event loop does with its share of connections, whichever way it
+// learns a socket is ready (EventLoop: epoll, UringLoop: io_uring). A
+// connection is handed over with Adopt() from the accepting or connecting
+// thread; from then on its reads, session callbacks, timers and teardown
+// all run on the loop's thread, so nothing about a session is shared
+// between loops.
+//
+// Each connection has a receive buffer from the loop's own BlockPool, and
+// messages are framed, and their BodyLength and CheckSum verified, in place.
+// The only copy is into the std::string Session::next() takes; the
+// application can pick up the received bytes themselves from
+// ReceivedFrame while Session::next() runs.
+//
+// Sessions are registered with DirectSender once known, and driven under
+// the session mutex it hands back, so it can send for them from another
+// thread.
+class ConnectionLoop {
+ protected:
+  static constexpr int kWaitMillis = 100;
+  static constexpr std::size_t kReceiveBufferSize = 65536;
+  static constexpr std::size_t kCacheLine = 64;
+  static constexpr std::uint64_t kTickNanos = 1000000000;
+
+ public:
+  // Finds the session a connection's first message is for, as
+  // FIX::Acceptor::getSession() does, or returns nullptr.
+  using SessionLookup =
+      std::function<FIX::Session*(const std::string&, FIX::Responder&)>;
+  // The session an initiator connected for, as
+  // FIX::Initiator::getSession() does.
+  using SessionAttach = std::function<FIX::Session*(FIX::Responder&)>;
+  // Told when a session's connection is gone.
+  using Disconnected = std::function<void(const FIX::SessionID&)>;
+
+  ConnectionLoop(std::string name, SessionLookup lookup,
+                 const TransportConfig& config, Disconnected disconnected)
+      : name_(std::move(name)),
+        lookup_(std::move(lookup)),
+        disconnected_(std::move(disconnected)),
+        config_(config) {}
+
+  // Loops call Stop() and CloseAll() in their own destructors, while what
+  // Wait() uses still exists.
+  virtual ~ConnectionLoop() = default;
+
+  ConnectionLoop(const ConnectionLoop&) = delete;
+  auto operator=(const ConnectionLoop&) -> ConnectionLoop& = delete;
+
+  auto Start(const ThreadPlacement& placement) -> void {
+    running_ = true;
+    thread_ = std::thread([this, placement]() {
+      ThreadUtil::Place(placement, name_);
+      while (running_.load(std::memory_order_relaxed)) {
+        Poll(kWaitMillis);
+      }
+      CloseAll();
+    });
+  }
+
+  // Drops every connection; their sessions see a disconnect.
+  auto Stop() -> void {
+    if (thread_.joinable()) {
+      running_ = false;
+      Wake();
+      thread_.join();
+    }
+  }
+
+  // Called from any thread; the loop takes ownership of fd. Without attach,
+  // the session is looked up from the first message received.
+  auto Adopt(int fd, SessionAttach attach = nullptr) -> void {
+    {
+      std::lock_guard<std::mutex> lock(adopt_mutex_);
+      adopted_.emplace_back(fd, std::move(attach));
+    }
+    peer_count_.fetch_add(1, std::memory_order_relaxed);
+    Wake();
+  }
+
+  auto PeerCount() const -> std::size_t {
+    return peer_count_.load(std::memory_order_relaxed);
+  }
+
+  // One pass: waits up to timeout_millis, handles what is ready, then writes
+  // out everything the sessions sent meanwhile. Runs on the loop's thread,
+  // or on the single thread driving FIX::Acceptor::poll().
+  auto Poll(int timeout_millis) -> void {
+    if (!batching_) {
+      batching_ = true;
+      OutboundBatch::Enable(config_.batch_messages, config_.batch_delay_nanos);
+    }
+
+    Wait(timeout_millis);
+    OutboundBatch::Flush();
+
+    auto now = TimeUtil::FastEpochNanos();
+    if (now - last_tick_ >= kTickNanos) {
+      last_tick_ = now;
+      Tick();
+    }
+  }
+
+  auto CloseAll() -> void {
+    TakeAdopted();
+    while (!peers_.empty()) {
+      Drop(*peers_.begin()->second);
+    }
+  }
+
+ protected:
+  struct Peer {
+    std::uint64_t id{0};
+    std::shared_ptr<BatchedConnection> connection;
+    FIX::Session* session{nullptr};
+    std::mutex* session_mutex{nullptr};  // from DirectSender::Attach()
+    char* buffer{nullptr};
+    std::size_t begin{0};
+    std::size_t end{0};
+  };
+
+  // Handles whatever becomes ready within timeout_millis.
+  virtual auto Wait(int timeout_millis) -> void = 0;
+  // Makes a Wait() in progress return; called from any thread.
+  virtual auto Wake() -> void = 0;
+  // Starts and stops receiving for a connection.
+  virtual auto Watch(Peer& peer) -> void = 0;
+  virtual auto Unwatch(Peer& peer) -> void = 0;
+
+  auto Name() const -> const std::string& { return name_; }
+
+  auto Find(std::uint64_t id) -> Peer* {
+    auto found = peers_.find(id);
+    return found == peers_.end() ? nullptr : found->second.get();
+  }
+
+  // Sets up connections handed over since the last call.
+  auto TakeAdopted() -> void {
+    std::vector<std::pair<int, SessionAttach>> adopted;
+    {
+      std::lock_guard<std::mutex> lock(adopt_mutex_);
+      adopted.swap(adopted_);
+    }
+    for (auto& [fd, attach] : adopted) {
+      auto owned = std::make_unique<Peer>();
+      auto& peer = *owned;
+      peer.id = ++last_id_;
+      peer.connection =
+          std::make_shared<BatchedConnection>(fd, config_.send_queue_bytes);
+      peer.buffer = static_cast<char*>(buffers_.Allocate());
+      peers_.emplace(peer.id, std::move(owned));
+      Watch(peer);
+
+      if (attach) {
+        // An initiator's session: the logon goes out now.
+        peer.session = attach(*peer.connection);
+        if (peer.session == nullptr) {
+          Drop(peer);
+          continue;
+        }
+        peer.session_mutex =
+            &DirectSender::Attach(*peer.session, peer.connection);
+        std::lock_guard<std::mutex> lock(*peer.session_mutex);
+        peer.session->next(FIX::UtcTimeStamp::now());
+      }
+    }
+  }
+
+  // Where the next bytes received for peer go, after moving what is left
+  // of a partial message to the front. Empty when a message has outgrown
+  // the buffer.
+  auto ReceiveSpace(Peer& peer) -> std::pair<char*, std::size_t> {
+    if (peer.end == kReceiveBufferSize && peer.begin > 0) {
+      std::memmove(peer.buffer, peer.buffer + peer.begin,
+                   peer.end - peer.begin);
+      peer.end -= peer.begin;
+      peer.begin = 0;
+    }
+    if (peer.end == kReceiveBufferSize) {
+      spdlog::warn("{}: message larger than {} bytes", name_,
+                   kReceiveBufferSize);
+    }
+    return {peer.buffer + peer.end, kReceiveBufferSize - peer.end};
+  }
+
+  // Frames and dispatches after bytes were placed at ReceiveSpace(). Returns
+  // false once the peer should be dropped.
+  auto Received(Peer& peer, std::size_t bytes) -> bool {
+    peer.end += bytes;
+    return Dispatch(peer);
+  }
+
+  // Received() for bytes that arrived elsewhere.
+  auto Receive(Peer& peer, const char* data, std::size_t size) -> bool {
+    while (size > 0) {
+      auto [space, room] = ReceiveSpace(peer);
+      if (room == 0) {
+        return false;
+      }
+      auto bytes = std::min(room, size);
+      std::memcpy(space, data, bytes);
+      if (!Received(peer, bytes)) {
+        return false;
+      }
+      data += bytes;
+      size -= bytes;
+    }
+    return true;
+  }
+
+  auto Drop(Peer& peer) -> void {
+    if (peer.session != nullptr) {
+      DirectSender::Detach(peer.session->getSessionID(), *peer.connection);
+      {
+        std::lock_guard<std::mutex> lock(*peer.session_mutex);
+        peer.session->disconnect();
+      }
+      if (disconnected_) {
+        disconnected_(peer.session->getSessionID());
+      }
+    }
+    Unwatch(peer);
+    peer.connection->Close();
+    buffers_.Deallocate(peer.buffer);
+    auto id = peer.id;
+    peers_.erase(id);
+    peer_count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+ private:
+  auto Dispatch(Peer& peer) -> bool {
+    while (peer.begin < peer.end) {
+      auto frame = FixFrame::Find(
+          std::string_view(peer.buffer + peer.begin, peer.end - peer.begin));
+      peer.begin += frame.skip;
+      if (frame.status == FixFrame::Status::kMalformed) {
+        spdlog::warn("{}: malformed message, dropping connection", name_);
+        return false;
+      }
+      if (frame.status == FixFrame::Status::kIncomplete) {
+        if (frame.length > kReceiveBufferSize) {
+          spdlog::warn("{}: message of {} bytes is larger than {}", name_,
+                       frame.length, kReceiveBufferSize);
+          return false;
+        }
+        break;
+      }
+
+      std::string_view received(peer.buffer + peer.begin, frame.length);
+      peer.begin += frame.length;
+      if (!FixFrame::ChecksumValid(received)) {
+        // Ignored like QuickFIX ignores it, unless there is no session yet.
+        spdlog::warn("{}: bad checksum, message ignored", name_);
+        if (peer.session == nullptr || !peer.session->isLoggedOn()) {
+          return false;
+        }
+        continue;
+      }
+      message_.assign(received);
+
+      if (peer.session == nullptr) {
+        peer.session = lookup_(message_, *peer.connection);
+        if (peer.session == nullptr) {
+          spdlog::warn("{}: no session for {}", name_, message_);
+          return false;
+        }
+        peer.session_mutex =
+            &DirectSender::Attach(*peer.session, peer.connection);
+      }
+      try {
+        std::lock_guard<std::mutex> lock(*peer.session_mutex);
+        ReceivedFrame::Scope scope(received);
+        peer.session->next(message_, FIX::UtcTimeStamp::now());
+      } catch (const FIX::InvalidMessage&) {
+        if (!peer.session->isLoggedOn()) {
+          return false;
+        }
+      }
+      OutboundBatch::FlushDue();
+    }
+
+    if (peer.begin == peer.end) {
+      peer.begin = peer.end = 0;
+    }
+    return true;
+  }
+
+  // Heartbeats, test requests and logon timeouts.
+  auto Tick() -> void {
+    for (auto& [id, peer] : peers_) {
+      if (peer->session != nullptr) {
+        std::lock_guard<std::mutex> lock(*peer->session_mutex);
+        peer->session->next(FIX::UtcTimeStamp::now());
+      }
+    }
+    OutboundBatch::Flush();
+  }
+
+  std::string name_;
+  SessionLookup lookup_;
+  Disconnected disconnected_;
+  TransportConfig config_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  bool batching_{false};
+
+  std::mutex adopt_mutex_;
+  std::vector<std::pair<int, SessionAttach>> adopted_;
+  std::atomic<std::size_t> peer_count_{0};
+
+  BlockPool buffers_{kReceiveBufferSize, kCacheLine};
+  std::unordered_map<std::uint64_t, std::unique_ptr<Peer>> peers_;
+  std::uint64_t last_id_{0};
+  std::string message_;
+  std::uint64_t last_tick_{0};
+};
+
+}  // namespace common
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "quickfix/Dictionary.h"
+#include "quickfix/Exceptions.h"
+
+namespace common {
+
+// A price or quantity as an integer count of 10^-scale units, read from and
+// written to FIX ASCII directly rather than through double: "101.25" is
+// 10125 at scale 2. Values carry their own scale, so comparisons are exact
+// across scales; Rescale() brings a value to the scale its symbol trades at.
+// Up to 18 significant digits.
+class Decimal {
+ public:
+  static constexpr int kMaxScale = 18;
+
+  // A product of two Decimals, exact, for comparing against limits.
+  struct Wide {
+    __extension__ using Units = __int128;
+
+    Units units{0};
+    int scale{0};
+
+    friend auto operator<=>(const Wide& lhs, const Wide& rhs)
+        -> std::strong_ordering {
+      if (lhs.scale == rhs.scale) {
+        return lhs.units <=> rhs.units;
+      }
+      // Bring the coarser one to the finer scale; one too large for that
+      // outweighs the other whatever its value.
+      const auto& fine = lhs.scale > rhs.scale ? lhs : rhs;
+      const auto& coarse = lhs.scale > rhs.scale ? rhs : lhs;
+      auto scaled = coarse.units;
+      for (auto step = coarse.scale; step < fine.scale; ++step) {
+        if (scaled > kUnitsMax / 10 || scaled < -(kUnitsMax / 10)) {
+          auto order = scaled <=> Units{0};
+          return &coarse == &lhs ? order : 0 <=> order;
+        }
+        scaled *= 10;
+      }
+      return &coarse == &lhs ? scaled <=> fine.units : fine.units <=> scaled;
+    }
+
+    friend auto operator==(const Wide& lhs, const Wide& rhs) -> bool {
+      return (lhs <=> rhs) == 0;
+    }
+
+   private:
+    static constexpr Units kUnitsMax =
+        (Units{1} << 126U) - 1 + (Units{1} << 126U);
+  };
+
+  constexpr Decimal() = default;
+  constexpr Decimal(std::int64_t units, int scale)
+      : units_(units), scale_(static_cast<std::uint8_t>(scale)) {}
+
+  // [-]digits[.digits], the scale being the number of digits after the
+  // point. Anything else, including an exponent, is rejected.
+  static auto Parse(std::string_view text) -> std::optional<Decimal> {
+    constexpr auto kLimit =
+        (std::numeric_limits<std::int64_t>::max() - 9) / 10;
+    auto negative = !text.empty() && text.front() == '-';
+    if (negative) {
+      text.remove_prefix(1);
+    }
+
+    std::int64_t units{0};
+    int scale{0};
+    auto digits{0};
+    auto point{false};
+    for (auto c : text) {
+      if (c == '.' && !point) {
+        point = true;
+        continue;
+      }
+      if (c < '0' || c > '9' || units > kLimit) {
+        return std::nullopt;
+      }
+      units = units * 10 + (c - '0');
+      scale += point ? 1 : 0;
+      ++digits;
+    }
+    if (digits == 0 || scale > kMaxScale) {
+      return std::nullopt;
+    }
+    return Decimal(negative ? -units : units, scale);
+  }
+
+  auto Units() const -> std::int64_t { return units_; }
+  auto Scale() const -> int { return scale_; }
+
+  // The same value in 10^-scale units, unless that would drop a nonzero
+  // digit or overflow.
+  auto Rescale(int scale) const -> std::optional<Decimal> {
+    if (scale < 0 || scale > kMaxScale) {
+      return std::nullopt;
+    }
+    auto units = units_;
+    for (auto step = Scale(); step > scale; --step) {
+      if (units % 10 != 0) {
+        return std::nullopt;
+      }
+      units /= 10;
+    }
+    constexpr auto kLimit = std::numeric_limits<std::int64_t>::max() / 10;
+    for (auto step = Scale(); step < scale; ++step) {
+      if (units > kLimit || units < -kLimit) {
+        return std::nullopt;
+      }
+      units *= 10;
+    }
+    return Decimal(units, scale);
+  }
+
+  auto Widen() const -> Wide { return {units_, scale_}; }
+
+  auto Times(const Decimal& other) const -> Wide {
+    return {static_cast<Wide::Units>(units_) * other.units_,
+            scale_ + other.scale_};
+  }
+
+  // Writes the shortest form that reads back as the same value: no
+  // trailing zeros after the point and no point for a whole number.
+  auto Format(char* out, char* last) const -> char* {
+    if (units_ == 0) {
+      return out == last ? last : (*out = '0', out + 1);
+    }
+    char digits[24];
+    auto magnitude = units_ < 0 ? 0 - static_cast<std::uint64_t>(units_)
+                                : static_cast<std::uint64_t>(units_);
+    auto* end = std::to_chars(digits, digits + sizeof(digits), magnitude).ptr;
+    auto count = static_cast<int>(end - digits);
+    auto scale = Scale();
+    while (scale > 0 && count > 0 && digits[count - 1] == '0') {
+      --count;
+      --scale;
+    }
+
+    auto whole = std::max(count - scale, 0);
+    auto needed = (units_ < 0 ? 1 : 0) + std::max(whole, 1) +
+                  (scale > 0 ? 1 + scale : 0);
+    if (last - out < needed) {
+      return last;
+    }
+    if (units_ < 0) {
+      *out++ = '-';
+    }
+    if (whole == 0) {
+      *out++ = '0';
+    }
+    out = std::copy(digits, digits + whole, out);
+    if (scale > 0) {
+      *out++ = '.';
+      out = std::fill_n(out, scale - (count - whole), '0');
+      out = std::copy(digits + whole, digits + count, out);
+    }
+    return out;
+  }
+
+  auto ToString() const -> std::string {
+    char out[32];
+    return {out, Format(out, out + sizeof(out))};
+  }
+
+  friend auto operator<=>(const Decimal& lhs, const Decimal& rhs)
+      -> std::strong_ordering {
+    return lhs.Widen() <=> rhs.Widen();
+  }
+
+  friend auto operator==(const Decimal& lhs, const Decimal& rhs) -> bool {
+    return lhs.Widen() == rhs.Widen();
+  }
+
+ private:
+  std::int64_t units_{0};
+  std::uint8_t scale_{0};
+};
+
+// The scale each symbol's prices trade at, and the one for quantities, read
+// from the [DEFAULT] section of the session settings:
+//
+//   PriceScale=4                  any symbol not listed below
+//   SymbolPriceScales=ESZ1:2,6EZ1:5
+//   QtyScale=0
+//
+// An order priced finer than its symbol's scale is rejected.
+class SymbolScales {
+ public:
+  static constexpr auto kPriceScale = "PriceScale";
+  static constexpr auto kSymbolPriceScales = "SymbolPriceScales";
+  static constexpr auto kQtyScale = "QtyScale";
+
+  static constexpr int kDefaultPriceScale = 4;
+  static constexpr int kDefaultQtyScale = 0;
+
+  static auto FromSettings(const FIX::Dictionary& settings) -> SymbolScales {
+    SymbolScales scales;
+    if (settings.has(kPriceScale)) {
+      scales.price_scale_ = Checked(settings.getInt(kPriceScale));
+    }
+    if (settings.has(kQtyScale)) {
+      scales.qty_scale_ = Checked(settings.getInt(kQtyScale));
+    }
+    if (settings.has(kSymbolPriceScales)) {
+      auto list = settings.getString(kSymbolPriceScales);
+      std::string_view rest(list);
+      while (!rest.empty()) {
+        auto entry = rest.substr(0, rest.find(','));
+        rest.remove_prefix(std::min(rest.size(), entry.size() + 1));
+        auto colon = entry.find(':');
+        int scale{0};
+        auto value = entry.substr(colon == std::string_view::npos
+                                      ? entry.size()
+                                      : colon + 1);
+        auto result =
+            std::from_chars(value.data(), value.data() + value.size(), scale);
+        if (colon == std::string_view::npos || value.empty() ||
+            result.ptr != value.data() + value.size()) {
+          throw FIX::ConfigError(std::string(kSymbolPriceScales) +
+                                 ": expected SYMBOL:SCALE, got " +
+                                 std::string(entry));
+        }
+        scales.symbols_.emplace_back(entry.substr(0, colon), Checked(scale));
+      }
+      std::sort(scales.symbols_.begin(), scales.symbols_.end());
+    }
+    return scales;
+  }
+
+  auto PriceScale(std::string_view symbol) const -> int {
+    auto found = std::lower_bound(
+        symbols_.begin(), symbols_.end(), symbol,
+        [](const auto& entry, std::string_view key) {
+          return entry.first < key;
+        });
+    return found != symbols_.end() && found->first == symbol ? found->second
+                                                             : price_scale_;
+  }
+
+  auto QtyScale() const -> int { return qty_scale_; }
+
+ private:
+  static auto Checked(int scale) -> int {
+    if (scale < 0 || scale > Decimal::kMaxScale) {
+      throw FIX::ConfigError("scale out of range: " + std::to_string(scale));
+    }
+    return scale;
+  }
+
+  int price_scale_{kDefaultPriceScale};
+  int qty_scale_{kDefaultQtyScale};
+  std::vector<std::pair<std::string, int>> symbols_;
+};
+
+}  // namespace common
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+#include "common/batched_connection.h"
+#include "common/fix_encoder.h"
+#include "common/time_util.h"
+#include "quickfix/Exceptions.h"
+#include "quickfix/Session.h"
+#include "quickfix/SessionState.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// Sends application messages encoded with FixEncoder straight into a
+// per-session buffer, for the sessions an event loop has attached, doing
+// what Session::sendToTarget() would: the header, the next MsgSeqNum, the
+// store, the log and the last-sent time the heartbeat timer reads, then the
+// connection, but with no FIX::Message and no intermediate strings.
+// Application::toApp() is not called.
+//
+// Whichever loop has the session holds its SessionMutex() around everything
+// it has the session do, and Send() takes it too, so the two never hand out
+// the same MsgSeqNum. The mutex belongs to the SessionID, not the
+// connection, so it still holds when the session is reattached on a new
+// connection (or another loop) while a send for the old one is under way.
+class DirectSender {
+ public:
+  // Called by the event loop once it knows a connection's session. Returns
+  // the session's mutex, for the loop to hold while driving it.
+  static auto Attach(FIX::Session& session,
+                     std::shared_ptr<BatchedConnection> connection)
+      -> std::mutex& {
+    const auto& session_id = session.getSessionID();
+    auto outlet = std::make_shared<Outlet>();
+    outlet->session = &session;
+    outlet->connection = std::move(connection);
+    outlet->begin_string = session_id.getBeginString().getValue();
+    // As Session::insertSendingTime(): whole seconds before FIX.4.2.
+    if (outlet->begin_string == FIX::BeginString_FIXT11 ||
+        outlet->begin_string >= FIX::BeginString_FIX42) {
+      outlet->timestamp_precision = session.getTimestampPrecision();
+    }
+
+    std::unique_lock<std::shared_mutex> lock(Mutex());
+    auto& mutex = SessionMutexes()[session_id];
+    outlet->mutex = &mutex;
+    Outlets()[session_id] = std::move(outlet);
+    return mutex;
+  }
+
+  // Called by the event loop when the connection is gone; a newer one the
+  // session has since been attached on stays.
+  static auto Detach(const FIX::SessionID& session_id,
+                     const BatchedConnection& connection) -> void {
+    std::unique_lock<std::shared_mutex> lock(Mutex());
+    auto found = Outlets().find(session_id);
+    if (found != Outlets().end() &&
+        found->second->connection.get() == &connection) {
+      Outlets().erase(found);
+    }
+  }
+
+  // Encodes a message of msg_type for session_id, body(encoder) writing its
+  // fields, and sends it. Returns false, having sent nothing, when no event
+  // loop has the session, so the caller can fall back to QuickFIX.
+  template <typename Body>
+  static auto Send(const FIX::SessionID& session_id, std::string_view msg_type,
+                   Body&& body) -> bool {
+    auto outlet = Find(session_id);
+    if (!outlet) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(*outlet->mutex);
+    auto& session = *outlet->session;
+    try {
+      // QuickFIX hands its state out as a const store; the session writes
+      // the same one as sendToTarget() would.
+      auto* state = dynamic_cast<FIX::SessionState*>(
+          const_cast<FIX::MessageStore*>(session.getStore()));
+      if (state == nullptr) {
+        return false;
+      }
+      auto seq_num = state->getNextSenderMsgSeqNum();
+
+      auto& encoder = outlet->encoder;
+      encoder.Begin(outlet->begin_string);
+      encoder.Field(FIX::FIELD::MsgType, msg_type);
+      encoder.Field(FIX::FIELD::SenderCompID,
+                    session_id.getSenderCompID().getValue());
+      encoder.Field(FIX::FIELD::TargetCompID,
+                    session_id.getTargetCompID().getValue());
+      encoder.Field(FIX::FIELD::MsgSeqNum, seq_num);
+      encoder.Timestamp(FIX::FIELD::SendingTime, TimeUtil::FastEpochNanos(),
+                        outlet->timestamp_precision);
+      body(encoder);
+      auto& message = encoder.Finish();
+
+      // As Session::fill() does, so no heartbeat goes out while sending.
+      state->lastSentTime(FIX::UtcTimeStamp::now());
+      if (session.getPersistMessages()) {
+        state->set(seq_num, message);
+      }
+      state->incrNextSenderMsgSeqNum();
+      session.getLog()->onOutgoing(message);
+      // Like QuickFIX, stored for a resend but not sent while logged out.
+      if (session.isLoggedOn()) {
+        outlet->connection->Send(message);
+      }
+    } catch (const FIX::IOException& e) {
+      spdlog::error("{}: send failed: {}", session_id.toString(), e.what());
+    }
+    return true;
+  }
+
+ private:
+  struct Outlet {
+    FIX::Session* session{nullptr};
+    std::shared_ptr<BatchedConnection> connection;
+    std::mutex* mutex{nullptr};  // the session's, see SessionMutexes()
+    std::string begin_string;
+    int timestamp_precision{0};  // the session's, for SendingTime
+    FixEncoder encoder;  // used under mutex
+  };
+
+  static auto Find(const FIX::SessionID& session_id)
+      -> std::shared_ptr<Outlet> {
+    std::shared_lock<std::shared_mutex> lock(Mutex());
+    auto found = Outlets().find(session_id);
+    return found == Outlets().end() ? nullptr : found->second;
+  }
+
+  static auto Mutex() -> std::shared_mutex& {
+    static std::shared_mutex mutex;
+    return mutex;
+  }
+
+  static auto Outlets()
+      -> std::map<FIX::SessionID, std::shared_ptr<Outlet>>& {
+    static std::map<FIX::SessionID, std::shared_ptr<Outlet>> outlets;
+    return outlets;
+  }
+
+  // One per session ever attached, never removed, so every outlet and loop
+  // for a session locks the same one.
+  static auto SessionMutexes() -> std::map<FIX::SessionID, std::mutex>& {
+    static std::map<FIX::SessionID, std::mutex> mutexes;
+    return mutexes;
+  }
+};
+
+}  // namespace common
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "common/connection_loop.h"
+#include "common/transport_config.h"
+#include "quickfix/Exceptions.h"
+
+namespace common {
+
+// A ConnectionLoop on edge-triggered epoll: each connection reads straight
+// into its receive buffer until the socket is drained.
+class EventLoop : public ConnectionLoop {
+ private:
+  static constexpr int kMaxEvents = 64;
+  static constexpr std::uint64_t kWakeId = 0;  // peer ids start at 1
+
+ public:
+  static constexpr auto kKind = "epoll";
+
+  EventLoop(std::string name, SessionLookup lookup,
+            const TransportConfig& config, Disconnected disconnected = nullptr)
+      : ConnectionLoop(std::move(name), std::move(lookup), config,
+                       std::move(disconnected)),
+        epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)),
+        wake_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+      throw FIX::RuntimeError(Name() + ": " + std::strerror(errno));
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kWakeId;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+  }
+
+  ~EventLoop() override {
+    Stop();
+    CloseAll();
+    ::close(wake_fd_);
+    ::close(epoll_fd_);
+  }
+
+ private:
+  auto Wait(int timeout_millis) -> void override {
+    std::array<epoll_event, kMaxEvents> events{};
+    auto count =
+        ::epoll_wait(epoll_fd_, events.data(), kMaxEvents, timeout_millis);
+
+    for (int i = 0; i < count; ++i) {
+      auto id = events[i].data.u64;
+      if (id == kWakeId) {
+        std::uint64_t wake{0};
+        static_cast<void>(::read(wake_fd_, &wake, sizeof(wake)));
+        TakeAdopted();
+      } else if (auto* peer = Find(id); peer != nullptr) {
+        if ((events[i].events & EPOLLOUT) != 0) {
+          peer->connection->Flush();
+        }
+        auto readable =
+            (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+        if (readable != 0 && !Read(*peer)) {
+          Drop(*peer);
+        }
+      }
+    }
+  }
+
+  auto Wake() -> void override {
+    std::uint64_t wake{1};
+    static_cast<void>(::write(wake_fd_, &wake, sizeof(wake)));
+  }
+
+  auto Watch(Peer& peer) -> void override {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = peer.id;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, peer.connection->Fd(), &event);
+  }
+
+  auto Unwatch(Peer& peer) -> void override {
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, peer.connection->Fd(), nullptr);
+  }
+
+  // Edge-triggered: reads until the socket is drained, framing and
+  // dispatching as the buffer fills. Returns false once the peer should be
+  // dropped.
+  auto Read(Peer& peer) -> bool {
+    while (true) {
+      auto [space, room] = ReceiveSpace(peer);
+      if (room == 0) {
+        return false;
+      }
+
+      auto bytes = ::read(peer.connection->Fd(), space, room);
+      if (bytes > 0) {
+        if (!Received(peer, static_cast<std::size_t>(bytes))) {
+          return false;
+        }
+        continue;
+      }
+      if (bytes < 0 && errno == EINTR) {
+        continue;
+      }
+      return bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+  }
+
+  int epoll_fd_;
+  int wake_fd_;
+};
+
+}  // namespace common
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "common/decimal.h"
+#include "common/fix_checksum.h"
+#include "quickfix/Message.h"
+
+namespace common {
+
+// Writes a FIX message field by field straight into one reused buffer,
+// with numbers formatted by to_chars, in place of building a FIX::Message
+// and serializing it. Room for BodyLength is left ahead of the body and
+// filled in by Finish(), which appends the CheckSum:
+//
+//   encoder.Begin("FIX.4.2");
+//   encoder.Field(FIX::FIELD::MsgType, '8');
+//   ...
+//   auto& message = encoder.Finish();
+//
+// Fields are written in the order they are given.
+class FixEncoder {
+ private:
+  static constexpr char kSoh = '\001';
+  static constexpr std::size_t kInitialSize = 512;
+  // BodyLength digits room is left for; a body outside 100-999 bytes is
+  // moved once by Finish().
+  static constexpr std::size_t kBodyLengthDigits = 3;
+  // Enough for any tag, a double in fixed notation, and the trailer.
+  static constexpr std::size_t kMaxFieldSize = 400;
+  static constexpr std::size_t kTrailerLength = 7;  // "10=nnn\001"
+
+ public:
+  auto Begin(std::string_view begin_string) -> void {
+    if (buffer_.capacity() < kInitialSize) {
+      buffer_.reserve(kInitialSize);
+    }
+    buffer_.resize(buffer_.capacity());
+    position_ = 0;
+    Append("8=");
+    Append(begin_string);
+    Append("\0019=");
+    body_length_ = position_;
+    position_ += kBodyLengthDigits + 1;
+    body_ = position_;
+  }
+
+  auto Field(int tag, std::string_view value) -> void {
+    Tag(tag, value.size());
+    Append(value);
+    buffer_[position_++] = kSoh;
+  }
+
+  auto Field(int tag, char value) -> void {
+    Tag(tag, 1);
+    buffer_[position_++] = value;
+    buffer_[position_++] = kSoh;
+  }
+
+  template <typename Number>
+    requires std::integral<Number> || std::floating_point<Number>
+  auto Field(int tag, Number value) -> void {
+    Tag(tag, 0);
+    auto* end = buffer_.data() + buffer_.size();
+    position_ = Format(value, &buffer_[position_], end) - buffer_.data();
+    buffer_[position_++] = kSoh;
+  }
+
+  auto Field(int tag, const Decimal& value) -> void {
+    Tag(tag, 0);
+    auto* end = buffer_.data() + buffer_.size();
+    position_ = value.Format(&buffer_[position_], end) - buffer_.data();
+    buffer_[position_++] = kSoh;
+  }
+
+  // A UTCTimestamp, YYYYMMDD-HH:MM:SS with precision (0 to 9, as QuickFIX's
+  // TimestampPrecision) digits of the second after a '.'.
+  auto Timestamp(int tag, std::uint64_t epoch_nanos, int precision = 3)
+      -> void {
+    precision = std::clamp(precision, 0, 9);
+    constexpr std::size_t kSecondLength = 17;
+    auto length =
+        kSecondLength + (precision > 0 ? 1 + static_cast<std::size_t>(precision)
+                                       : 0);
+    Tag(tag, length);
+    auto seconds = epoch_nanos / 1000000000;
+    if (seconds != cached_second_) {
+      cached_second_ = seconds;
+      FormatSecond(seconds, cached_time_);
+    }
+    auto* out = &buffer_[position_];
+    std::memcpy(out, cached_time_, sizeof(cached_time_));
+    if (precision > 0) {
+      out[kSecondLength] = '.';
+      auto fraction = epoch_nanos % 1000000000;
+      for (auto digit = 9; digit > precision; --digit) {
+        fraction /= 10;
+      }
+      for (auto digit = precision; digit > 0; --digit) {
+        out[kSecondLength + digit] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+      }
+    }
+    position_ += length;
+    buffer_[position_++] = kSoh;
+  }
+
+  // Fills in BodyLength, appends the CheckSum and returns the message,
+  // valid until the next Begin(). The caller may take the string, swapping
+  // in a spare for the next message (see BatchedConnection::Send()).
+  auto Finish() -> std::string& {
+    char digits[20];
+    auto body_length = position_ - body_;
+    auto* end = std::to_chars(std::begin(digits), std::end(digits),
+                              body_length).ptr;
+    auto count = static_cast<std::size_t>(end - digits);
+    Reserve(count + kTrailerLength);
+    if (count != kBodyLengthDigits) {
+      std::memmove(&buffer_[body_length_ + count + 1], &buffer_[body_],
+                   body_length);
+      body_ = body_length_ + count + 1;
+      position_ = body_ + body_length;
+    }
+    std::memcpy(&buffer_[body_length_], digits, count);
+    buffer_[body_length_ + count] = kSoh;
+
+    auto checksum =
+        FixChecksum::Of(std::string_view(buffer_.data(), position_));
+    Append("10=");
+    FixChecksum::Format(checksum, &buffer_[position_]);
+    position_ += 3;
+    buffer_[position_++] = kSoh;
+    buffer_.resize(position_);
+    return buffer_;
+  }
+
+  // value as FixEncoder writes it into [out, last): integers in decimal,
+  // doubles in the shortest fixed notation that reads back the same.
+  template <typename Number>
+  static auto Format(Number value, char* out, char* last) -> char* {
+    if constexpr (std::floating_point<Number>) {
+      return std::to_chars(out, last, value, std::chars_format::fixed).ptr;
+    } else {
+      return std::to_chars(out, last, value).ptr;
+    }
+  }
+
+ private:
+  auto Reserve(std::size_t bytes) -> void {
+    if (position_ + bytes > buffer_.size()) {
+      buffer_.resize(std::max(buffer_.size() * 2, position_ + bytes));
+    }
+  }
+
+  auto Append(std::string_view bytes) -> void {
+    Reserve(bytes.size());
+    std::memcpy(&buffer_[position_], bytes.data(), bytes.size());
+    position_ += bytes.size();
+  }
+
+  // Writes "tag=" and leaves room for value_size bytes and the SOH, or for
+  // a number when value_size is 0.
+  auto Tag(int tag, std::size_t value_size) -> void {
+    Reserve(kMaxFieldSize + value_size);
+    auto* out = &buffer_[position_];
+    out = std::to_chars(out, out + 16, tag).ptr;
+    *out++ = '=';
+    position_ = out - buffer_.data();
+  }
+
+  static auto FormatSecond(std::uint64_t seconds, char (&out)[17]) -> void {
+    using std::chrono::days;
+    using std::chrono::sys_days;
+    auto day = sys_days(days(seconds / 86400));
+    std::chrono::year_month_day date(day);
+    auto time = seconds % 86400;
+    auto two = [](char* at, unsigned value) {
+      at[0] = static_cast<char>('0' + value / 10);
+      at[1] = static_cast<char>('0' + value % 10);
+    };
+    auto year = static_cast<unsigned>(static_cast<int>(date.year()));
+    two(out, year / 100);
+    two(out + 2, year % 100);
+    two(out + 4, static_cast<unsigned>(date.month()));
+    two(out + 6, static_cast<unsigned>(date.day()));
+    out[8] = '-';
+    two(out + 9, static_cast<unsigned>(time / 3600));
+    out[11] = ':';
+    two(out + 12, static_cast<unsigned>(time / 60 % 60));
+    out[14] = ':';
+    two(out + 15, static_cast<unsigned>(time % 60));
+  }
+
+  std::string buffer_;
+  std::size_t position_{0};
+  std::size_t body_length_{0};  // where BodyLength's digits go
+  std::size_t body_{0};
+  std::uint64_t cached_second_{~std::uint64_t{0}};
+  char cached_time_[17]{};
+};
+
+// The same calls as FixEncoder, setting the fields on a FIX::Message, for a
+// session that has to be sent to through QuickFIX.
+class MessageFields {
+ public:
+  explicit MessageFields(FIX::Message& message) : message_(message) {}
+
+  auto Field(int tag, std::string_view value) -> void {
+    message_.setField(tag, std::string(value));
+  }
+
+  auto Field(int tag, char value) -> void {
+    message_.setField(tag, std::string(1, value));
+  }
+
+  auto Field(int tag, const Decimal& value) -> void {
+    message_.setField(tag, value.ToString());
+  }
+
+  template <typename Number>
+    requires std::integral<Number> || std::floating_point<Number>
+  auto Field(int tag, Number value) -> void {
+    char out[kMaxNumberSize];
+    auto* end = FixEncoder::Format(value, out, out + sizeof(out));
+    message_.setField(tag, std::string(out, end));
+  }
+
+ private:
+  static constexpr std::size_t kMaxNumberSize = 400;
+
+  FIX::Message& message_;
+};
+
+}  // namespace common
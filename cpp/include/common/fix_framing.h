@@ -0,0 +1,142 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "common/fix_checksum.h"
+
+namespace common {
+
+// Where the next complete message in a receive buffer ends, found from its
+// BodyLength the way FIX::Parser does but without copying the buffer.
+struct FixFrame {
+  enum class Status {
+    kComplete,
+    kIncomplete,  // read more and try again
+    kMalformed,   // the stream cannot be resynchronized from here
+  };
+
+  Status status{Status::kIncomplete};
+  std::size_t skip{0};    // bytes before "8=" that belong to no message
+  // Of the message starting at skip; when incomplete, what it will take
+  // once BodyLength has been read (0 before).
+  std::size_t length{0};
+
+  static constexpr std::size_t kTrailerLength = 7;  // "10=nnn\001"
+
+  static auto Find(std::string_view data) -> FixFrame {
+    constexpr char kSoh = '\001';
+    FixFrame frame;
+
+    auto begin = data.find("8=");
+    if (begin == std::string_view::npos) {
+      // Keep a trailing '8' that may start the next message.
+      frame.skip = data.size() - (!data.empty() && data.back() == '8');
+      return frame;
+    }
+    frame.skip = begin;
+    data.remove_prefix(begin);
+
+    auto begin_string_end = data.find(kSoh);
+    if (begin_string_end == std::string_view::npos) {
+      return frame;
+    }
+    auto body_length_start = begin_string_end + 1;
+    if (data.size() < body_length_start + 2) {
+      return frame;
+    }
+    if (data.compare(body_length_start, 2, "9=") != 0) {
+      frame.status = Status::kMalformed;
+      return frame;
+    }
+
+    std::size_t body_length{0};
+    auto position = body_length_start + 2;
+    for (; position < data.size() && data[position] != kSoh; ++position) {
+      auto digit = data[position] - '0';
+      if (digit < 0 || digit > 9 || body_length > (1U << 24U)) {
+        frame.status = Status::kMalformed;
+        return frame;
+      }
+      body_length = body_length * 10 + static_cast<std::size_t>(digit);
+    }
+    if (position == data.size()) {
+      return frame;
+    }
+
+    auto trailer = position + 1 + body_length;
+    if (data.size() < trailer + kTrailerLength) {
+      frame.length = trailer + kTrailerLength;
+      return frame;
+    }
+    if (data.compare(trailer, 3, "10=") != 0 ||
+        data[trailer + kTrailerLength - 1] != kSoh) {
+      frame.status = Status::kMalformed;
+      return frame;
+    }
+
+    frame.status = Status::kComplete;
+    frame.length = trailer + kTrailerLength;
+    return frame;
+  }
+
+  // Whether a complete message's CheckSum matches its bytes, checked where
+  // it was received.
+  static auto ChecksumValid(std::string_view message) -> bool {
+    auto body = message.size() - kTrailerLength;
+    const auto* digits = message.data() + body + 3;
+    std::uint32_t checksum{0};
+    auto result = std::from_chars(digits, digits + 3, checksum);
+    return result.ptr == digits + 3 &&
+           checksum == FixChecksum::Of(message.substr(0, body));
+  }
+};
+
+// The fields of a framed message, read in place.
+struct FixFields {
+  // Calls handle(tag, value) for each field in order while it returns true.
+  // Returns false if it stopped early or the message is not tag=value pairs.
+  template <typename Handle>
+  static auto ForEach(std::string_view message, Handle&& handle) -> bool {
+    constexpr char kSoh = '\001';
+    std::size_t position{0};
+    while (position < message.size()) {
+      auto equals = message.find('=', position);
+      auto end = message.find(kSoh, position);
+      if (equals == std::string_view::npos || end == std::string_view::npos ||
+          equals > end) {
+        return false;
+      }
+      int tag{0};
+      const auto* tag_end = message.data() + equals;
+      auto result = std::from_chars(message.data() + position, tag_end, tag);
+      if (result.ptr != tag_end || equals == position) {
+        return false;
+      }
+      if (!handle(tag, message.substr(equals + 1, end - equals - 1))) {
+        return false;
+      }
+      position = end + 1;
+    }
+    return true;
+  }
+
+  // The first value of tag, if the message carries it.
+  static auto Find(std::string_view message, int tag)
+      -> std::optional<std::string_view> {
+    std::optional<std::string_view> found;
+    ForEach(message, [&](int field, std::string_view value) {
+      if (field == tag) {
+        found = value;
+        return false;
+      }
+      return true;
+    });
+    return found;
+  }
+};
+
+}  // namespace common
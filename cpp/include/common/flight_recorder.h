@@ -0,0 +1,463 @@
+#pragma once
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common/latency_trace.h"
+#include "common/thread_util.h"
+#include "common/time_util.h"
+#include "quickfix/Dictionary.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+enum class FlightEvent : std::uint8_t {
+  kStage = 0,   // the message reached stage
+  kReject = 1,  // the order was rejected; value is the reason
+  kSpike = 2,   // the message took value micros, over the trigger
+};
+
+// One fixed-size entry, the same in a thread's ring and in a dump file.
+struct FlightRecord {
+  std::uint64_t time;     // TimeUtil::Cycles() in a ring, epoch nanos dumped
+  std::uint32_t order;    // FlightRecorder::Hash() of the ClOrdID, 0 if none
+  std::uint32_t session;  // FlightRecorder::Hash() of the SessionID
+  FlightEvent event;
+  TraceStage stage;
+  std::uint16_t reserved;
+  std::uint32_t value;
+};
+
+static_assert(sizeof(FlightRecord) == 24);
+static_assert(std::is_trivially_copyable_v<FlightRecord>);
+
+// A dump file is this header, session_count FlightSessionEntry each followed
+// by its name, then thread_count FlightThreadEntry each followed by its
+// records, oldest first.
+struct FlightFileHeader {
+  static constexpr std::uint64_t kMagic = 0x5448474c46584946;  // "FIXFLGHT"
+  static constexpr std::uint32_t kVersion = 1;
+
+  enum class Trigger : std::uint32_t {
+    kNone = 0,
+    kSignal = 1,
+    kLatency = 2,
+  };
+
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t record_size;
+  std::uint64_t dumped_nanos;  // epoch nanos
+  std::uint32_t pid;
+  Trigger trigger;
+  std::uint32_t session_count;
+  std::uint32_t thread_count;
+};
+
+struct FlightSessionEntry {
+  std::uint32_t session;
+  std::uint32_t length;
+};
+
+struct FlightThreadEntry {
+  static constexpr std::size_t kNameSize = 16;
+
+  std::uint32_t thread_id;
+  std::uint32_t record_count;
+  std::array<char, kNameSize> name;
+};
+
+// The last capacity records of one thread. Only that thread pushes; a dump
+// copies from another thread at any time.
+class FlightRing {
+ private:
+  static constexpr std::size_t kWords =
+      sizeof(FlightRecord) / sizeof(std::uint64_t);
+  using Words = std::array<std::uint64_t, kWords>;
+
+ public:
+  FlightRing(std::size_t capacity, std::uint32_t thread_id, std::string name)
+      : capacity_(capacity),
+        words_(capacity * kWords),
+        thread_id_(thread_id),
+        name_(std::move(name)) {}
+
+  auto Push(const FlightRecord& record) -> void {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto words = std::bit_cast<Words>(record);
+    auto* slot = &words_[(head & (capacity_ - 1)) * kWords];
+    // Keeps the slot stores after the head stored by the last push, so a
+    // Copy() that loads any of them also sees that head and drops the slot.
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t index = 0; index < kWords; ++index) {
+      slot[index].store(words[index], std::memory_order_relaxed);
+    }
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  // The records held, oldest first, leaving out any the thread overwrote
+  // while they were being copied.
+  auto Copy() const -> std::vector<FlightRecord> {
+    auto end = head_.load(std::memory_order_acquire);
+    auto begin = end > capacity_ ? end - capacity_ : 0;
+    std::vector<FlightRecord> records;
+    records.reserve(end - begin);
+    for (auto position = begin; position < end; ++position) {
+      const auto* slot = &words_[(position & (capacity_ - 1)) * kWords];
+      Words words{};
+      // Acquire, so the head is read again only after every slot is.
+      for (std::size_t index = 0; index < kWords; ++index) {
+        words[index] = slot[index].load(std::memory_order_acquire);
+      }
+      records.push_back(std::bit_cast<FlightRecord>(words));
+    }
+
+    // The thread may be part way through position after, which reuses the
+    // slot of after - capacity.
+    auto after = head_.load(std::memory_order_relaxed);
+    auto reused = after + 1 > capacity_ ? after + 1 - capacity_ : 0;
+    if (reused > begin) {
+      records.erase(records.begin(),
+                    records.begin() + static_cast<std::ptrdiff_t>(
+                                          std::min(reused - begin,
+                                                   records.size())));
+    }
+    return records;
+  }
+
+  auto ThreadId() const -> std::uint32_t { return thread_id_; }
+  auto Name() const -> const std::string& { return name_; }
+
+ private:
+  const std::size_t capacity_;
+  std::vector<std::atomic<std::uint64_t>> words_;
+  const std::uint32_t thread_id_;
+  const std::string name_;
+  alignas(64) std::atomic<std::uint64_t> head_{0};
+};
+
+// Flight recorder: every thread that records gets its own FlightRing, so
+// recording is a cycle stamp and three stores, with no lock and no shared
+// cache line. The rings are dumped to <FlightRecorderPath>/<epoch
+// nanos>.flight on SIGUSR1, or when a message takes longer than the
+// trigger, by a background thread; fix_flight converts a dump to Chrome
+// trace / Perfetto JSON. [DEFAULT] settings:
+//
+//   FlightRecorderPath=/path         directory for dumps; unset records none
+//   FlightRecorderRecords=65536      records kept per thread
+//   FlightRecorderTriggerMicros=500  dump when a message takes longer
+//
+// After a latency-triggered dump, further spikes are let pass for
+// kTriggerHoldOff, so a slow patch leaves one dump rather than hundreds.
+class FlightRecorder {
+ public:
+  static constexpr auto kPathKey = "FlightRecorderPath";
+  static constexpr auto kRecordsKey = "FlightRecorderRecords";
+  static constexpr auto kTriggerMicrosKey = "FlightRecorderTriggerMicros";
+
+  static constexpr std::size_t kDefaultRecords = 65536;
+  static constexpr auto kTriggerHoldOff = std::chrono::seconds(10);
+
+  static auto Instance() -> FlightRecorder& {
+    static FlightRecorder recorder;
+    return recorder;
+  }
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  auto operator=(const FlightRecorder&) -> FlightRecorder& = delete;
+
+  ~FlightRecorder() { Stop(); }
+
+  static auto Enabled() -> bool {
+    return Instance().enabled_.load(std::memory_order_relaxed);
+  }
+
+  // FNV-1a, so a ClOrdID or session can be hashed the same way outside the
+  // server to find it in a dump.
+  static auto Hash(std::string_view text) -> std::uint32_t {
+    std::uint32_t hash{2166136261U};
+    for (auto c : text) {
+      hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619U;
+    }
+    return hash;
+  }
+
+  // Into the calling thread's ring, created on its first record.
+  static auto Record(const FlightRecord& record) -> void {
+    thread_local FlightRing* ring = Instance().NewRing();
+    ring->Push(record);
+  }
+
+  // Must be called before any thread records.
+  auto Configure(const FIX::Dictionary& settings) -> void {
+    if (!settings.has(kPathKey)) {
+      return;
+    }
+    directory_ = settings.getString(kPathKey);
+    std::filesystem::create_directories(directory_);
+    capacity_ = std::bit_ceil(
+        settings.has(kRecordsKey)
+            ? static_cast<std::size_t>(settings.getInt(kRecordsKey))
+            : kDefaultRecords);
+    if (settings.has(kTriggerMicrosKey)) {
+      trigger_nanos_ =
+          static_cast<std::uint64_t>(settings.getInt(kTriggerMicrosKey)) *
+          1000;
+    }
+
+    struct sigaction action {};
+    action.sa_handler = [](int /*signal*/) {
+      Instance().RequestDump(FlightFileHeader::Trigger::kSignal);
+    };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+
+    dump_thread_ = std::thread([this]() {
+      ThreadUtil::Place(ThreadPlacement{}, "flight");
+      Run();
+    });
+    enabled_.store(true, std::memory_order_release);
+    spdlog::info("flight recorder: {} records per thread, dumps to {}",
+                 capacity_, directory_);
+  }
+
+  auto Stop() -> void {
+    enabled_.store(false, std::memory_order_relaxed);
+    stopping_.store(true, std::memory_order_release);
+    if (dump_thread_.joinable()) {
+      dump_thread_.join();
+    }
+  }
+
+  auto NameSession(std::uint32_t session, std::string name) -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_[session] = std::move(name);
+  }
+
+  // Called as a message is sent: past the trigger, records the spike and
+  // has the rings dumped.
+  auto Finished(const FlightRecord& sent, std::uint64_t first_cycles)
+      -> void {
+    if (trigger_nanos_ == 0 || first_cycles == 0 || sent.time < first_cycles) {
+      return;
+    }
+    auto nanos = TimeUtil::CyclesToNanos(sent.time - first_cycles);
+    if (nanos <= trigger_nanos_ ||
+        TimeUtil::FastEpochNanos() <
+            hold_off_until_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto spike = sent;
+    spike.event = FlightEvent::kSpike;
+    spike.value = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(nanos / 1000, UINT32_MAX));
+    Record(spike);
+    RequestDump(FlightFileHeader::Trigger::kLatency);
+  }
+
+  // Safe from a signal handler: the dump thread picks it up.
+  auto RequestDump(FlightFileHeader::Trigger trigger) -> void {
+    trigger_.store(trigger, std::memory_order_release);
+  }
+
+ private:
+  static constexpr auto kDumpPoll = std::chrono::milliseconds(50);
+
+  FlightRecorder() = default;
+
+  auto NewRing() -> FlightRing* {
+    std::array<char, FlightThreadEntry::kNameSize> name{};
+    pthread_getname_np(pthread_self(), name.data(), name.size());
+    auto ring = std::make_unique<FlightRing>(
+        capacity_, static_cast<std::uint32_t>(syscall(SYS_gettid)),
+        name.data());
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.push_back(std::move(ring));
+    return rings_.back().get();
+  }
+
+  auto Run() -> void {
+    while (!stopping_.load(std::memory_order_acquire)) {
+      auto trigger = trigger_.exchange(FlightFileHeader::Trigger::kNone,
+                                       std::memory_order_acq_rel);
+      if (trigger == FlightFileHeader::Trigger::kNone) {
+        std::this_thread::sleep_for(kDumpPoll);
+        continue;
+      }
+      if (trigger == FlightFileHeader::Trigger::kLatency) {
+        hold_off_until_.store(
+            TimeUtil::EpochNanos() +
+                static_cast<std::uint64_t>(
+                    std::chrono::nanoseconds(kTriggerHoldOff).count()),
+            std::memory_order_relaxed);
+      }
+      Dump(trigger);
+    }
+  }
+
+  auto Dump(FlightFileHeader::Trigger trigger) -> void {
+    std::vector<const FlightRing*> rings;
+    std::map<std::uint32_t, std::string> sessions;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto& ring : rings_) {
+        rings.push_back(ring.get());
+      }
+      sessions = sessions_;
+    }
+
+    FlightFileHeader header{};
+    header.magic = FlightFileHeader::kMagic;
+    header.version = FlightFileHeader::kVersion;
+    header.record_size = sizeof(FlightRecord);
+    header.dumped_nanos = TimeUtil::EpochNanos();
+    header.pid = static_cast<std::uint32_t>(::getpid());
+    header.trigger = trigger;
+    header.session_count = static_cast<std::uint32_t>(sessions.size());
+    header.thread_count = static_cast<std::uint32_t>(rings.size());
+
+    auto path = fmt::format("{}/{}.flight", directory_, header.dumped_nanos);
+    std::ofstream out(path, std::ios::binary);
+    Write(out, header);
+    for (const auto& [session, name] : sessions) {
+      Write(out, FlightSessionEntry{
+                     session, static_cast<std::uint32_t>(name.size())});
+      out.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+
+    std::size_t total{0};
+    for (const auto* ring : rings) {
+      auto records = ring->Copy();
+      for (auto& record : records) {
+        record.time = TimeUtil::CyclesToEpochNanos(record.time);
+      }
+      FlightThreadEntry entry{};
+      entry.thread_id = ring->ThreadId();
+      entry.record_count = static_cast<std::uint32_t>(records.size());
+      ring->Name().copy(entry.name.data(), entry.name.size() - 1);
+      Write(out, entry);
+      out.write(reinterpret_cast<const char*>(records.data()),
+                static_cast<std::streamsize>(records.size() *
+                                             sizeof(FlightRecord)));
+      total += records.size();
+    }
+
+    out.close();
+    if (!out) {
+      spdlog::error("flight recorder: unable to write {}", path);
+      return;
+    }
+    spdlog::warn("flight recorder: {} records from {} threads dumped to {}",
+                 total, rings.size(), path);
+  }
+
+  template <typename T>
+  static auto Write(std::ofstream& out, const T& value) -> void {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  std::atomic<bool> enabled_{false};
+  std::string directory_;
+  std::size_t capacity_{kDefaultRecords};
+  std::uint64_t trigger_nanos_{0};
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<FlightRing>> rings_;
+  std::map<std::uint32_t, std::string> sessions_;
+
+  std::atomic<FlightFileHeader::Trigger> trigger_{
+      FlightFileHeader::Trigger::kNone};
+  std::atomic<std::uint64_t> hold_off_until_{0};
+  std::atomic<bool> stopping_{false};
+  std::thread dump_thread_;
+};
+
+// Sequential reader for one dump file.
+class FlightReader {
+ public:
+  struct Thread {
+    std::uint32_t thread_id;
+    std::string name;
+    std::vector<FlightRecord> records;
+  };
+
+  explicit FlightReader(const std::string& path)
+      : in_(path, std::ios::binary) {
+    valid_ = Read(header_) && header_.magic == FlightFileHeader::kMagic &&
+             header_.version == FlightFileHeader::kVersion &&
+             header_.record_size == sizeof(FlightRecord);
+    for (std::uint32_t index = 0; valid_ && index < header_.session_count;
+         ++index) {
+      FlightSessionEntry entry{};
+      std::string name;
+      valid_ = Read(entry) && ReadBytes(name, entry.length);
+      sessions_[entry.session] = std::move(name);
+    }
+  }
+
+  auto Valid() const -> bool { return valid_; }
+  auto Header() const -> const FlightFileHeader& { return header_; }
+  auto Sessions() const -> const std::map<std::uint32_t, std::string>& {
+    return sessions_;
+  }
+
+  // False once every thread has been read.
+  auto Next(Thread& thread) -> bool {
+    if (!valid_ || threads_read_ == header_.thread_count) {
+      return false;
+    }
+    FlightThreadEntry entry{};
+    if (!Read(entry)) {
+      return false;
+    }
+    ++threads_read_;
+    thread.thread_id = entry.thread_id;
+    thread.name.assign(entry.name.data(),
+                       std::find(entry.name.begin(), entry.name.end(), '\0'));
+    thread.records.resize(entry.record_count);
+    in_.read(reinterpret_cast<char*>(thread.records.data()),
+             static_cast<std::streamsize>(entry.record_count *
+                                          sizeof(FlightRecord)));
+    return static_cast<bool>(in_);
+  }
+
+ private:
+  template <typename T>
+  auto Read(T& value) -> bool {
+    in_.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(in_);
+  }
+
+  auto ReadBytes(std::string& bytes, std::size_t length) -> bool {
+    bytes.resize(length);
+    in_.read(bytes.data(), static_cast<std::streamsize>(length));
+    return static_cast<bool>(in_);
+  }
+
+  std::ifstream in_;
+  FlightFileHeader header_{};
+  std::map<std::uint32_t, std::string> sessions_;
+  std::uint32_t threads_read_{0};
+  bool valid_{false};
+};
+
+}  // namespace common
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// One pre-faulted, process-wide region carved out with a lock-free bump
+// pointer. Reserve() maps it from 2 MB hugepages when the kernel has them
+// (vm.nr_hugepages), otherwise from normal pages with transparent hugepages
+// requested, and touches every page up front so the hot path never faults.
+//
+// Memory handed out is never returned to the arena; BlockPool recycles it.
+class HugePageArena {
+ public:
+  static constexpr std::size_t kHugePageSize = 2UL << 20U;
+  static constexpr std::size_t kPageSize = 4096;
+
+  struct Stats {
+    std::size_t capacity;
+    std::size_t used;
+    std::size_t exhausted;
+    bool huge_pages;
+  };
+
+  static auto Global() -> HugePageArena& {
+    static HugePageArena arena;
+    return arena;
+  }
+
+  HugePageArena() = default;
+  HugePageArena(const HugePageArena&) = delete;
+  auto operator=(const HugePageArena&) -> HugePageArena& = delete;
+
+  ~HugePageArena() {
+    if (base_ != nullptr) {
+      munmap(base_, capacity_);
+    }
+  }
+
+  // Call once at startup, before any thread allocates from the arena.
+  auto Reserve(std::size_t bytes) -> bool {
+    if (base_ != nullptr || bytes == 0) {
+      return false;
+    }
+
+    auto capacity = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    auto* memory =
+        mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    huge_pages_ = memory != MAP_FAILED;
+
+    if (!huge_pages_) {
+      memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+      if (memory == MAP_FAILED) {
+        spdlog::error("arena: unable to map {} bytes: {}", capacity,
+                      std::strerror(errno));
+        return false;
+      }
+      madvise(memory, capacity, MADV_HUGEPAGE);
+    }
+
+    base_ = static_cast<std::byte*>(memory);
+    capacity_ = capacity;
+
+    for (std::size_t offset = 0; offset < capacity_; offset += kPageSize) {
+      base_[offset] = std::byte{0};
+    }
+
+    spdlog::info("arena: reserved {} MB ({})", capacity_ >> 20U,
+                 huge_pages_ ? "hugetlb" : "transparent hugepages");
+    return true;
+  }
+
+  // Returns nullptr when no arena is reserved or it is exhausted; callers
+  // fall back to the heap.
+  auto Allocate(std::size_t bytes, std::size_t alignment) -> void* {
+    if (base_ == nullptr) {
+      return nullptr;
+    }
+
+    auto used = used_.load(std::memory_order_relaxed);
+    std::size_t offset{0};
+    do {
+      offset = (used + alignment - 1) & ~(alignment - 1);
+      if (offset + bytes > capacity_) {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+    } while (!used_.compare_exchange_weak(used, offset + bytes,
+                                          std::memory_order_relaxed));
+
+    return base_ + offset;
+  }
+
+  auto Owns(const void* pointer) const -> bool {
+    const auto* bytes = static_cast<const std::byte*>(pointer);
+    return base_ != nullptr && bytes >= base_ && bytes < base_ + capacity_;
+  }
+
+  auto GetStats() const -> Stats {
+    return {capacity_, used_.load(std::memory_order_relaxed),
+            exhausted_.load(std::memory_order_relaxed), huge_pages_};
+  }
+
+ private:
+  std::byte* base_{nullptr};
+  std::size_t capacity_{0};
+  bool huge_pages_{false};
+  std::atomic<std::size_t> used_{0};
+  std::atomic<std::size_t> exhausted_{0};
+};
+
+}  // namespace common
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "quickfix/Exceptions.h"
+
+namespace common {
+
+// The parts of io_uring the uring transport uses, straight over the system
+// calls so there is no liburing to build against: one submission and one
+// completion ring, and a ring of provided receive buffers the kernel picks
+// from for multishot receives. Everything but Available() belongs to the
+// loop that owns the ring.
+class IoUring {
+ private:
+  static constexpr std::size_t kPage = 4096;
+
+ public:
+  // Whether this kernel, and whatever seccomp policy the process runs
+  // under, gives us rings with timed waits and provided buffer rings (5.19).
+  static auto Available() -> bool {
+    static const bool available = [] {
+      try {
+        IoUring ring(2);
+        ring.ProvideBuffers(1, kPage, 0);
+        return true;
+      } catch (const FIX::RuntimeError&) {
+        return false;
+      }
+    }();
+    return available;
+  }
+
+  explicit IoUring(unsigned entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      Fail("io_uring_setup");
+    }
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0 ||
+        (params.features & IORING_FEAT_NODROP) == 0) {
+      ::close(fd_);
+      throw FIX::RuntimeError("io_uring: kernel lacks timed waits");
+    }
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    single_mmap_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap_) {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+    sq_ring_ = Map(sq_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap_ ? sq_ring_ : Map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+
+    auto* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<std::uint32_t*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    auto* array = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.array);
+    for (std::uint32_t index = 0; index < sq_entries_; ++index) {
+      array[index] = index;
+    }
+
+    auto* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<std::uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~IoUring() {
+    if (buffer_ring_ != nullptr) {
+      ::munmap(buffer_ring_, buffer_ring_size_);
+      ::munmap(buffers_, buffer_count_ * buffer_size_);
+    }
+    if (sqes_ != nullptr) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && !single_mmap_) {
+      ::munmap(cq_ring_, cq_size_);
+    }
+    if (sq_ring_ != nullptr) {
+      ::munmap(sq_ring_, sq_size_);
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  IoUring(const IoUring&) = delete;
+  auto operator=(const IoUring&) -> IoUring& = delete;
+
+  // A cleared submission entry for user_data, submitting what is queued
+  // first if the ring is full. The caller fills in the rest; the kernel
+  // sees the entry at the next Enter().
+  auto Prepare(std::uint8_t opcode, int fd, std::uint64_t user_data)
+      -> io_uring_sqe& {
+    if (tail_ - Load(sq_head_) == sq_entries_) {
+      Submit(0, 0);
+      if (tail_ - Load(sq_head_) == sq_entries_) {
+        throw FIX::RuntimeError("io_uring: submission queue full while "
+                                "completions are backed up");
+      }
+    }
+    auto& sqe = sqes_[tail_ & sq_mask_];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.user_data = user_data;
+    ++tail_;
+    return sqe;
+  }
+
+  // Submits everything prepared and, with a timeout, waits up to that long
+  // for at least one completion: the only system call in a loop's pass.
+  auto Enter(int timeout_millis) -> void {
+    Submit(timeout_millis > 0 ? 1 : 0, timeout_millis);
+  }
+
+  template <typename Handle>
+  auto ForEachCompletion(Handle&& handle) -> void {
+    auto head = *cq_head_;
+    while (head != Load(cq_tail_)) {
+      // Copied out: handling it may release the slot.
+      auto cqe = cqes_[head & cq_mask_];
+      ++head;
+      std::atomic_ref<std::uint32_t>(*cq_head_).store(
+          head, std::memory_order_release);
+      handle(cqe);
+    }
+  }
+
+  // Registers count (a power of two) buffers of size bytes as buffer group
+  // group, for receives with IOSQE_BUFFER_SELECT.
+  auto ProvideBuffers(std::size_t count, std::size_t size,
+                      std::uint16_t group) -> void {
+    buffer_count_ = count;
+    buffer_size_ = size;
+    buffer_group_ = group;
+    buffer_ring_size_ =
+        (count * sizeof(io_uring_buf) + kPage - 1) & ~(kPage - 1);
+    buffer_ring_ = static_cast<io_uring_buf*>(Anonymous(buffer_ring_size_));
+    buffers_ = static_cast<char*>(Anonymous(count * size));
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<std::uint64_t>(buffer_ring_);
+    registration.ring_entries = static_cast<std::uint32_t>(count);
+    registration.bgid = group;
+    if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING,
+                  &registration, 1) < 0) {
+      Fail("io_uring provided buffers");
+    }
+    for (std::size_t id = 0; id < count; ++id) {
+      Recycle(static_cast<std::uint16_t>(id));
+    }
+  }
+
+  auto BufferGroup() const -> std::uint16_t { return buffer_group_; }
+
+  auto Buffer(std::uint16_t id) const -> const char* {
+    return buffers_ + id * buffer_size_;
+  }
+
+  // Hands a provided buffer back to the kernel once its data is consumed.
+  auto Recycle(std::uint16_t id) -> void {
+    auto& buffer = buffer_ring_[buffer_tail_ & (buffer_count_ - 1)];
+    buffer.addr = reinterpret_cast<std::uint64_t>(Buffer(id));
+    buffer.len = static_cast<std::uint32_t>(buffer_size_);
+    buffer.bid = id;
+    ++buffer_tail_;
+    // The ring's tail overlays the reserved field of its first entry.
+    std::atomic_ref<std::uint16_t>(buffer_ring_[0].resv)
+        .store(buffer_tail_, std::memory_order_release);
+  }
+
+ private:
+  static auto Load(const std::uint32_t* value) -> std::uint32_t {
+    return std::atomic_ref<std::uint32_t>(*const_cast<std::uint32_t*>(value))
+        .load(std::memory_order_acquire);
+  }
+
+  [[noreturn]] static auto Fail(const std::string& what) -> void {
+    throw FIX::RuntimeError(what + ": " + std::strerror(errno));
+  }
+
+  static auto Anonymous(std::size_t size) -> void* {
+    auto* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (memory == MAP_FAILED) {
+      Fail("io_uring buffers");
+    }
+    return memory;
+  }
+
+  auto Map(std::size_t size, off_t offset) -> void* {
+    auto* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd_, offset);
+    if (memory == MAP_FAILED) {
+      Fail("io_uring mmap");
+    }
+    return memory;
+  }
+
+  // Publishes the prepared entries, which are complete by now, and enters.
+  // The kernel refusing them for want of completion space (EBUSY, EAGAIN)
+  // leaves them queued for the next call, after the loop has reaped; any
+  // other failure means the ring is unusable.
+  auto Submit(unsigned wait, int timeout_millis) -> void {
+    std::atomic_ref<std::uint32_t>(*sq_tail_).store(tail_,
+                                                     std::memory_order_release);
+
+    __kernel_timespec timeout{};
+    timeout.tv_sec = timeout_millis / 1000;
+    timeout.tv_nsec = static_cast<long long>(timeout_millis % 1000) * 1000000;
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<std::uint64_t>(&timeout);
+
+    auto flags = IORING_ENTER_EXT_ARG | (wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+    while (true) {
+      auto submit = tail_ - Load(sq_head_);
+      if (::syscall(__NR_io_uring_enter, fd_, submit, wait, flags, &arg,
+                    sizeof(arg)) >= 0) {
+        return;
+      }
+      switch (errno) {
+        case EINTR:
+          // Only ends the wait early, unless it came before submitting.
+          if (tail_ != Load(sq_head_)) {
+            continue;
+          }
+          return;
+        case ETIME:
+        case EBUSY:
+        case EAGAIN:
+          return;
+        default:
+          Fail("io_uring_enter");
+      }
+    }
+  }
+
+  int fd_{-1};
+  bool single_mmap_{false};
+  void* sq_ring_{nullptr};
+  void* cq_ring_{nullptr};
+  std::size_t sq_size_{0};
+  std::size_t cq_size_{0};
+  io_uring_sqe* sqes_{nullptr};
+  std::size_t sqes_size_{0};
+
+  std::uint32_t* sq_head_{nullptr};
+  std::uint32_t* sq_tail_{nullptr};
+  std::uint32_t sq_mask_{0};
+  std::uint32_t sq_entries_{0};
+  std::uint32_t tail_{0};
+
+  std::uint32_t* cq_head_{nullptr};
+  std::uint32_t* cq_tail_{nullptr};
+  std::uint32_t cq_mask_{0};
+  io_uring_cqe* cqes_{nullptr};
+
+  io_uring_buf* buffer_ring_{nullptr};
+  std::size_t buffer_ring_size_{0};
+  char* buffers_{nullptr};
+  std::size_t buffer_count_{0};
+  std::size_t buffer_size_{0};
+  std::uint16_t buffer_group_{0};
+  std::uint16_t buffer_tail_{0};
+};
+
+}  // namespace common
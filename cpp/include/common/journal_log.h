@@ -0,0 +1,557 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/thread_util.h"
+#include "common/time_util.h"
+#include "quickfix/Log.h"
+#include "quickfix/SessionSettings.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+enum class JournalDirection : std::uint8_t {
+  kUnpublished = 0,
+  kIncoming = 1,
+  kOutgoing = 2,
+  kEvent = 3,
+  kSession = 4,  // payload names the session that owns the handle
+  kPadding = 5,  // ring only, never written to a file
+};
+
+// One journal entry, followed by length payload bytes padded out to
+// kRecordAlignment. Ring memory and journal files share this layout.
+struct JournalRecord {
+  static constexpr std::size_t kRecordAlignment = 16;
+
+  std::uint64_t timestamp;  // epoch nanos
+  std::uint32_t length;
+  std::uint16_t session;  // 0 is the global (session-less) log
+  std::uint8_t reserved;
+  JournalDirection direction;  // written last, publishes the record
+
+  static constexpr auto Footprint(std::size_t length) -> std::size_t {
+    return (sizeof(JournalRecord) + length + kRecordAlignment - 1) /
+           kRecordAlignment * kRecordAlignment;
+  }
+};
+
+static_assert(sizeof(JournalRecord) == JournalRecord::kRecordAlignment);
+
+struct JournalFileHeader {
+  static constexpr std::uint64_t kMagic = 0x004c4e524a584946;  // "FIXJRNL"
+  static constexpr std::uint32_t kVersion = 1;
+
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t record_alignment;
+};
+
+// Multi-producer, single-consumer byte ring of JournalRecords. Producers
+// claim space with a CAS on the tail, fill in their record and publish it by
+// storing its direction last. A record that would straddle the end of the
+// ring is preceded by a padding record, so every record is contiguous and
+// the consumer can hand runs of them to write() straight from ring memory.
+class JournalRing {
+ private:
+  static constexpr std::size_t kCacheLine = 64;
+
+ public:
+  explicit JournalRing(std::size_t capacity)
+      : capacity_(RoundUp(capacity)),
+        mask_(capacity_ - 1),
+        base_(static_cast<std::byte*>(
+            ::operator new(capacity_, std::align_val_t(kCacheLine)))) {
+    // Unpublished records read as zero; this also faults every page in.
+    std::memset(base_, 0, capacity_);
+  }
+
+  JournalRing(const JournalRing&) = delete;
+  auto operator=(const JournalRing&) -> JournalRing& = delete;
+
+  ~JournalRing() { ::operator delete(base_, std::align_val_t(kCacheLine)); }
+
+  // Producer side. Waits for the consumer while the ring is full, so nothing
+  // is lost; only a payload too big to ever fit is dropped.
+  auto Push(JournalDirection direction, std::uint16_t session,
+            std::string_view payload) -> bool {
+    auto timestamp = TimeUtil::EpochNanos();
+    auto size = JournalRecord::Footprint(payload.size());
+    if (size > capacity_ / 2) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    auto stalled{false};
+    auto tail = tail_.load(std::memory_order_relaxed);
+    std::size_t padding{0};
+    while (true) {
+      auto offset = tail & mask_;
+      padding = offset + size > capacity_ ? capacity_ - offset : 0;
+      if (tail + padding + size - head_.load(std::memory_order_acquire) >
+          capacity_) {
+        stalled = true;
+        std::this_thread::yield();
+        tail = tail_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (tail_.compare_exchange_weak(tail, tail + padding + size,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    if (stalled) {
+      stalls_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (padding != 0) {
+      Publish(tail, JournalDirection::kPadding, 0, 0, {},
+              padding - sizeof(JournalRecord));
+    }
+    Publish(tail + padding, direction, session, timestamp, payload,
+            payload.size());
+    return true;
+  }
+
+  // Consumer side. Calls sink(data, size) for each contiguous run of
+  // published records and returns the number of ring bytes consumed.
+  template <typename Sink>
+  auto Drain(Sink&& sink) -> std::size_t {
+    const auto start = head_.load(std::memory_order_relaxed);
+    auto head = start;
+    auto run = head;
+
+    auto flush = [&]() {
+      if (head > run) {
+        sink(base_ + (run & mask_), head - run);
+      }
+      run = head;
+    };
+
+    while (head - start < capacity_) {
+      auto* record = reinterpret_cast<JournalRecord*>(base_ + (head & mask_));
+      auto direction = std::atomic_ref<JournalDirection>(record->direction)
+                           .load(std::memory_order_acquire);
+      if (direction == JournalDirection::kUnpublished) {
+        break;
+      }
+
+      if (direction == JournalDirection::kPadding) {
+        flush();
+        head += JournalRecord::Footprint(record->length);
+        run = head;
+      } else {
+        head += JournalRecord::Footprint(record->length);
+      }
+
+      if ((head & mask_) == 0) {
+        flush();
+      }
+    }
+    flush();
+
+    Clear(start, head);
+    head_.store(head, std::memory_order_release);
+    return head - start;
+  }
+
+  auto Stalls() const -> std::size_t {
+    return stalls_.load(std::memory_order_relaxed);
+  }
+
+  auto Dropped() const -> std::size_t {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static auto RoundUp(std::size_t capacity) -> std::size_t {
+    std::size_t size{kCacheLine};
+    while (size < capacity) {
+      size <<= 1U;
+    }
+    return size;
+  }
+
+  auto Publish(std::size_t position, JournalDirection direction,
+               std::uint16_t session, std::uint64_t timestamp,
+               std::string_view payload, std::size_t length) -> void {
+    auto* record = reinterpret_cast<JournalRecord*>(base_ + (position & mask_));
+    record->timestamp = timestamp;
+    record->length = static_cast<std::uint32_t>(length);
+    record->session = session;
+    std::memcpy(record + 1, payload.data(), payload.size());
+    std::atomic_ref<JournalDirection>(record->direction)
+        .store(direction, std::memory_order_release);
+  }
+
+  // Zeroes consumed bytes so stale records read as unpublished on the next
+  // lap. Done before head_ moves, while no producer can claim them.
+  auto Clear(std::size_t begin, std::size_t end) -> void {
+    while (begin < end) {
+      auto offset = begin & mask_;
+      auto count = std::min(end - begin, capacity_ - offset);
+      std::memset(base_ + offset, 0, count);
+      begin += count;
+    }
+  }
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::byte* const base_;
+
+  alignas(kCacheLine) std::atomic<std::size_t> head_{0};
+  alignas(kCacheLine) std::atomic<std::size_t> tail_{0};
+  alignas(kCacheLine) std::atomic<std::size_t> stalls_{0};
+  std::atomic<std::size_t> dropped_{0};
+};
+
+// Process-wide binary message journal: sessions push raw messages into a
+// JournalRing and a background thread appends them to
+// <FileLogPath>/<epoch nanos>.journal, starting a new file once the current
+// one passes the size limit. Each file opens with a session record for every
+// known session, so it can be converted on its own.
+class Journal {
+ public:
+  Journal(std::string directory, std::size_t ring_size, std::size_t file_size,
+          const ThreadPlacement& placement)
+      : directory_(std::move(directory)),
+        file_size_(file_size),
+        ring_(ring_size),
+        sessions_{"GLOBAL"} {
+    std::filesystem::create_directories(directory_);
+    Rotate();
+    drain_thread_ = std::thread([this, placement]() {
+      ThreadUtil::Place(placement, "journal");
+      Run();
+    });
+  }
+
+  Journal(const Journal&) = delete;
+  auto operator=(const Journal&) -> Journal& = delete;
+
+  ~Journal() {
+    stopping_.store(true, std::memory_order_release);
+    drain_thread_.join();
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    spdlog::info("journal: {} bytes written, {} stalled appends, {} dropped",
+                 written_, ring_.Stalls(), ring_.Dropped());
+  }
+
+  // Returns the handle for name, registering it the first time.
+  auto Register(const std::string& name) -> std::uint16_t {
+    std::uint16_t handle{0};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto known = std::find(sessions_.begin(), sessions_.end(), name);
+      if (known != sessions_.end()) {
+        return static_cast<std::uint16_t>(known - sessions_.begin());
+      }
+      handle = static_cast<std::uint16_t>(sessions_.size());
+      sessions_.push_back(name);
+    }
+
+    // Handles are handed out in order, so this logs once.
+    if (handle == kCountedSessions) {
+      spdlog::warn("journal: more than {} sessions, messages from {} on are "
+                   "journaled but not counted",
+                   kCountedSessions - 1, name);
+    }
+
+    // Outside the lock: Push() may wait on the drain thread, which takes the
+    // lock to rotate.
+    ring_.Push(JournalDirection::kSession, handle, name);
+    return handle;
+  }
+
+  auto Append(JournalDirection direction, std::uint16_t session,
+              std::string_view payload) -> void {
+    if (session < kCountedSessions) {
+      if (direction == JournalDirection::kIncoming) {
+        counts_[session].incoming.fetch_add(1, std::memory_order_relaxed);
+      } else if (direction == JournalDirection::kOutgoing) {
+        counts_[session].outgoing.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    ring_.Push(direction, session, payload);
+  }
+
+  struct MessageCounts {
+    std::string session;
+    std::uint64_t incoming;
+    std::uint64_t outgoing;
+  };
+
+  // Messages appended so far for each registered session, up to the first
+  // kCountedSessions - 1 of them (handle 0 is the global log); Register()
+  // warns when a session past those is added.
+  auto Counts() const -> std::vector<MessageCounts> {
+    std::vector<MessageCounts> counts;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto sessions = std::min(sessions_.size(), kCountedSessions);
+    for (std::size_t handle = 1; handle < sessions; ++handle) {
+      counts.push_back(
+          {sessions_[handle],
+           counts_[handle].incoming.load(std::memory_order_relaxed),
+           counts_[handle].outgoing.load(std::memory_order_relaxed)});
+    }
+    return counts;
+  }
+
+  // Starts a new file once everything appended so far has been written.
+  auto RequestRotate() -> void {
+    rotate_.store(true, std::memory_order_release);
+  }
+
+ private:
+  static constexpr auto kIdleWait = std::chrono::milliseconds(1);
+  static constexpr std::size_t kCountedSessions = 256;
+
+  struct Counters {
+    std::atomic<std::uint64_t> incoming{0};
+    std::atomic<std::uint64_t> outgoing{0};
+  };
+
+  auto Run() -> void {
+    while (true) {
+      auto stopping = stopping_.load(std::memory_order_acquire);
+      auto drained = ring_.Drain([this](const std::byte* data,
+                                        std::size_t size) {
+        if (current_size_ >= file_size_) {
+          Rotate();
+        }
+        Write(data, size);
+      });
+
+      if (rotate_.exchange(false, std::memory_order_acq_rel)) {
+        Rotate();
+      }
+
+      if (drained == 0) {
+        if (stopping) {
+          break;
+        }
+        std::this_thread::sleep_for(kIdleWait);
+      }
+    }
+  }
+
+  auto Rotate() -> void {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+
+    path_ = directory_ + "/" + std::to_string(TimeUtil::EpochNanos()) +
+            ".journal";
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+      spdlog::error("journal: unable to open {}: {}", path_,
+                    std::strerror(errno));
+      return;
+    }
+    current_size_ = 0;
+    spdlog::info("journal: writing {}", path_);
+
+    JournalFileHeader header{JournalFileHeader::kMagic,
+                             JournalFileHeader::kVersion,
+                             JournalRecord::kRecordAlignment};
+    std::string preamble(reinterpret_cast<const char*>(&header),
+                         sizeof(header));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t handle = 1; handle < sessions_.size(); ++handle) {
+      JournalRecord record{TimeUtil::EpochNanos(),
+                           static_cast<std::uint32_t>(sessions_[handle].size()),
+                           static_cast<std::uint16_t>(handle), 0,
+                           JournalDirection::kSession};
+      preamble.append(reinterpret_cast<const char*>(&record), sizeof(record));
+      preamble.append(sessions_[handle]);
+      preamble.append(JournalRecord::Footprint(record.length) -
+                          sizeof(record) - record.length,
+                      '\0');
+    }
+    Write(reinterpret_cast<const std::byte*>(preamble.data()),
+          preamble.size());
+  }
+
+  auto Write(const std::byte* data, std::size_t size) -> void {
+    while (fd_ >= 0 && size > 0) {
+      auto written = ::write(fd_, data, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        spdlog::error("journal: write to {} failed: {}", path_,
+                      std::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return;
+      }
+      data += written;
+      size -= static_cast<std::size_t>(written);
+      current_size_ += static_cast<std::size_t>(written);
+      written_ += static_cast<std::size_t>(written);
+    }
+  }
+
+  const std::string directory_;
+  const std::size_t file_size_;
+  JournalRing ring_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> sessions_;
+  std::array<Counters, kCountedSessions> counts_;
+
+  // Owned by the drain thread.
+  std::string path_;
+  int fd_{-1};
+  std::size_t current_size_{0};
+  std::size_t written_{0};
+
+  std::atomic<bool> rotate_{false};
+  std::atomic<bool> stopping_{false};
+  std::thread drain_thread_;
+};
+
+class JournalLog : public FIX::Log {
+ public:
+  JournalLog(Journal& journal, std::string name)
+      : journal_(journal),
+        name_(std::move(name)),
+        session_(journal.Register(name_)) {}
+
+  // The journal is append-only; clear() is a no-op and backup() starts a new
+  // file.
+  auto clear() -> void override {}
+  auto backup() -> void override { journal_.RequestRotate(); }
+
+  auto onIncoming(const std::string& message) -> void override {
+    journal_.Append(JournalDirection::kIncoming, session_, message);
+  }
+
+  auto onOutgoing(const std::string& message) -> void override {
+    journal_.Append(JournalDirection::kOutgoing, session_, message);
+  }
+
+  // Session events are rare and worth seeing, so they still reach the
+  // console as well as the journal.
+  auto onEvent(const std::string& event) -> void override {
+    journal_.Append(JournalDirection::kEvent, session_, event);
+    spdlog::info("{}: {}", name_, event);
+  }
+
+ private:
+  Journal& journal_;
+  std::string name_;
+  std::uint16_t session_;
+};
+
+// Replacement for FIX::ScreenLogFactory / FIX::FileLogFactory. [DEFAULT]
+// settings:
+//
+//   FileLogPath=/path      directory for <epoch nanos>.journal files
+//   JournalRingMB=16       in-memory ring between sessions and the writer
+//   JournalFileMB=1024     size at which a new file is started
+//
+// The writer thread is placed with JournalThreadCpu (see thread_util.h).
+// Convert a journal back to FileLog text with fix_journal.
+class JournalLogFactory : public FIX::LogFactory {
+ public:
+  static constexpr auto kFileLogPath = "FileLogPath";
+  static constexpr auto kJournalRingMB = "JournalRingMB";
+  static constexpr auto kJournalFileMB = "JournalFileMB";
+
+  static constexpr std::size_t kDefaultRingMB = 16;
+  static constexpr std::size_t kDefaultFileMB = 1024;
+
+  JournalLogFactory(const FIX::SessionSettings& settings,
+                    const ThreadPlacement& placement)
+      : journal_(settings.get().getString(kFileLogPath),
+                 GetMB(settings.get(), kJournalRingMB, kDefaultRingMB),
+                 GetMB(settings.get(), kJournalFileMB, kDefaultFileMB),
+                 placement) {}
+
+  auto create() -> FIX::Log* override {
+    return new JournalLog(journal_, "GLOBAL");
+  }
+
+  // Named like FileLog's files so converted output lines up with them.
+  auto create(const FIX::SessionID& session_id) -> FIX::Log* override {
+    return new JournalLog(journal_,
+                          session_id.getBeginString().getValue() + "-" +
+                              session_id.getSenderCompID().getValue() + "-" +
+                              session_id.getTargetCompID().getValue());
+  }
+
+  auto destroy(FIX::Log* log) -> void override { delete log; }
+
+  auto Counts() const -> std::vector<Journal::MessageCounts> {
+    return journal_.Counts();
+  }
+
+ private:
+  static auto GetMB(const FIX::Dictionary& settings, const std::string& key,
+                    std::size_t fallback) -> std::size_t {
+    return (settings.has(key) ? static_cast<std::size_t>(settings.getInt(key))
+                              : fallback)
+           << 20U;
+  }
+
+  Journal journal_;
+};
+
+// Sequential reader for one journal file.
+class JournalReader {
+ public:
+  explicit JournalReader(const std::string& path)
+      : stream_(path, std::ios::binary) {
+    JournalFileHeader header{};
+    stream_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    valid_ = stream_ && header.magic == JournalFileHeader::kMagic &&
+             header.version == JournalFileHeader::kVersion &&
+             header.record_alignment == JournalRecord::kRecordAlignment;
+  }
+
+  auto Valid() const -> bool { return valid_; }
+
+  // False at the end of the file or on a truncated final record.
+  auto Next(JournalRecord& record, std::string& payload) -> bool {
+    if (!valid_ ||
+        !stream_.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+      return false;
+    }
+
+    payload.resize(JournalRecord::Footprint(record.length) - sizeof(record));
+    if (!stream_.read(payload.data(),
+                      static_cast<std::streamsize>(payload.size()))) {
+      return false;
+    }
+    payload.resize(record.length);
+    return true;
+  }
+
+ private:
+  std::ifstream stream_;
+  bool valid_{false};
+};
+
+}  // namespace common
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace common {
+
+// Nanosecond durations counted in log-linear buckets: eight per power of
+// two, so a percentile read back is within 12.5% of the value recorded.
+// Record() takes a few relaxed atomic adds and can be called from any
+// thread; Snapshot() reads the counts from another while it does.
+class LatencyHistogram {
+ private:
+  static constexpr unsigned kSubBits = 3;
+  static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBits;
+
+ public:
+  static constexpr std::size_t kBucketCount =
+      (64 - kSubBits + 1) * kSubBuckets;
+
+  // The counts at one moment, not necessarily all from the same record.
+  struct Counts {
+    std::array<std::uint64_t, kBucketCount> buckets{};
+    std::uint64_t count{0};
+    std::uint64_t sum{0};
+    std::uint64_t max{0};
+
+    auto Mean() const -> std::uint64_t { return count == 0 ? 0 : sum / count; }
+
+    // The upper bound of the bucket holding the given fraction (0 to 1) of
+    // the records.
+    auto Percentile(double fraction) const -> std::uint64_t {
+      std::uint64_t total{0};
+      for (auto count_in : buckets) {
+        total += count_in;
+      }
+      if (total == 0) {
+        return 0;
+      }
+      auto rank = static_cast<std::uint64_t>(
+          fraction * static_cast<double>(total - 1));
+      std::uint64_t seen{0};
+      for (std::size_t index = 0; index < kBucketCount; ++index) {
+        seen += buckets[index];
+        if (seen > rank) {
+          return std::min(UpperBound(index), max);
+        }
+      }
+      return max;
+    }
+
+    // Adds other's records, e.g. to report several histograms as one.
+    auto Merge(const Counts& other) -> void {
+      for (std::size_t index = 0; index < kBucketCount; ++index) {
+        buckets[index] += other.buckets[index];
+      }
+      count += other.count;
+      sum += other.sum;
+      max = std::max(max, other.max);
+    }
+  };
+
+  auto Record(std::uint64_t nanos) -> void {
+    buckets_[Bucket(nanos)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(nanos, std::memory_order_relaxed);
+    auto max = max_.load(std::memory_order_relaxed);
+    while (nanos > max &&
+           !max_.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+    }
+  }
+
+  auto Snapshot() const -> Counts {
+    Counts counts;
+    for (std::size_t index = 0; index < kBucketCount; ++index) {
+      counts.buckets[index] = buckets_[index].load(std::memory_order_relaxed);
+    }
+    counts.count = count_.load(std::memory_order_relaxed);
+    counts.sum = sum_.load(std::memory_order_relaxed);
+    counts.max = max_.load(std::memory_order_relaxed);
+    return counts;
+  }
+
+  static auto Bucket(std::uint64_t nanos) -> std::size_t {
+    if (nanos < kSubBuckets) {
+      return static_cast<std::size_t>(nanos);
+    }
+    auto top = static_cast<unsigned>(std::bit_width(nanos)) - 1;
+    auto sub = (nanos >> (top - kSubBits)) & (kSubBuckets - 1);
+    return (top - kSubBits + 1) * kSubBuckets + static_cast<std::size_t>(sub);
+  }
+
+  // The largest value that falls in bucket index.
+  static auto UpperBound(std::size_t index) -> std::uint64_t {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    auto top = static_cast<unsigned>(index / kSubBuckets) + kSubBits - 1;
+    auto sub = static_cast<std::uint64_t>(index % kSubBuckets);
+    auto width = std::uint64_t{1} << (top - kSubBits);
+    return ((kSubBuckets + sub) << (top - kSubBits)) + (width - 1);
+  }
+
+ private:
+  std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
+
+}  // namespace common
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "common/latency_histogram.h"
+#include "common/time_util.h"
+#include "spdlog/spdlog.h"
+
+// Set by the LATENCY_TRACE CMake option.
+#ifndef COMMON_LATENCY_TRACE
+#define COMMON_LATENCY_TRACE 0
+#endif
+
+namespace common {
+
+// The points an order passes on its way through the server.
+enum class TraceStage : std::uint8_t {
+  kReceived,    // framed by the event loop, before Session::next()
+  kEnqueued,    // onto the event queue, after any throttle hold
+  kDequeued,    // the queue listener runs
+  kHandling,    // the book worker takes it off its ring
+  kHandled,     // the response is posted to the sender
+  kSending,     // the sender takes the response off the worker's ring
+  kSerialized,  // the response is encoded (DirectSender only)
+  kSent,        // handed to the connection
+  kCount,
+};
+
+inline auto TraceStageName(TraceStage stage) -> const char* {
+  switch (stage) {
+    case TraceStage::kReceived:
+      return "received";
+    case TraceStage::kEnqueued:
+      return "enqueued";
+    case TraceStage::kDequeued:
+      return "dequeued";
+    case TraceStage::kHandling:
+      return "handling";
+    case TraceStage::kHandled:
+      return "handled";
+    case TraceStage::kSending:
+      return "sending";
+    case TraceStage::kSerialized:
+      return "serialized";
+    case TraceStage::kSent:
+      return "sent";
+    case TraceStage::kCount:
+      break;
+  }
+  return "unknown";
+}
+
+// Cycle stamps, see TimeUtil::Cycles(), taken as one message moves along,
+// carried with it (in its PooledFrame) from thread to thread. With
+// COMMON_LATENCY_TRACE off it is empty and Stamp() compiles to nothing.
+class LatencyTrace {
+ public:
+  static constexpr bool kEnabled = COMMON_LATENCY_TRACE != 0;
+  static constexpr auto kStageCount =
+      static_cast<std::size_t>(TraceStage::kCount);
+
+  auto Stamp(TraceStage stage) -> void {
+    if constexpr (kEnabled) {
+      stamps_.Set(stage, TimeUtil::Cycles());
+    }
+  }
+
+  auto Stamp(TraceStage stage, std::uint64_t cycles) -> void {
+    stamps_.Set(stage, cycles);
+  }
+
+  // 0 for a stage the message has not passed, or skipped.
+  auto At(TraceStage stage) const -> std::uint64_t {
+    return stamps_.Get(stage);
+  }
+
+ private:
+  struct Stamps {
+    auto Set(TraceStage stage, std::uint64_t cycles) -> void {
+      at[static_cast<std::size_t>(stage)] = cycles;
+    }
+    auto Get(TraceStage stage) const -> std::uint64_t {
+      return at[static_cast<std::size_t>(stage)];
+    }
+
+    std::array<std::uint64_t, kStageCount> at{};
+  };
+
+  struct NoStamps {
+    auto Set(TraceStage /*stage*/, std::uint64_t /*cycles*/) -> void {}
+    auto Get(TraceStage /*stage*/) const -> std::uint64_t { return 0; }
+  };
+
+  [[no_unique_address]] std::conditional_t<kEnabled, Stamps, NoStamps>
+      stamps_;
+};
+
+// Per-interval histograms of every finished trace, logged on shutdown and
+// readable at any time with Snapshot().
+class LatencyStats {
+ public:
+  enum class Interval : std::uint8_t {
+    kReceive,       // kReceived to kEnqueued: session, crack, throttle
+    kQueueWait,     // kEnqueued to kDequeued
+    kDispatch,      // kDequeued to kHandling: routing and the worker's ring
+    kHandler,       // kHandling to kHandled
+    kOutboundWait,  // kHandled to kSending
+    kSerialize,     // kSending to kSerialized
+    kSend,          // kSerialized to kSent
+    kTotal,         // the first stamp to kSent
+    kCount,
+  };
+
+  static constexpr auto kIntervalCount =
+      static_cast<std::size_t>(Interval::kCount);
+
+  static auto IntervalName(Interval interval) -> const char* {
+    switch (interval) {
+      case Interval::kReceive:
+        return "receive";
+      case Interval::kQueueWait:
+        return "queue wait";
+      case Interval::kDispatch:
+        return "dispatch";
+      case Interval::kHandler:
+        return "handler";
+      case Interval::kOutboundWait:
+        return "outbound wait";
+      case Interval::kSerialize:
+        return "serialize";
+      case Interval::kSend:
+        return "send";
+      case Interval::kTotal:
+        return "total";
+      case Interval::kCount:
+        break;
+    }
+    return "unknown";
+  }
+
+  // Called once the message is sent; intervals missing a stamp at either
+  // end are left out.
+  static auto Record(const LatencyTrace& trace) -> void {
+    if constexpr (LatencyTrace::kEnabled) {
+      auto& histograms = Histograms();
+      for (std::size_t index = 0; index + 1 < kIntervalCount; ++index) {
+        auto from = trace.At(static_cast<TraceStage>(index));
+        auto to = trace.At(static_cast<TraceStage>(index + 1));
+        if (from != 0 && to >= from) {
+          histograms[index].Record(TimeUtil::CyclesToNanos(to - from));
+        }
+      }
+
+      auto sent = trace.At(TraceStage::kSent);
+      auto first = trace.At(TraceStage::kReceived);
+      if (first == 0) {
+        first = trace.At(TraceStage::kEnqueued);
+      }
+      if (first != 0 && sent >= first) {
+        histograms[static_cast<std::size_t>(Interval::kTotal)].Record(
+            TimeUtil::CyclesToNanos(sent - first));
+      }
+    }
+  }
+
+  static auto Snapshot(Interval interval) -> LatencyHistogram::Counts {
+    return Histograms()[static_cast<std::size_t>(interval)].Snapshot();
+  }
+
+  static auto LogStats() -> void {
+    if constexpr (LatencyTrace::kEnabled) {
+      for (std::size_t index = 0; index < kIntervalCount; ++index) {
+        auto interval = static_cast<Interval>(index);
+        auto counts = Snapshot(interval);
+        spdlog::info(
+            "latency {}: {} traced, mean {} ns, p50 {} ns, p99 {} ns, "
+            "p99.9 {} ns, max {} ns",
+            IntervalName(interval), counts.count, counts.Mean(),
+            counts.Percentile(0.5), counts.Percentile(0.99),
+            counts.Percentile(0.999), counts.max);
+      }
+    }
+  }
+
+ private:
+  static auto Histograms()
+      -> std::array<LatencyHistogram, kIntervalCount>& {
+    static std::array<LatencyHistogram, kIntervalCount> histograms;
+    return histograms;
+  }
+};
+
+}  // namespace common
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/thread_util.h"
+#include "common/transport_config.h"
+#include "quickfix/Acceptor.h"
+#include "quickfix/Session.h"
+#include "quickfix/SessionSettings.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// A FIX::Acceptor that spreads its connections over N event loops
+// (EventLoops / EventLoopCpus) of type Loop, EventLoop or UringLoop, in
+// place of QuickFIX's single-threaded SocketAcceptor, with the same
+// Application callbacks. The acceptor's own thread (placed like the I/O
+// thread) only accepts, handing each connection to the loop with the fewest.
+//
+// Sessions send through BatchedConnection and each loop batches its own
+// output, so the responses to everything read in one pass of a loop go out
+// in one write per connection.
+//
+// Reads SocketAcceptPort, SocketReuseAddress and SocketNodelay like
+// SocketAcceptor does: the first session on a port sets that port's options.
+template <typename Loop>
+class LoopAcceptor : public FIX::Acceptor {
+ private:
+  static constexpr int kMaxEvents = 16;
+  static constexpr int kWaitMillis = 100;
+  static constexpr int kBacklog = 128;
+  // How soon a listener that ran out of descriptors is tried again.
+  static constexpr int kRetryMillis = 10;
+
+ public:
+  LoopAcceptor(FIX::Application& application,
+               FIX::MessageStoreFactory& store_factory,
+               const FIX::SessionSettings& settings,
+               FIX::LogFactory& log_factory, const TransportConfig& config,
+               const ThreadConfig& threads)
+      : FIX::Acceptor(application, store_factory, settings, log_factory),
+        config_(config),
+        threads_(threads) {}
+
+  ~LoopAcceptor() override {
+    StopLoops();
+    CloseListeners();
+  }
+
+ private:
+  struct PortOptions {
+    bool reuse_address{true};
+    bool no_delay{true};
+  };
+
+  auto onConfigure(const FIX::SessionSettings& settings)
+      EXCEPT(FIX::ConfigError) -> void override {
+    for (const auto& session_id : settings.getSessions()) {
+      const auto& dictionary = settings.get(session_id);
+      PortOptions options;
+      options.reuse_address = !dictionary.has(FIX::SOCKET_REUSE_ADDRESS) ||
+                              dictionary.getBool(FIX::SOCKET_REUSE_ADDRESS);
+      options.no_delay = !dictionary.has(FIX::SOCKET_NODELAY) ||
+                         dictionary.getBool(FIX::SOCKET_NODELAY);
+      auto port = dictionary.getInt(FIX::SOCKET_ACCEPT_PORT);
+      auto [it, added] = ports_.emplace(port, options);
+      if (!added && (it->second.reuse_address != options.reuse_address ||
+                     it->second.no_delay != options.no_delay)) {
+        spdlog::warn("{}: socket options differ from the port's first "
+                     "session, port {} keeps the first",
+                     session_id.toString(), port);
+      }
+    }
+  }
+
+  auto onInitialize(const FIX::SessionSettings& /*settings*/)
+      EXCEPT(FIX::RuntimeError) -> void override {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+      throw FIX::RuntimeError(std::string("epoll: ") + std::strerror(errno));
+    }
+    Watch(wake_fd_, EPOLLIN);
+
+    for (const auto& [port, options] : ports_) {
+      auto fd = Listen(port, options);
+      listeners_.emplace(fd, options);
+      Watch(fd, EPOLLIN | EPOLLET);
+    }
+
+    auto count = config_.event_loops > 0
+                     ? config_.event_loops
+                     : std::max<std::size_t>(threads_.loops.size(), 1);
+    auto lookup = [this](const std::string& message,
+                         FIX::Responder& responder) {
+      return getSession(message, responder);
+    };
+    for (std::size_t index = 0; index < count; ++index) {
+      loops_.push_back(std::make_unique<Loop>(
+          "loop-" + std::to_string(index), lookup, config_));
+    }
+    spdlog::info("{} acceptor: {} event loops", Loop::kKind, count);
+  }
+
+  auto onStart() -> void override {
+    ThreadUtil::Place(threads_.io, "acceptor");
+    for (std::size_t index = 0; index < loops_.size(); ++index) {
+      loops_[index]->Start(threads_.Loop(index));
+    }
+
+    while (!isStopped()) {
+      Poll(kWaitMillis);
+    }
+
+    StopLoops();
+    CloseListeners();
+  }
+
+  // Without threads: one pass over the listeners and every loop.
+  auto onPoll() -> bool override {
+    if (isStopped()) {
+      for (auto& loop : loops_) {
+        loop->CloseAll();
+      }
+      CloseListeners();
+      return false;
+    }
+
+    Poll(0);
+    for (auto& loop : loops_) {
+      loop->Poll(0);
+    }
+    return true;
+  }
+
+  auto onStop() -> void override {
+    std::uint64_t wake{1};
+    static_cast<void>(::write(wake_fd_, &wake, sizeof(wake)));
+  }
+
+  auto Listen(int port, const PortOptions& options) -> int {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+
+    auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on{1};
+    if (fd >= 0 && options.reuse_address) {
+      ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (fd < 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+            0 ||
+        ::listen(fd, kBacklog) < 0) {
+      throw FIX::RuntimeError("unable to listen on port " +
+                              std::to_string(port) + ": " +
+                              std::strerror(errno));
+    }
+    spdlog::info("{} acceptor listening on port {}", Loop::kKind, port);
+    return fd;
+  }
+
+  auto Watch(int fd, std::uint32_t events) -> void {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  }
+
+  auto Poll(int timeout_millis) -> void {
+    if (!retry_.empty()) {
+      timeout_millis = std::min(timeout_millis, kRetryMillis);
+    }
+    std::array<epoll_event, kMaxEvents> events{};
+    auto count =
+        ::epoll_wait(epoll_fd_, events.data(), kMaxEvents, timeout_millis);
+    // The listeners are edge-triggered, so a backlog left behind by a failed
+    // accept raises no new event; go back for it.
+    auto retry = std::move(retry_);
+    retry_.clear();
+    for (auto fd : retry) {
+      Accept(fd);
+    }
+    for (int i = 0; i < count; ++i) {
+      auto fd = events[i].data.fd;
+      if (fd == wake_fd_) {
+        std::uint64_t wake{0};
+        static_cast<void>(::read(wake_fd_, &wake, sizeof(wake)));
+      } else {
+        Accept(fd);
+      }
+    }
+  }
+
+  auto Accept(int listener) -> void {
+    while (true) {
+      auto fd =
+          ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        auto error = errno;
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+          backlogged_.erase(listener);
+          return;
+        }
+        // Interrupted, or a connection that failed before it was accepted.
+        if (error == EINTR || error == ECONNABORTED || error == EPROTO) {
+          continue;
+        }
+        // Out of descriptors or memory: the backlog stays queued until the
+        // next retry. Logged once per run of failures.
+        if (std::find(retry_.begin(), retry_.end(), listener) ==
+            retry_.end()) {
+          if (backlogged_.insert(listener).second) {
+            spdlog::warn("{} acceptor: accept failed, retrying: {}",
+                         Loop::kKind, std::strerror(error));
+          }
+          retry_.push_back(listener);
+        }
+        return;
+      }
+      backlogged_.erase(listener);
+
+      if (listeners_.at(listener).no_delay) {
+        int on{1};
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      }
+      auto& loop = *std::min_element(
+          loops_.begin(), loops_.end(), [](const auto& a, const auto& b) {
+            return a->PeerCount() < b->PeerCount();
+          });
+      loop->Adopt(fd);
+    }
+  }
+
+  auto StopLoops() -> void {
+    for (auto& loop : loops_) {
+      loop->Stop();
+    }
+  }
+
+  auto CloseListeners() -> void {
+    for (const auto& [fd, options] : listeners_) {
+      ::close(fd);
+    }
+    listeners_.clear();
+    retry_.clear();
+    backlogged_.clear();
+    for (auto* fd : {&wake_fd_, &epoll_fd_}) {
+      if (*fd >= 0) {
+        ::close(*fd);
+        *fd = -1;
+      }
+    }
+  }
+
+  TransportConfig config_;
+  ThreadConfig threads_;
+  std::map<int, PortOptions> ports_;
+
+  int epoll_fd_{-1};
+  int wake_fd_{-1};
+  std::map<int, PortOptions> listeners_;
+  // Listeners whose last accept failed, and those to try again next Poll().
+  std::set<int> backlogged_;
+  std::vector<int> retry_;
+  std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+}  // namespace common
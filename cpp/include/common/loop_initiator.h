@@ -0,0 +1,269 @@
+#pragma once
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/thread_util.h"
+#include "common/time_util.h"
+#include "common/transport_config.h"
+#include "quickfix/Initiator.h"
+#include "quickfix/Session.h"
+#include "quickfix/SessionSettings.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// The initiating side of LoopAcceptor: a FIX::Initiator whose sessions run
+// on event loops of type Loop, EventLoop or UringLoop, in place of
+// QuickFIX's SocketInitiator. The initiator's own thread (placed like the
+// I/O thread) only connects: each connection is opened non-blocking and,
+// once established, handed to the loop with the fewest, which sends the
+// logon. Sessions whose connection drops are reconnected every
+// ReconnectInterval seconds (default 30).
+//
+// Reads SocketConnectHost, SocketConnectPort and SocketNodelay like
+// SocketInitiator does.
+template <typename Loop>
+class LoopInitiator : public FIX::Initiator {
+ private:
+  static constexpr int kMaxEvents = 16;
+  static constexpr int kWaitMillis = 100;
+  static constexpr std::uint64_t kDefaultReconnectSeconds = 30;
+  static constexpr std::uint64_t kWakeFd = ~std::uint64_t{0};
+
+ public:
+  LoopInitiator(FIX::Application& application,
+                FIX::MessageStoreFactory& store_factory,
+                const FIX::SessionSettings& settings,
+                FIX::LogFactory& log_factory, const TransportConfig& config,
+                const ThreadConfig& threads)
+      : FIX::Initiator(application, store_factory, settings, log_factory),
+        config_(config),
+        threads_(threads) {}
+
+  ~LoopInitiator() override {
+    StopLoops();
+    Close();
+  }
+
+ private:
+  auto onConfigure(const FIX::SessionSettings& settings)
+      EXCEPT(FIX::ConfigError) -> void override {
+    const auto& defaults = settings.get();
+    if (defaults.has(FIX::RECONNECT_INTERVAL)) {
+      reconnect_nanos_ =
+          static_cast<std::uint64_t>(defaults.getInt(FIX::RECONNECT_INTERVAL)) *
+          1000000000;
+    }
+    no_delay_ = !defaults.has(FIX::SOCKET_NODELAY) ||
+                defaults.getBool(FIX::SOCKET_NODELAY);
+  }
+
+  auto onInitialize(const FIX::SessionSettings& /*settings*/)
+      EXCEPT(FIX::RuntimeError) -> void override {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+      throw FIX::RuntimeError(std::string("epoll: ") + std::strerror(errno));
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kWakeFd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+    auto count = config_.event_loops > 0
+                     ? config_.event_loops
+                     : std::max<std::size_t>(threads_.loops.size(), 1);
+    // Initiator sessions are attached on connect, never looked up.
+    auto lookup = [](const std::string&, FIX::Responder&) -> FIX::Session* {
+      return nullptr;
+    };
+    auto disconnected = [this](const FIX::SessionID& session_id) {
+      setDisconnected(session_id);
+    };
+    for (std::size_t index = 0; index < count; ++index) {
+      loops_.push_back(std::make_unique<Loop>(
+          "loop-" + std::to_string(index), lookup, config_, disconnected));
+    }
+    spdlog::info("{} initiator: {} event loops", Loop::kKind, count);
+  }
+
+  auto onStart() -> void override {
+    ThreadUtil::Place(threads_.io, "initiator");
+    for (std::size_t index = 0; index < loops_.size(); ++index) {
+      loops_[index]->Start(threads_.Loop(index));
+    }
+
+    while (!isStopped()) {
+      Poll(kWaitMillis);
+    }
+
+    StopLoops();
+    Close();
+  }
+
+  // Without threads: one pass over the connects in progress and every loop.
+  auto onPoll() -> bool override {
+    if (isStopped()) {
+      for (auto& loop : loops_) {
+        loop->CloseAll();
+      }
+      Close();
+      return false;
+    }
+
+    Poll(0);
+    for (auto& loop : loops_) {
+      loop->Poll(0);
+    }
+    return true;
+  }
+
+  auto onStop() -> void override {
+    std::uint64_t wake{1};
+    static_cast<void>(::write(wake_fd_, &wake, sizeof(wake)));
+  }
+
+  // Called by FIX::Initiator::connect() for each disconnected session.
+  auto doConnect(const FIX::SessionID& session_id,
+                 const FIX::Dictionary& settings) -> void override {
+    auto host = settings.getString(FIX::SOCKET_CONNECT_HOST);
+    auto port = std::to_string(settings.getInt(FIX::SOCKET_CONNECT_PORT));
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses{nullptr};
+    if (auto error = ::getaddrinfo(host.c_str(), port.c_str(), &hints,
+                                   &addresses);
+        error != 0) {
+      spdlog::warn("{}: cannot resolve {}: {}", session_id.toString(), host,
+                   ::gai_strerror(error));
+      return;
+    }
+    std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> owned(
+        addresses, &::freeaddrinfo);
+
+    auto fd = ::socket(addresses->ai_family,
+                       SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        (::connect(fd, addresses->ai_addr, addresses->ai_addrlen) < 0 &&
+         errno != EINPROGRESS)) {
+      spdlog::warn("{}: cannot connect to {}:{}: {}", session_id.toString(),
+                   host, port, std::strerror(errno));
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      return;
+    }
+    if (no_delay_) {
+      int on{1};
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    setPending(session_id);
+    connecting_.emplace(fd, session_id);
+    epoll_event event{};
+    event.events = EPOLLOUT | EPOLLET;
+    event.data.u64 = static_cast<std::uint64_t>(fd);
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  }
+
+  auto Poll(int timeout_millis) -> void {
+    auto now = TimeUtil::EpochNanos();
+    if (now - last_connect_ >= reconnect_nanos_) {
+      last_connect_ = now;
+      connect();
+    }
+
+    std::array<epoll_event, kMaxEvents> events{};
+    auto count =
+        ::epoll_wait(epoll_fd_, events.data(), kMaxEvents, timeout_millis);
+    for (int i = 0; i < count; ++i) {
+      if (events[i].data.u64 == kWakeFd) {
+        std::uint64_t wake{0};
+        static_cast<void>(::read(wake_fd_, &wake, sizeof(wake)));
+      } else {
+        Connected(static_cast<int>(events[i].data.u64));
+      }
+    }
+  }
+
+  // A connect in progress finished, one way or the other.
+  auto Connected(int fd) -> void {
+    auto found = connecting_.find(fd);
+    if (found == connecting_.end()) {
+      return;
+    }
+    auto session_id = found->second;
+    connecting_.erase(found);
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+
+    int error{0};
+    socklen_t length = sizeof(error);
+    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+      spdlog::warn("{}: connect failed: {}", session_id.toString(),
+                   std::strerror(error));
+      ::close(fd);
+      setDisconnected(session_id);
+      return;
+    }
+
+    setConnected(session_id);
+    auto& loop = *std::min_element(
+        loops_.begin(), loops_.end(), [](const auto& a, const auto& b) {
+          return a->PeerCount() < b->PeerCount();
+        });
+    loop->Adopt(fd, [this, session_id](FIX::Responder& responder) {
+      return getSession(session_id, responder);
+    });
+  }
+
+  auto StopLoops() -> void {
+    for (auto& loop : loops_) {
+      loop->Stop();
+    }
+  }
+
+  auto Close() -> void {
+    for (auto& [fd, session_id] : connecting_) {
+      ::close(fd);
+    }
+    connecting_.clear();
+    for (auto* fd : {&wake_fd_, &epoll_fd_}) {
+      if (*fd >= 0) {
+        ::close(*fd);
+        *fd = -1;
+      }
+    }
+  }
+
+  TransportConfig config_;
+  ThreadConfig threads_;
+  std::uint64_t reconnect_nanos_{kDefaultReconnectSeconds * 1000000000};
+  bool no_delay_{true};
+  std::uint64_t last_connect_{0};
+
+  int epoll_fd_{-1};
+  int wake_fd_{-1};
+  std::map<int, FIX::SessionID> connecting_;
+  std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+}  // namespace common
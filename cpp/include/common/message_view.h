@@ -0,0 +1,181 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "common/compiled_dictionary.h"
+#include "common/decimal.h"
+#include "common/fix_framing.h"
+#include "quickfix/Message.h"
+
+namespace common {
+
+// One field of a MessageView: its tag, the struct member it is stored in and
+// whether the message must carry it. The member's type picks the conversion:
+// std::string_view (borrowed from the message), char, bool, Decimal, any
+// arithmetic type, or std::optional of one of those for fields that may be
+// absent.
+template <int Tag, auto Member, bool Required = true>
+struct ViewField {
+  static constexpr int kTag = Tag;
+  static constexpr bool kRequired = Required;
+
+  template <typename Struct>
+  static auto Assign(std::string_view value, Struct& out) -> bool {
+    return Convert(value, out.*Member);
+  }
+
+ private:
+  template <typename T>
+  static auto Convert(std::string_view value, std::optional<T>& out) -> bool {
+    T converted{};
+    if (!Convert(value, converted)) {
+      return false;
+    }
+    out = converted;
+    return true;
+  }
+
+  static auto Convert(std::string_view value, std::string_view& out) -> bool {
+    out = value;
+    return true;
+  }
+
+  static auto Convert(std::string_view value, char& out) -> bool {
+    if (value.size() != 1) {
+      return false;
+    }
+    out = value[0];
+    return true;
+  }
+
+  static auto Convert(std::string_view value, Decimal& out) -> bool {
+    auto parsed = Decimal::Parse(value);
+    if (!parsed) {
+      return false;
+    }
+    out = *parsed;
+    return true;
+  }
+
+  static auto Convert(std::string_view value, bool& out) -> bool {
+    if (value != "Y" && value != "N") {
+      return false;
+    }
+    out = value == "Y";
+    return true;
+  }
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_arithmetic_v<T> &&
+                                        !std::is_same_v<T, bool> &&
+                                        !std::is_same_v<T, char>>>
+  static auto Convert(std::string_view value, T& out) -> bool {
+    const auto* end = value.data() + value.size();
+    std::from_chars_result result{};
+    if constexpr (std::is_floating_point_v<T>) {
+      result = std::from_chars(value.data(), end, out,
+                               std::chars_format::fixed);
+    } else {
+      result = std::from_chars(value.data(), end, out);
+    }
+    return !value.empty() && result.ec == std::errc() && result.ptr == end;
+  }
+};
+
+// Extracts a fixed set of fields into a plain struct in one pass over a
+// message body, instead of one FieldMap lookup and FIX::Field conversion per
+// field. Nothing throws: a missing required field or a value that does not
+// convert comes back as a ValidationResult naming the tag. Members for fields
+// the message does not carry keep whatever value they had.
+//
+//   using View = MessageView<Order, ViewField<FIX::FIELD::Symbol,
+//                                             &Order::symbol>, ...>;
+//   Order order{};
+//   if (auto result = View::Parse(message, order); !result) { ... }
+//
+// string_view members point into message and are valid as long as it is.
+// Parse() also reads a message's received bytes in place (see PooledFrame),
+// header and trailer included, so the tags should be ones that appear once
+// and outside repeating groups.
+template <typename Struct, typename... Fields>
+class MessageView {
+ private:
+  static_assert(sizeof...(Fields) <= 64, "MessageView holds up to 64 fields");
+
+  template <std::size_t Index>
+  static constexpr auto Bit() -> std::uint64_t {
+    return std::uint64_t{1} << Index;
+  }
+
+ public:
+  static auto Parse(const FIX::FieldMap& message, Struct& out)
+      -> ValidationResult {
+    std::uint64_t seen{0};
+    for (const auto& field : message) {
+      auto tag = field.getTag();
+      if (!Assign(tag, field.getString(), out, seen,
+                  std::index_sequence_for<Fields...>{})) {
+        return {ValidationError::kIncorrectDataFormat, tag};
+      }
+    }
+    return Check(seen, std::index_sequence_for<Fields...>{});
+  }
+
+  static auto Parse(std::string_view message, Struct& out)
+      -> ValidationResult {
+    std::uint64_t seen{0};
+    int bad_tag{0};
+    auto parsed = FixFields::ForEach(
+        message, [&](int tag, std::string_view value) {
+          if (!Assign(tag, value, out, seen,
+                      std::index_sequence_for<Fields...>{})) {
+            bad_tag = tag;
+            return false;
+          }
+          return true;
+        });
+    if (!parsed) {
+      return {ValidationError::kIncorrectDataFormat, bad_tag};
+    }
+    return Check(seen, std::index_sequence_for<Fields...>{});
+  }
+
+ private:
+  template <std::size_t... Index>
+  static auto Assign(int tag, std::string_view value, Struct& out,
+                     std::uint64_t& seen,
+                     std::index_sequence<Index...> /*unused*/) -> bool {
+    auto converted{true};
+    // At most one Fields::kTag matches; the fold stops at it.
+    static_cast<void>(
+        ((tag == Fields::kTag &&
+          (seen |= Bit<Index>(), converted = Fields::Assign(value, out),
+           true)) ||
+         ...));
+    return converted;
+  }
+
+  template <std::size_t... Index>
+  static auto Check(std::uint64_t seen,
+                    std::index_sequence<Index...> /*unused*/)
+      -> ValidationResult {
+    constexpr auto kRequired = ((Fields::kRequired ? Bit<Index>() : 0) | ...);
+    if ((seen & kRequired) != kRequired) {
+      int missing{0};
+      static_cast<void>(
+          ((Fields::kRequired && (seen & Bit<Index>()) == 0 &&
+            (missing = Fields::kTag, true)) ||
+           ...));
+      return {ValidationError::kRequiredTagMissing, missing};
+    }
+    return {};
+  }
+};
+
+}  // namespace common
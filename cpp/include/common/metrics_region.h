@@ -0,0 +1,281 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "common/latency_histogram.h"
+#include "common/time_util.h"
+#include "quickfix/Exceptions.h"
+
+namespace common {
+
+enum class MetricKind : std::uint32_t {
+  kCount = 0,  // only ever grows, read as a rate
+  kGauge = 1,  // a level at the moment of publishing
+};
+
+// The layout of a metrics region, fixed so that a process built from
+// another tree can still read it; bump kVersion on any change. Names are
+// NUL-terminated and cut at kNameSize - 1 bytes.
+struct MetricsLayout {
+  static constexpr std::uint64_t kMagic = 0x0053525441545346;  // "FSTATRS"
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::size_t kNameSize = 48;
+  static constexpr std::size_t kMaxCounters = 32;
+  static constexpr std::size_t kMaxHistograms = 16;
+  static constexpr std::size_t kMaxSessions = 256;
+
+  struct Counter {
+    std::array<char, kNameSize> name;
+    std::uint64_t value;
+    MetricKind kind;
+    std::uint32_t reserved;
+  };
+
+  struct Histogram {
+    std::array<char, kNameSize> name;
+    std::uint64_t count;
+    std::uint64_t sum;
+    std::uint64_t max;
+    std::array<std::uint64_t, LatencyHistogram::kBucketCount> buckets;
+  };
+
+  struct Session {
+    std::array<char, kNameSize> name;
+    std::uint64_t incoming;
+    std::uint64_t outgoing;
+  };
+
+  // Everything a reader copies out in one go.
+  struct Data {
+    std::uint64_t published_nanos;  // epoch nanos, 0 until first published
+    std::uint64_t pid;
+    std::uint32_t counter_count;
+    std::uint32_t histogram_count;
+    std::uint32_t session_count;
+    std::uint32_t reserved;
+    std::array<Counter, kMaxCounters> counters;
+    std::array<Histogram, kMaxHistograms> histograms;
+    std::array<Session, kMaxSessions> sessions;
+  };
+
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t size;
+  // Odd while the writer is publishing; readers retry until they copy data
+  // with the same even value before and after.
+  std::atomic<std::uint64_t> sequence;
+  Data data;
+
+  static auto ToCounts(const Histogram& histogram)
+      -> LatencyHistogram::Counts {
+    LatencyHistogram::Counts counts;
+    std::copy(histogram.buckets.begin(), histogram.buckets.end(),
+              counts.buckets.begin());
+    counts.count = histogram.count;
+    counts.sum = histogram.sum;
+    counts.max = histogram.max;
+    return counts;
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<MetricsLayout::Data>);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+// Writer side of a metrics region: a file, normally under /dev/shm, mapped
+// shared so that fix_stat can read it without asking the server anything.
+// Metrics are gathered into a private copy with the Add calls and made
+// visible together by Publish(), from one thread, off the hot path.
+class MetricsRegion {
+ public:
+  explicit MetricsRegion(std::string path)
+      : path_(std::move(path)), staging_(std::make_unique<Data>()) {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      throw FIX::IOException("unable to open " + path_ + ": " +
+                             std::strerror(errno));
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(sizeof(MetricsLayout))) != 0) {
+      ::close(fd_);
+      throw FIX::IOException("unable to size " + path_ + ": " +
+                             std::strerror(errno));
+    }
+    auto* memory = ::mmap(nullptr, sizeof(MetricsLayout),
+                          PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (memory == MAP_FAILED) {
+      ::close(fd_);
+      throw FIX::IOException("unable to map " + path_ + ": " +
+                             std::strerror(errno));
+    }
+    layout_ = static_cast<MetricsLayout*>(memory);
+
+    // A reader still mapping the file from a previous run keeps working:
+    // the sequence carries on from where that run left it.
+    auto sequence =
+        (layout_->sequence.load(std::memory_order_relaxed) | 1U) + 1;
+    layout_->sequence.store(sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memset(&layout_->data, 0, sizeof(Data));
+    layout_->version = MetricsLayout::kVersion;
+    layout_->size = static_cast<std::uint32_t>(sizeof(MetricsLayout));
+    layout_->magic = MetricsLayout::kMagic;
+    layout_->sequence.store(sequence, std::memory_order_release);
+
+    std::memset(staging_.get(), 0, sizeof(Data));
+    staging_->pid = static_cast<std::uint64_t>(::getpid());
+  }
+
+  MetricsRegion(const MetricsRegion&) = delete;
+  auto operator=(const MetricsRegion&) -> MetricsRegion& = delete;
+
+  // The file stays behind, so the last values can still be read.
+  ~MetricsRegion() {
+    ::munmap(layout_, sizeof(MetricsLayout));
+    ::close(fd_);
+  }
+
+  // Starts gathering the next publish; anything not added again is dropped.
+  auto Clear() -> void {
+    staging_->counter_count = 0;
+    staging_->histogram_count = 0;
+    staging_->session_count = 0;
+  }
+
+  auto AddCounter(std::string_view name, std::uint64_t value,
+                  MetricKind kind = MetricKind::kCount) -> void {
+    if (staging_->counter_count == MetricsLayout::kMaxCounters) {
+      return;
+    }
+    auto& counter = staging_->counters[staging_->counter_count++];
+    SetName(counter.name, name);
+    counter.value = value;
+    counter.kind = kind;
+  }
+
+  auto AddHistogram(std::string_view name,
+                    const LatencyHistogram::Counts& counts) -> void {
+    if (staging_->histogram_count == MetricsLayout::kMaxHistograms) {
+      return;
+    }
+    auto& histogram = staging_->histograms[staging_->histogram_count++];
+    SetName(histogram.name, name);
+    histogram.count = counts.count;
+    histogram.sum = counts.sum;
+    histogram.max = counts.max;
+    std::copy(counts.buckets.begin(), counts.buckets.end(),
+              histogram.buckets.begin());
+  }
+
+  auto AddSession(std::string_view name, std::uint64_t incoming,
+                  std::uint64_t outgoing) -> void {
+    if (staging_->session_count == MetricsLayout::kMaxSessions) {
+      return;
+    }
+    auto& session = staging_->sessions[staging_->session_count++];
+    SetName(session.name, name);
+    session.incoming = incoming;
+    session.outgoing = outgoing;
+  }
+
+  auto Publish() -> void {
+    staging_->published_nanos = TimeUtil::EpochNanos();
+    auto sequence = layout_->sequence.load(std::memory_order_relaxed);
+    layout_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&layout_->data, staging_.get(), sizeof(Data));
+    layout_->sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  auto Path() const -> const std::string& { return path_; }
+
+ private:
+  using Data = MetricsLayout::Data;
+
+  static auto SetName(std::array<char, MetricsLayout::kNameSize>& to,
+                      std::string_view name) -> void {
+    auto length = std::min(name.size(), to.size() - 1);
+    std::memcpy(to.data(), name.data(), length);
+    to[length] = '\0';
+  }
+
+  std::string path_;
+  int fd_{-1};
+  MetricsLayout* layout_{nullptr};
+  std::unique_ptr<Data> staging_;
+};
+
+// Reader side, mapping the region read-only.
+class MetricsReader {
+ public:
+  explicit MetricsReader(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    struct stat info {};
+    if (fd_ < 0 || ::fstat(fd_, &info) != 0 ||
+        static_cast<std::size_t>(info.st_size) < sizeof(MetricsLayout)) {
+      return;
+    }
+    auto* memory = ::mmap(nullptr, sizeof(MetricsLayout), PROT_READ,
+                          MAP_SHARED, fd_, 0);
+    if (memory == MAP_FAILED) {
+      return;
+    }
+    layout_ = static_cast<const MetricsLayout*>(memory);
+    valid_ = layout_->magic == MetricsLayout::kMagic &&
+             layout_->version == MetricsLayout::kVersion &&
+             layout_->size == sizeof(MetricsLayout);
+  }
+
+  MetricsReader(const MetricsReader&) = delete;
+  auto operator=(const MetricsReader&) -> MetricsReader& = delete;
+
+  ~MetricsReader() {
+    if (layout_ != nullptr) {
+      ::munmap(const_cast<MetricsLayout*>(layout_), sizeof(MetricsLayout));
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  auto Valid() const -> bool { return valid_; }
+
+  // Copies out one consistent publish; false if the writer kept getting in
+  // the way.
+  auto Read(MetricsLayout::Data& data) const -> bool {
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+      auto before = layout_->sequence.load(std::memory_order_acquire);
+      if ((before & 1U) == 0) {
+        std::memcpy(&data, &layout_->data, sizeof(data));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (layout_->sequence.load(std::memory_order_relaxed) == before) {
+          return true;
+        }
+      }
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+ private:
+  static constexpr int kMaxAttempts = 1000;
+
+  int fd_{-1};
+  const MetricsLayout* layout_{nullptr};
+  bool valid_{false};
+};
+
+}  // namespace common
@@ -0,0 +1,537 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "quickfix/MessageStore.h"
+#include "quickfix/SessionSettings.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// When MmapStore pushes its pages to disk.
+enum class StoreSync {
+  kNone,        // leave write-back to the kernel
+  kPeriodic,    // msync from a background thread every sync interval
+  kPerMessage,  // msync the record and header before set() returns
+};
+
+// MessageStore over one memory-mapped file per session: a fixed header page
+// holding the sequence numbers, followed by an append-only segment of
+// [seqnum, length, bytes] records. An in-memory index maps sequence numbers
+// to record offsets and remembers which records are session-level messages.
+// Nothing on the send path is a syscall unless sync is kPerMessage or the
+// segment has to grow. With prefault, every page is faulted in up front and
+// as the file grows, so no set() takes a page fault either.
+class MmapStore : public FIX::MessageStore {
+ private:
+  static constexpr std::uint64_t kMagic = 0x45524f5453584946;  // "FIXSTORE"
+  static constexpr std::uint64_t kVersion = 1;
+  static constexpr std::size_t kPageSize = 4096;
+  static constexpr std::size_t kDataOffset = kPageSize;
+  static constexpr std::size_t kAlignment = 8;
+  static constexpr std::size_t kAdminFlag = 1;
+  static constexpr std::size_t kMsgTypeScan = 32;
+  static constexpr FIX::SEQNUM kMaxIndexGap = 1U << 20U;
+
+  struct Header {
+    std::uint64_t magic;
+    std::uint64_t version;
+    std::uint64_t data_end;
+    std::uint64_t next_sender;
+    std::uint64_t next_target;
+    std::int64_t creation_time;
+  };
+
+  struct Record {
+    std::uint64_t seqnum;
+    std::uint64_t length;
+  };
+
+ public:
+  MmapStore(const FIX::UtcTimeStamp& now, const std::string& path,
+            std::size_t capacity, StoreSync sync,
+            std::chrono::milliseconds sync_interval, bool prefault = false)
+      : path_(path),
+        sync_(sync),
+        sync_interval_(sync_interval),
+        prefault_(prefault) {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      throw FIX::IOException("unable to open " + path_ + ": " +
+                             std::strerror(errno));
+    }
+
+    struct stat info {};
+    ::fstat(fd_, &info);
+    auto size = std::max(static_cast<std::size_t>(info.st_size),
+                         RoundUp(std::max(capacity, 2 * kPageSize)));
+    Map(size);
+
+    if (GetHeader().magic != kMagic || GetHeader().version != kVersion) {
+      Initialize(now.getTimeT());
+    } else {
+      Rebuild();
+    }
+
+    if (sync_ == StoreSync::kPeriodic) {
+      flusher_ = std::thread([this]() { Flush(); });
+    }
+  }
+
+  MmapStore(const MmapStore&) = delete;
+  auto operator=(const MmapStore&) -> MmapStore& = delete;
+
+  ~MmapStore() override {
+    if (flusher_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+      stopping_cv_.notify_one();
+      flusher_.join();
+    }
+
+    ::msync(base_, capacity_, MS_SYNC);
+    ::munmap(base_, capacity_);
+    ::close(fd_);
+  }
+
+  auto set(FIX::SEQNUM seqnum, const std::string& message)
+      EXCEPT(FIX::IOException) -> bool override {
+    auto& header = GetHeader();
+    auto offset = header.data_end;
+    auto end = offset + RoundUp(sizeof(Record) + message.size(), kAlignment);
+    if (end > capacity_) {
+      Grow(end);
+    }
+
+    auto* record = base_ + offset;
+    Record prefix{seqnum, message.size()};
+    std::memcpy(record, &prefix, sizeof(prefix));
+    std::memcpy(record + sizeof(Record), message.data(), message.size());
+
+    // Publish the record only once its bytes are in place.
+    DataEnd().store(end, std::memory_order_release);
+    Index(seqnum, offset, IsAdmin(message));
+
+    if (sync_ == StoreSync::kPerMessage) {
+      Sync(offset, end);
+    }
+    return true;
+  }
+
+  // Session::nextResendRequest gap-fills every session-level message and
+  // every seqnum missing from the result, coalescing adjacent ones into one
+  // SequenceReset-GapFill. So only application messages are returned, plus
+  // the last of a trailing run of session-level ones so the final gap fill
+  // still reaches the end of the range. Nothing is parsed to decide this.
+  auto get(FIX::SEQNUM begin, FIX::SEQNUM end,
+           std::vector<std::string>& messages) const
+      EXCEPT(FIX::IOException) -> void override {
+    messages.clear();
+    if (index_.empty() || begin > end) {
+      return;
+    }
+
+    // A range past the last stored seqnum (after a reset, or a high
+    // BeginSeqNo) has nothing to resend.
+    begin = std::max(begin, index_first_);
+    end = std::min<FIX::SEQNUM>(end, index_first_ + index_.size() - 1);
+    if (begin > end) {
+      return;
+    }
+    messages.reserve(end - begin + 1);
+
+    FIX::SEQNUM trailing_admin{0};
+    for (auto seqnum = begin; seqnum <= end; ++seqnum) {
+      auto entry = Entry(seqnum);
+      if (entry == 0) {
+        continue;
+      }
+
+      if ((entry & kAdminFlag) != 0) {
+        trailing_admin = seqnum;
+      } else {
+        trailing_admin = 0;
+        messages.emplace_back(Read(entry));
+      }
+    }
+
+    if (trailing_admin != 0) {
+      messages.emplace_back(Read(Entry(trailing_admin)));
+    }
+  }
+
+  // The stored bytes for seqnum, or an empty view. Valid until the next set().
+  auto Find(FIX::SEQNUM seqnum) const -> std::string_view {
+    auto entry = Entry(seqnum);
+    return entry == 0 ? std::string_view() : Read(entry);
+  }
+
+  // Whether seqnum was stored as a session-level (admin) message.
+  auto IsAdmin(FIX::SEQNUM seqnum) const -> bool {
+    return (Entry(seqnum) & kAdminFlag) != 0;
+  }
+
+  auto getNextSenderMsgSeqNum() const EXCEPT(FIX::IOException)
+      -> FIX::SEQNUM override {
+    return GetHeader().next_sender;
+  }
+
+  auto getNextTargetMsgSeqNum() const EXCEPT(FIX::IOException)
+      -> FIX::SEQNUM override {
+    return GetHeader().next_target;
+  }
+
+  auto setNextSenderMsgSeqNum(FIX::SEQNUM value) EXCEPT(FIX::IOException)
+      -> void override {
+    GetHeader().next_sender = value;
+    SyncHeader();
+  }
+
+  auto setNextTargetMsgSeqNum(FIX::SEQNUM value) EXCEPT(FIX::IOException)
+      -> void override {
+    GetHeader().next_target = value;
+    SyncHeader();
+  }
+
+  auto incrNextSenderMsgSeqNum() EXCEPT(FIX::IOException) -> void override {
+    ++GetHeader().next_sender;
+    SyncHeader();
+  }
+
+  auto incrNextTargetMsgSeqNum() EXCEPT(FIX::IOException) -> void override {
+    ++GetHeader().next_target;
+    SyncHeader();
+  }
+
+  auto getCreationTime() const EXCEPT(FIX::IOException)
+      -> FIX::UtcTimeStamp override {
+    return FIX::UtcTimeStamp(static_cast<time_t>(GetHeader().creation_time));
+  }
+
+  auto reset(const FIX::UtcTimeStamp& now) EXCEPT(FIX::IOException)
+      -> void override {
+    Initialize(now.getTimeT());
+  }
+
+  auto refresh() EXCEPT(FIX::IOException) -> void override { Rebuild(); }
+
+ private:
+  static auto RoundUp(std::size_t value, std::size_t to = kPageSize)
+      -> std::size_t {
+    return (value + to - 1) / to * to;
+  }
+
+  // Admin MsgTypes are the single characters 0-5 and A; tag 35 is always the
+  // third field, well inside the first kMsgTypeScan bytes.
+  static auto IsAdmin(std::string_view message) -> bool {
+    auto tag = message.substr(0, kMsgTypeScan).find("\00135=");
+    if (tag == std::string_view::npos || message.size() < tag + 6) {
+      return false;
+    }
+    auto value = message.substr(tag + 4, 2);
+    return value[1] == '\001' &&
+           (value[0] == 'A' || (value[0] >= '0' && value[0] <= '5'));
+  }
+
+  auto Read(std::size_t entry) const -> std::string_view {
+    const auto* record = base_ + (entry & ~kAdminFlag);
+    Record prefix{};
+    std::memcpy(&prefix, record, sizeof(prefix));
+    return {reinterpret_cast<const char*>(record + sizeof(Record)),
+            prefix.length};
+  }
+
+  auto GetHeader() -> Header& { return *reinterpret_cast<Header*>(base_); }
+
+  auto GetHeader() const -> const Header& {
+    return *reinterpret_cast<const Header*>(base_);
+  }
+
+  // Shared with the flusher thread.
+  auto DataEnd() -> std::atomic_ref<std::uint64_t> {
+    return std::atomic_ref<std::uint64_t>(GetHeader().data_end);
+  }
+
+  auto Map(std::size_t size) -> void {
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      throw FIX::IOException("unable to size " + path_ + ": " +
+                             std::strerror(errno));
+    }
+
+    auto* memory =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | (prefault_ ? MAP_POPULATE : 0), fd_, 0);
+    if (memory == MAP_FAILED) {
+      throw FIX::IOException("unable to map " + path_ + ": " +
+                             std::strerror(errno));
+    }
+
+    base_ = static_cast<std::byte*>(memory);
+    capacity_ = size;
+  }
+
+  // Doubles the file until needed bytes fit, extending the mapping in place
+  // when the address space after it is free. Only a mapping that has to move
+  // waits for a flush in progress, which is still syncing the old address.
+  auto Grow(std::size_t needed) -> void {
+    auto size = capacity_;
+    while (size < needed) {
+      size *= 2;
+    }
+
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      throw FIX::IOException("unable to grow " + path_ + ": " +
+                             std::strerror(errno));
+    }
+
+    auto* memory = ::mremap(base_, capacity_, size, 0);
+    if (memory == MAP_FAILED) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      flushed_cv_.wait(lock, [this]() { return !flushing_; });
+      memory = ::mremap(base_, capacity_, size, MREMAP_MAYMOVE);
+      if (memory == MAP_FAILED) {
+        throw FIX::IOException("unable to remap " + path_ + ": " +
+                               std::strerror(errno));
+      }
+      base_ = static_cast<std::byte*>(memory);
+    }
+
+    spdlog::info("store {}: grew to {} bytes", path_, size);
+    if (prefault_) {
+      // Past data_end, so still the zeros ftruncate left there.
+      for (auto page = capacity_; page < size; page += kPageSize) {
+        base_[page] = std::byte{0};
+      }
+    }
+    capacity_ = size;
+  }
+
+  auto Initialize(std::time_t creation_time) -> void {
+    auto& header = GetHeader();
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.next_sender = 1;
+    header.next_target = 1;
+    header.creation_time = static_cast<std::int64_t>(creation_time);
+    DataEnd().store(kDataOffset, std::memory_order_release);
+    index_.clear();
+    index_first_ = 0;
+    SyncHeader();
+  }
+
+  // Rebuilds the index from the records between the header and data_end.
+  // A record whose prefix cannot be right (running past data_end, or a
+  // seqnum never sent: 0 or past next_sender) ends the log there.
+  auto Rebuild() -> void {
+    index_.clear();
+    index_first_ = 0;
+    std::size_t offset = kDataOffset;
+    const auto data_end =
+        std::min<std::size_t>(GetHeader().data_end, capacity_);
+    const auto next_sender = GetHeader().next_sender;
+    while (offset + sizeof(Record) <= data_end) {
+      Record prefix{};
+      std::memcpy(&prefix, base_ + offset, sizeof(prefix));
+      if (prefix.length > data_end - offset - sizeof(Record) ||
+          prefix.seqnum == 0 || prefix.seqnum > next_sender) {
+        spdlog::warn("store {}: bad record at offset {} (seqnum {}, {} "
+                     "bytes), dropping it and everything after",
+                     path_, offset, prefix.seqnum, prefix.length);
+        DataEnd().store(offset, std::memory_order_release);
+        break;
+      }
+      auto next = offset + RoundUp(sizeof(Record) + prefix.length, kAlignment);
+      if (next > data_end) {
+        spdlog::warn("store {}: truncated record at offset {}", path_, offset);
+        DataEnd().store(offset, std::memory_order_release);
+        break;
+      }
+      auto message =
+          std::string_view(reinterpret_cast<const char*>(base_ + offset) +
+                               sizeof(Record),
+                           prefix.length);
+      Index(prefix.seqnum, offset, IsAdmin(message));
+      offset = next;
+    }
+  }
+
+  // The index starts at the first seqnum stored, however high. A seqnum
+  // more than kMaxIndexGap outside the range indexed (a SequenceReset far
+  // ahead) starts it again there rather than allocating for every seqnum in
+  // between; the messages before it are gap-filled instead of resent.
+  auto Index(FIX::SEQNUM seqnum, std::size_t offset, bool admin) -> void {
+    if (!index_.empty() &&
+        (seqnum + kMaxIndexGap < index_first_ ||
+         seqnum >= index_first_ + index_.size() + kMaxIndexGap)) {
+      spdlog::warn("store {}: seqnum {} is far from {}, earlier messages "
+                   "will not be resent",
+                   path_, seqnum, index_first_);
+      index_.clear();
+    }
+    if (index_.empty()) {
+      index_first_ = seqnum;
+    } else if (seqnum < index_first_) {
+      index_.insert(index_.begin(), index_first_ - seqnum, 0);
+      index_first_ = seqnum;
+    }
+
+    auto slot = seqnum - index_first_;
+    if (slot >= index_.size()) {
+      index_.resize(std::max<std::size_t>(slot + 1, 2 * index_.size()));
+    }
+    index_[slot] = offset | (admin ? kAdminFlag : 0);
+  }
+
+  // The index entry for seqnum, 0 when not stored.
+  auto Entry(FIX::SEQNUM seqnum) const -> std::size_t {
+    if (seqnum < index_first_ || seqnum - index_first_ >= index_.size()) {
+      return 0;
+    }
+    return index_[seqnum - index_first_];
+  }
+
+  auto Sync(std::size_t begin, std::size_t end) -> void {
+    auto aligned = begin / kPageSize * kPageSize;
+    ::msync(base_ + aligned, end - aligned, MS_SYNC);
+    ::msync(base_, kPageSize, MS_SYNC);
+  }
+
+  auto SyncHeader() -> void {
+    if (sync_ == StoreSync::kPerMessage) {
+      ::msync(base_, kPageSize, MS_SYNC);
+    }
+  }
+
+  // Syncs outside the lock, so a set() that grows the file in place does
+  // not wait behind the disk.
+  auto Flush() -> void {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      stopping_cv_.wait_for(lock, sync_interval_);
+      auto* base = base_;
+      auto end = RoundUp(DataEnd().load(std::memory_order_acquire));
+      flushing_ = true;
+      lock.unlock();
+      ::msync(base, end, MS_SYNC);
+      lock.lock();
+      flushing_ = false;
+      flushed_cv_.notify_all();
+    }
+  }
+
+  std::string path_;
+  StoreSync sync_;
+  std::chrono::milliseconds sync_interval_;
+  bool prefault_;
+  int fd_{-1};
+  std::byte* base_{nullptr};
+  std::size_t capacity_{0};
+
+  // index_[seqnum - index_first_] is the record offset (always 8-byte
+  // aligned and past the header, so never 0) with kAdminFlag in bit 0, or 0
+  // when not stored.
+  std::vector<std::size_t> index_;
+  FIX::SEQNUM index_first_{0};
+
+  // Guards base_ against the flusher while the mapping moves.
+  std::mutex mutex_;
+  std::condition_variable stopping_cv_;
+  std::condition_variable flushed_cv_;
+  bool stopping_{false};
+  bool flushing_{false};
+  std::thread flusher_;
+};
+
+// Drop-in replacement for FIX::FileStoreFactory. Per-session settings:
+//
+//   FileStorePath=/path          directory for <Begin>-<Sender>-<Target>.mmap
+//   MmapStoreSizeMB=4            initial file size, doubled as needed
+//   MmapStorePrefault=N          fault every page in up front and on growth
+//   MmapStoreSync=periodic       none | periodic | message
+//   MmapStoreSyncMillis=100      interval for periodic
+class MmapStoreFactory : public FIX::MessageStoreFactory {
+ public:
+  static constexpr auto kFileStorePath = "FileStorePath";
+  static constexpr auto kMmapStoreSizeMB = "MmapStoreSizeMB";
+  static constexpr auto kMmapStorePrefault = "MmapStorePrefault";
+  static constexpr auto kMmapStoreSync = "MmapStoreSync";
+  static constexpr auto kMmapStoreSyncMillis = "MmapStoreSyncMillis";
+
+  static constexpr std::size_t kDefaultSizeMB = 4;
+  static constexpr auto kDefaultSyncInterval = std::chrono::milliseconds(100);
+
+  explicit MmapStoreFactory(const FIX::SessionSettings& settings)
+      : settings_(settings) {}
+
+  auto create(const FIX::UtcTimeStamp& now, const FIX::SessionID& session_id)
+      -> FIX::MessageStore* override {
+    const auto& settings = settings_.get(session_id);
+
+    auto path = settings.getString(kFileStorePath) + "/" +
+                session_id.getBeginString().getValue() + "-" +
+                session_id.getSenderCompID().getValue() + "-" +
+                session_id.getTargetCompID().getValue() + ".mmap";
+
+    auto size_mb = settings.has(kMmapStoreSizeMB)
+                       ? static_cast<std::size_t>(
+                             settings.getInt(kMmapStoreSizeMB))
+                       : kDefaultSizeMB;
+
+    auto sync_interval =
+        settings.has(kMmapStoreSyncMillis)
+            ? std::chrono::milliseconds(settings.getInt(kMmapStoreSyncMillis))
+            : kDefaultSyncInterval;
+
+    auto prefault = settings.has(kMmapStorePrefault) &&
+                    settings.getBool(kMmapStorePrefault);
+
+    return new MmapStore(now, path, size_mb << 20U, GetSync(settings),
+                         sync_interval, prefault);
+  }
+
+  auto destroy(FIX::MessageStore* store) -> void override { delete store; }
+
+ private:
+  static auto GetSync(const FIX::Dictionary& settings) -> StoreSync {
+    if (!settings.has(kMmapStoreSync)) {
+      return StoreSync::kPeriodic;
+    }
+
+    static const std::map<std::string, StoreSync> kSyncModes{
+        {"none", StoreSync::kNone},
+        {"periodic", StoreSync::kPeriodic},
+        {"message", StoreSync::kPerMessage}};
+
+    auto mode = kSyncModes.find(settings.getString(kMmapStoreSync));
+    if (mode == kSyncModes.end()) {
+      throw FIX::ConfigError(std::string(kMmapStoreSync) +
+                             " must be none, periodic or message");
+    }
+    return mode->second;
+  }
+
+  FIX::SessionSettings settings_;
+};
+
+}  // namespace common
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "common/hugepage_arena.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// Free list of fixed-size blocks carved from the global HugePageArena, or from
+// the heap when there is no arena (or it has run out). Blocks are recycled
+// but never given back, so after warm-up a steady state allocates nothing.
+class BlockPool {
+ private:
+  struct SpinLock {
+    auto lock() -> void {
+      while (locked_.test_and_set(std::memory_order_acquire)) {
+      }
+    }
+
+    auto unlock() -> void { locked_.clear(std::memory_order_release); }
+
+    std::atomic_flag locked_ = ATOMIC_FLAG_INIT;
+  };
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+ public:
+  struct Stats {
+    std::size_t block_size;
+    std::size_t live;
+    std::size_t high_water;
+    std::size_t heap_blocks;
+  };
+
+  BlockPool(std::size_t size, std::size_t alignment)
+      : size_(std::max(size, sizeof(FreeBlock))),
+        alignment_(std::max(alignment, alignof(FreeBlock))) {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    Registry().push_back(this);
+  }
+
+  // Pools that do not live as long as the process (a transport's per-loop
+  // buffers) give their heap blocks back; arena blocks stay with the arena.
+  ~BlockPool() {
+    {
+      std::lock_guard<std::mutex> lock(RegistryMutex());
+      auto& pools = Registry();
+      pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+    }
+    while (free_ != nullptr) {
+      auto* block = free_;
+      free_ = block->next;
+      if (!HugePageArena::Global().Owns(block)) {
+        ::operator delete(block, std::align_val_t(alignment_));
+      }
+    }
+  }
+
+  BlockPool(const BlockPool&) = delete;
+  auto operator=(const BlockPool&) -> BlockPool& = delete;
+
+  auto Allocate() -> void* {
+    {
+      std::lock_guard<SpinLock> lock(lock_);
+      if (free_ != nullptr) {
+        auto* block = free_;
+        free_ = block->next;
+        OnAllocate();
+        return block;
+      }
+      OnAllocate();
+    }
+
+    // Outside the lock: the arena is lock-free and the heap has its own.
+    auto* block = HugePageArena::Global().Allocate(size_, alignment_);
+    if (block == nullptr) {
+      heap_blocks_.fetch_add(1, std::memory_order_relaxed);
+      block = ::operator new(size_, std::align_val_t(alignment_));
+    }
+    return block;
+  }
+
+  auto Deallocate(void* block) -> void {
+    std::lock_guard<SpinLock> lock(lock_);
+    free_ = new (block) FreeBlock{free_};
+    live_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  auto GetStats() const -> Stats {
+    return {size_, live_.load(std::memory_order_relaxed),
+            high_water_.load(std::memory_order_relaxed),
+            heap_blocks_.load(std::memory_order_relaxed)};
+  }
+
+  // Logs arena usage and the high-water mark of every pool.
+  static auto LogStats() -> void {
+    auto arena = HugePageArena::Global().GetStats();
+    spdlog::info("arena: {} of {} bytes used, {} requests fell back to heap",
+                 arena.used, arena.capacity, arena.exhausted);
+
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    for (const auto* pool : Registry()) {
+      auto stats = pool->GetStats();
+      spdlog::info("pool {}B: {} live, {} high water, {} from heap",
+                   stats.block_size, stats.live, stats.high_water,
+                   stats.heap_blocks);
+    }
+  }
+
+ private:
+  // Called with lock_ held; the counters are atomic only so GetStats() can
+  // read them from another thread.
+  auto OnAllocate() -> void {
+    auto live = live_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (live > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(live, std::memory_order_relaxed);
+    }
+  }
+
+  static auto Registry() -> std::vector<const BlockPool*>& {
+    static std::vector<const BlockPool*> pools;
+    return pools;
+  }
+
+  static auto RegistryMutex() -> std::mutex& {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  const std::size_t size_;
+  const std::size_t alignment_;
+  SpinLock lock_;
+  FreeBlock* free_{nullptr};
+  std::atomic<std::size_t> live_{0};
+  std::atomic<std::size_t> high_water_{0};
+  std::atomic<std::size_t> heap_blocks_{0};
+};
+
+// Stateless allocator over a BlockPool per value type, usable with node-based
+// containers (every instance compares equal, so std::list::splice between
+// containers is fine). Single objects come from the pool. Arrays come from
+// the heap, not the arena: the arena was faulted in by the thread that
+// reserved it, while a heap array lands on the NUMA node of the thread that
+// first writes it (a book worker constructing its own ring).
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& /*unused*/) noexcept {}  // NOLINT
+
+  auto allocate(std::size_t count) -> T* {
+    if (count == 1) {
+      return static_cast<T*>(Pool().Allocate());
+    }
+    return static_cast<T*>(
+        ::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  auto deallocate(T* pointer, std::size_t count) -> void {
+    if (count == 1) {
+      Pool().Deallocate(pointer);
+    } else {
+      ::operator delete(pointer, std::align_val_t(alignof(T)));
+    }
+  }
+
+  static auto GetStats() -> BlockPool::Stats { return Pool().GetStats(); }
+
+  template <typename U>
+  auto operator==(const PoolAllocator<U>& /*unused*/) const -> bool {
+    return true;
+  }
+
+  template <typename U>
+  auto operator!=(const PoolAllocator<U>& /*unused*/) const -> bool {
+    return false;
+  }
+
+ private:
+  static auto Pool() -> BlockPool& {
+    static BlockPool pool(sizeof(T), alignof(T));
+    return pool;
+  }
+};
+
+}  // namespace common
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#include "common/fix_framing.h"
+#include "common/flight_recorder.h"
+#include "common/latency_trace.h"
+#include "common/pool_allocator.h"
+#include "quickfix/Message.h"
+
+namespace common {
+
+// The bytes of the message an event loop is dispatching on this thread,
+// valid while Session::next() runs on them, so an Application callback
+// can take the message as received instead of copying the FIX::Message.
+// Empty on QuickFIX's own transports.
+class ReceivedFrame {
+ public:
+  class Scope {
+   public:
+    explicit Scope(std::string_view frame) {
+      Current() = frame;
+      if (LatencyTrace::kEnabled || FlightRecorder::Enabled()) {
+        At() = TimeUtil::Cycles();
+      }
+    }
+    ~Scope() { Current() = {}; }
+
+    Scope(const Scope&) = delete;
+    auto operator=(const Scope&) -> Scope& = delete;
+  };
+
+  // The received bytes of message, unless Session::next() is handing on a
+  // different one (a queued message with an earlier MsgSeqNum).
+  static auto Of(const FIX::Message& message) -> std::string_view {
+    auto frame = Current();
+    if (frame.empty()) {
+      return {};
+    }
+    const auto& header = message.getHeader();
+    auto sequence = FixFields::Find(frame, FIX::FIELD::MsgSeqNum);
+    if (!sequence || !header.isSetField(FIX::FIELD::MsgSeqNum) ||
+        *sequence != header.getField(FIX::FIELD::MsgSeqNum)) {
+      return {};
+    }
+    return frame;
+  }
+
+  // When the frame was handed to the session, as TimeUtil::Cycles(); only
+  // taken with LatencyTrace or the FlightRecorder enabled.
+  static auto Cycles() -> std::uint64_t { return At(); }
+
+ private:
+  static auto Current() -> std::string_view& {
+    thread_local std::string_view frame;
+    return frame;
+  }
+
+  static auto At() -> std::uint64_t& {
+    thread_local std::uint64_t cycles{0};
+    return cycles;
+  }
+};
+
+// One message's bytes in a block from a size-classed BlockPool: what the
+// server hands from the I/O thread to the book workers in place of a
+// FIX::Message, which copies every field on each hop. Readers take
+// string_views into it (see MessageView) that last as long as it does.
+// The message's LatencyTrace, and where the FlightRecorder has seen it,
+// travel with it.
+class PooledFrame {
+ private:
+  static constexpr std::array<std::size_t, 5> kSizes{256, 512, 1024, 2048,
+                                                     4096};
+  static constexpr std::size_t kCacheLine = 64;
+  static constexpr std::size_t kHeap = kSizes.size();
+
+ public:
+  PooledFrame() = default;
+
+  explicit PooledFrame(std::string_view bytes)
+      : size_(static_cast<std::uint32_t>(bytes.size())) {
+    auto size_class = SizeClass(size_);
+    data_ = static_cast<char*>(
+        size_class == kHeap
+            ? ::operator new(size_, std::align_val_t(kCacheLine))
+            : Pool(size_class).Allocate());
+    std::memcpy(data_, bytes.data(), size_);
+  }
+
+  ~PooledFrame() { Release(); }
+
+  PooledFrame(PooledFrame&& other) noexcept
+      : data_(other.data_),
+        size_(other.size_),
+        order_hash_(other.order_hash_),
+        session_hash_(other.session_hash_),
+        first_seen_(other.first_seen_),
+        trace_(other.trace_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  auto operator=(PooledFrame&& other) noexcept -> PooledFrame& {
+    if (this != &other) {
+      Release();
+      data_ = other.data_;
+      size_ = other.size_;
+      order_hash_ = other.order_hash_;
+      session_hash_ = other.session_hash_;
+      first_seen_ = other.first_seen_;
+      trace_ = other.trace_;
+      other.data_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  PooledFrame(const PooledFrame&) = delete;
+  auto operator=(const PooledFrame&) -> PooledFrame& = delete;
+
+  auto View() const -> std::string_view { return {data_, size_}; }
+
+  auto Field(int tag) const -> std::optional<std::string_view> {
+    return FixFields::Find(View(), tag);
+  }
+
+  auto Trace() -> LatencyTrace& { return trace_; }
+  auto Trace() const -> const LatencyTrace& { return trace_; }
+
+  // FlightRecorder::Hash() of the ClOrdID, 0 if there is none. Found the
+  // first time it is asked for and kept after Release(), so a response that
+  // carries the frame is matched to its order.
+  auto OrderHash() -> std::uint32_t {
+    if (order_hash_ == 0 && data_ != nullptr) {
+      if (auto cl_ord_id = Field(FIX::FIELD::ClOrdID)) {
+        order_hash_ = FlightRecorder::Hash(*cl_ord_id);
+      }
+    }
+    return order_hash_;
+  }
+
+  // FlightRecorder::Hash() of the session the message came in on, set by
+  // whoever makes the frame; 0 if unset.
+  auto SessionHash() const -> std::uint32_t { return session_hash_; }
+  auto SetSessionHash(std::uint32_t hash) -> void { session_hash_ = hash; }
+
+  // When the FlightRecorder first saw the message, as TimeUtil::Cycles().
+  auto FirstSeen() const -> std::uint64_t { return first_seen_; }
+  auto SetFirstSeen(std::uint64_t cycles) -> void { first_seen_ = cycles; }
+
+  // Gives the block back now rather than when next overwritten.
+  auto Release() -> void {
+    if (data_ == nullptr) {
+      return;
+    }
+    if (auto size_class = SizeClass(size_); size_class == kHeap) {
+      ::operator delete(data_, std::align_val_t(kCacheLine));
+    } else {
+      Pool(size_class).Deallocate(data_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+ private:
+  static auto SizeClass(std::size_t size) -> std::size_t {
+    std::size_t index{0};
+    while (index < kSizes.size() && kSizes[index] < size) {
+      ++index;
+    }
+    return index;
+  }
+
+  static auto Pool(std::size_t size_class) -> BlockPool& {
+    static std::array<BlockPool, kSizes.size()> pools{
+        {{kSizes[0], kCacheLine},
+         {kSizes[1], kCacheLine},
+         {kSizes[2], kCacheLine},
+         {kSizes[3], kCacheLine},
+         {kSizes[4], kCacheLine}}};
+    return pools[size_class];
+  }
+
+  char* data_{nullptr};
+  // The size class is worked out again from size_ on release, keeping the
+  // frame at 32 bytes.
+  std::uint32_t size_{0};
+  std::uint32_t order_hash_{0};
+  std::uint32_t session_hash_{0};
+  std::uint64_t first_seen_{0};
+  [[no_unique_address]] LatencyTrace trace_;
+};
+
+}  // namespace common
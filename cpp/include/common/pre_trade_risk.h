@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/decimal.h"
+#include "common/time_util.h"
+#include "quickfix/Dictionary.h"
+#include "quickfix/Exceptions.h"
+
+namespace common {
+
+// Pre-trade limits read from the [DEFAULT] section of the session settings:
+//
+//   MaxOrderQty=10000
+//   MaxOrderNotional=1000000      qty * price
+//   PriceBandPercent=5            from the symbol's last fill
+//   MaxOpenOrders=100             per account
+//   MaxOrdersPerSecond=1000       per account
+//   RiskMaxAccounts=1024
+//
+// Every limit is optional; an unset (or zero) limit is not checked. Limits
+// are read as Decimals and compared exactly.
+struct RiskLimits {
+  static constexpr auto kMaxOrderQty = "MaxOrderQty";
+  static constexpr auto kMaxOrderNotional = "MaxOrderNotional";
+  static constexpr auto kPriceBandPercent = "PriceBandPercent";
+  static constexpr auto kMaxOpenOrders = "MaxOpenOrders";
+  static constexpr auto kMaxOrdersPerSecond = "MaxOrdersPerSecond";
+  static constexpr auto kRiskMaxAccounts = "RiskMaxAccounts";
+
+  static constexpr std::size_t kDefaultMaxAccounts = 1024;
+
+  Decimal max_order_qty;
+  Decimal max_order_notional;
+  Decimal price_band_percent;
+  std::int64_t max_open_orders{0};
+  std::uint32_t max_orders_per_second{0};
+  std::size_t max_accounts{kDefaultMaxAccounts};
+
+  static auto FromSettings(const FIX::Dictionary& settings) -> RiskLimits {
+    RiskLimits limits;
+    limits.max_order_qty = GetDecimal(settings, kMaxOrderQty);
+    limits.max_order_notional = GetDecimal(settings, kMaxOrderNotional);
+    limits.price_band_percent = GetDecimal(settings, kPriceBandPercent);
+    if (settings.has(kMaxOpenOrders)) {
+      limits.max_open_orders = settings.getInt(kMaxOpenOrders);
+    }
+    if (settings.has(kMaxOrdersPerSecond)) {
+      limits.max_orders_per_second =
+          static_cast<std::uint32_t>(settings.getInt(kMaxOrdersPerSecond));
+    }
+    if (settings.has(kRiskMaxAccounts)) {
+      limits.max_accounts =
+          static_cast<std::size_t>(settings.getInt(kRiskMaxAccounts));
+    }
+    return limits;
+  }
+
+ private:
+  static auto GetDecimal(const FIX::Dictionary& settings,
+                         const std::string& key) -> Decimal {
+    if (!settings.has(key)) {
+      return {};
+    }
+    auto value = Decimal::Parse(settings.getString(key));
+    if (!value) {
+      throw FIX::ConfigError(key + ": not a decimal number");
+    }
+    return *value;
+  }
+};
+
+enum class RiskReject : std::uint8_t {
+  kNone,
+  kOrderQty,
+  kNotional,
+  kPriceBand,
+  kAccountTable,  // account name too long, or the account table is full
+  kOrderRate,
+  kOpenOrders,
+};
+
+// Pre-trade checks shared by every book worker. Stateless limits are checked
+// first; the per-account counters are only touched once those pass. Each
+// account's counters sit on their own cache line, so workers checking
+// different accounts never share a line, and the account table itself is
+// lock-free: a slot is claimed with a CAS and never released.
+//
+// Per-symbol price references are only written by the worker that owns the
+// symbol, after a fill. Every price for a symbol is expected at one scale
+// (see SymbolScales), so a reference is kept as its units.
+class PreTradeRisk {
+ private:
+  static constexpr std::size_t kCacheLine = 64;
+  static constexpr std::size_t kMaxAccountLength = 32;
+  static constexpr std::uint64_t kNanosPerSecond = 1000000000;
+
+  enum SlotState : std::uint8_t { kEmpty, kClaiming, kReady };
+
+ public:
+  struct alignas(kCacheLine) Account {
+    std::atomic<std::uint8_t> state{kEmpty};
+    std::uint8_t length{0};
+    std::array<char, kMaxAccountLength> name{};
+    std::atomic<std::int64_t> open_orders{0};
+    std::atomic<std::uint64_t> rate_window{0};
+    std::atomic<std::uint32_t> rate_count{0};
+  };
+
+  struct Result {
+    RiskReject reject{RiskReject::kNone};
+    Account* account{nullptr};
+    int symbol{-1};
+
+    explicit operator bool() const { return reject == RiskReject::kNone; }
+  };
+
+  // symbols must be sorted; price bands apply only to them. Call before any
+  // worker starts.
+  auto Configure(const RiskLimits& limits,
+                 const std::vector<std::string>& symbols) -> void {
+    limits_ = limits;
+    symbols_ = symbols;
+    references_ = std::make_unique<Reference[]>(symbols_.size());
+
+    capacity_ = 2;
+    while (capacity_ < 2 * limits_.max_accounts) {
+      capacity_ <<= 1U;
+    }
+    accounts_ = std::make_unique<Account[]>(capacity_);
+  }
+
+  // With commit false (warm-up) every lookup still runs but no counter or
+  // account slot is changed.
+  auto Check(std::string_view account, std::string_view symbol,
+             const Decimal& qty, const Decimal& price, bool commit = true)
+      -> Result {
+    const Decimal zero;
+    Result result;
+    if (limits_.max_order_qty > zero && qty > limits_.max_order_qty) {
+      result.reject = RiskReject::kOrderQty;
+      return result;
+    }
+    if (limits_.max_order_notional > zero &&
+        qty.Times(price) > limits_.max_order_notional.Widen()) {
+      result.reject = RiskReject::kNotional;
+      return result;
+    }
+
+    result.symbol = SymbolIndex(symbol);
+    if (limits_.price_band_percent > zero && result.symbol >= 0) {
+      auto reference =
+          references_[result.symbol].units.load(std::memory_order_relaxed);
+      if (reference > 0) {
+        // |price - reference| * 100 > reference * percent
+        Decimal distance(std::abs(price.Units() - reference), price.Scale());
+        Decimal base(reference, price.Scale());
+        if (distance.Times(Decimal(100, 0)) >
+            base.Times(limits_.price_band_percent)) {
+          result.reject = RiskReject::kPriceBand;
+          return result;
+        }
+      }
+    }
+
+    result.account = FindAccount(account, commit);
+    if (result.account == nullptr) {
+      result.reject = commit ? RiskReject::kAccountTable : RiskReject::kNone;
+      return result;
+    }
+
+    if (limits_.max_orders_per_second > 0 &&
+        !CheckRate(*result.account, commit)) {
+      result.reject = RiskReject::kOrderRate;
+      return result;
+    }
+
+    if (!commit) {
+      result.account->open_orders.load(std::memory_order_relaxed);
+      return result;
+    }
+
+    auto open =
+        result.account->open_orders.fetch_add(1, std::memory_order_relaxed);
+    if (limits_.max_open_orders > 0 && open >= limits_.max_open_orders) {
+      result.account->open_orders.fetch_sub(1, std::memory_order_relaxed);
+      result.reject = RiskReject::kOpenOrders;
+    }
+    return result;
+  }
+
+  // The order accepted by Check() was filled at price: it is no longer open
+  // and price becomes the symbol's band reference.
+  auto OnFilled(const Result& result, const Decimal& price) -> void {
+    if (result.account != nullptr) {
+      result.account->open_orders.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (result.symbol >= 0) {
+      references_[result.symbol].units.store(price.Units(),
+                                             std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  struct alignas(kCacheLine) Reference {
+    std::atomic<std::int64_t> units{0};
+  };
+
+  auto SymbolIndex(std::string_view symbol) const -> int {
+    auto found = std::lower_bound(symbols_.begin(), symbols_.end(), symbol);
+    if (found == symbols_.end() || *found != symbol) {
+      return -1;
+    }
+    return static_cast<int>(found - symbols_.begin());
+  }
+
+  auto FindAccount(std::string_view name, bool claim) -> Account* {
+    if (name.size() > kMaxAccountLength || accounts_ == nullptr) {
+      return nullptr;
+    }
+
+    auto mask = capacity_ - 1;
+    auto slot = std::hash<std::string_view>{}(name)&mask;
+    for (std::size_t probe = 0; probe < capacity_; ++probe) {
+      auto& account = accounts_[slot];
+      auto state = account.state.load(std::memory_order_acquire);
+
+      if (state == kEmpty) {
+        if (!claim) {
+          return nullptr;
+        }
+        std::uint8_t expected{kEmpty};
+        if (account.state.compare_exchange_strong(expected, kClaiming,
+                                                  std::memory_order_acquire)) {
+          std::memcpy(account.name.data(), name.data(), name.size());
+          account.length = static_cast<std::uint8_t>(name.size());
+          account.state.store(kReady, std::memory_order_release);
+          return &account;
+        }
+        state = expected;
+      }
+
+      // Another worker is writing this slot's name; it takes nanoseconds.
+      while (state == kClaiming) {
+        std::this_thread::yield();
+        state = account.state.load(std::memory_order_acquire);
+      }
+
+      if (account.length == name.size() &&
+          std::memcmp(account.name.data(), name.data(), name.size()) == 0) {
+        return &account;
+      }
+      slot = (slot + 1) & mask;
+    }
+    return nullptr;
+  }
+
+  // One-second windows; a reset racing an increment can let a handful of
+  // extra orders through at the boundary.
+  auto CheckRate(Account& account, bool commit) -> bool {
+    auto second = TimeUtil::EpochNanos() / kNanosPerSecond;
+    auto window = account.rate_window.load(std::memory_order_relaxed);
+    if (!commit) {
+      return window != second ||
+             account.rate_count.load(std::memory_order_relaxed) <
+                 limits_.max_orders_per_second;
+    }
+
+    if (window != second && account.rate_window.compare_exchange_strong(
+                                window, second, std::memory_order_relaxed)) {
+      account.rate_count.store(0, std::memory_order_relaxed);
+    }
+    return account.rate_count.fetch_add(1, std::memory_order_relaxed) <
+           limits_.max_orders_per_second;
+  }
+
+  RiskLimits limits_;
+  std::vector<std::string> symbols_;
+  std::unique_ptr<Reference[]> references_;
+  std::size_t capacity_{0};
+  std::unique_ptr<Account[]> accounts_;
+};
+
+}  // namespace common
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <utility>
+
+namespace common {
+
+// QueueList policy for eventpp::EventQueue that keeps one FIFO lane per
+// priority class instead of re-sorting a single list on every splice.
+//
+// Classifier maps a queued event to a lane index, 0 being the most urgent.
+// Splicing an item in or out is O(1). begin() and iteration visit the most
+// urgent non-empty lane first, except that a lane which has been passed over
+// StarvationLimit times in a row while holding items is served first.
+//
+// Allocator must compare equal across instances so items can be spliced
+// between the queue and its free list.
+template <typename T, typename Classifier, std::size_t LaneCount,
+          std::size_t StarvationLimit = 64,
+          typename Allocator = std::allocator<T>>
+class PriorityQueueList {
+ private:
+  static_assert(LaneCount > 0, "PriorityQueueList needs at least one lane");
+
+  using Lane = std::list<T, Allocator>;
+  using Lanes = std::array<Lane, LaneCount>;
+
+  // Iteration starts in the lane chosen by begin() and then visits the
+  // remaining lanes in priority order.
+  static constexpr auto LaneAt(std::size_t start, std::size_t step)
+      -> std::size_t {
+    if (step == 0) {
+      return start;
+    }
+    return step <= start ? step - 1 : step;
+  }
+
+  template <bool Const>
+  class Iterator {
+   private:
+    using LanesPtr = std::conditional_t<Const, const Lanes*, Lanes*>;
+    using LaneIterator = std::conditional_t<Const, typename Lane::const_iterator,
+                                            typename Lane::iterator>;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    Iterator() = default;
+
+    Iterator(LanesPtr lanes, std::size_t start, std::size_t step,
+             LaneIterator it)
+        : lanes_(lanes), start_(start), step_(step), it_(it) {}
+
+    template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+    Iterator(const Iterator<OtherConst>& other)  // NOLINT
+        : lanes_(other.lanes_),
+          start_(other.start_),
+          step_(other.step_),
+          it_(other.it_) {}
+
+    auto operator*() const -> reference { return *it_; }
+    auto operator->() const -> pointer { return &*it_; }
+
+    auto operator++() -> Iterator& {
+      ++it_;
+      SkipEmpty();
+      return *this;
+    }
+
+    auto operator++(int) -> Iterator {
+      auto copy = *this;
+      ++(*this);
+      return copy;
+    }
+
+    template <bool OtherConst>
+    auto operator==(const Iterator<OtherConst>& other) const -> bool {
+      return step_ == other.step_ && (step_ == LaneCount || it_ == other.it_);
+    }
+
+    template <bool OtherConst>
+    auto operator!=(const Iterator<OtherConst>& other) const -> bool {
+      return !(*this == other);
+    }
+
+    auto GetLane() const -> std::size_t { return LaneAt(start_, step_); }
+
+    auto GetLaneIterator() const -> LaneIterator { return it_; }
+
+    // Moves to the first item at or after the current position, or to end().
+    auto SkipEmpty() -> void {
+      while (step_ < LaneCount && it_ == (*lanes_)[GetLane()].end()) {
+        if (++step_ < LaneCount) {
+          it_ = (*lanes_)[GetLane()].begin();
+        }
+      }
+      if (step_ == LaneCount) {
+        it_ = LaneIterator();
+      }
+    }
+
+   private:
+    template <bool>
+    friend class Iterator;
+
+    LanesPtr lanes_{nullptr};
+    std::size_t start_{0};
+    std::size_t step_{LaneCount};
+    LaneIterator it_{};
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  auto empty() const -> bool {
+    for (const auto& lane : lanes_) {
+      if (!lane.empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  auto size() const -> std::size_t {
+    std::size_t count{0};
+    for (const auto& lane : lanes_) {
+      count += lane.size();
+    }
+    return count;
+  }
+
+  auto LaneSize(std::size_t lane) const -> std::size_t {
+    return lanes_[lane].size();
+  }
+
+  auto begin() -> iterator {
+    auto start = SelectLane();
+    iterator it(&lanes_, start, 0, lanes_[start].begin());
+    it.SkipEmpty();
+    return it;
+  }
+
+  auto begin() const -> const_iterator {
+    auto start = SelectLane();
+    const_iterator it(&lanes_, start, 0, lanes_[start].begin());
+    it.SkipEmpty();
+    return it;
+  }
+
+  auto end() -> iterator { return iterator(&lanes_, 0, LaneCount, {}); }
+
+  auto end() const -> const_iterator {
+    return const_iterator(&lanes_, 0, LaneCount, {});
+  }
+
+  auto front() -> T& { return *begin(); }
+  auto front() const -> const T& { return *begin(); }
+
+  // Recycled (empty) items always live in the least urgent lane.
+  auto emplace_back() -> T& { return lanes_[LaneCount - 1].emplace_back(); }
+
+  auto swap(PriorityQueueList& other) noexcept -> void {
+    lanes_.swap(other.lanes_);
+    passed_over_.swap(other.passed_over_);
+  }
+
+  // Moves every item of other into the matching lane of this list, either
+  // ahead of (pos == begin()) or behind the items already queued.
+  auto splice(const_iterator pos, PriorityQueueList& other) -> void {
+    auto at_front = !empty() && pos == std::as_const(*this).begin();
+    for (std::size_t lane = 0; lane < LaneCount; ++lane) {
+      auto& target = lanes_[lane];
+      target.splice(at_front ? target.begin() : target.end(),
+                    other.lanes_[lane]);
+    }
+    other.passed_over_.fill(0);
+  }
+
+  // Moves the single item at it from other into the lane chosen by the
+  // Classifier.
+  auto splice(const_iterator pos, PriorityQueueList& other, const_iterator it)
+      -> void {
+    auto at_front = !empty() && pos == std::as_const(*this).begin();
+    auto source = it.GetLane();
+    auto& target = lanes_[Classify(*it)];
+    target.splice(at_front ? target.begin() : target.end(),
+                  other.lanes_[source], it.GetLaneIterator());
+    other.OnServed(source);
+  }
+
+ private:
+  static auto Classify(const T& item) -> std::size_t {
+    if (item.empty()) {
+      return LaneCount - 1;
+    }
+    auto lane = Classifier()(item.get());
+    return lane < LaneCount ? lane : LaneCount - 1;
+  }
+
+  auto SelectLane() const -> std::size_t {
+    for (auto lane = LaneCount; lane-- > 0;) {
+      if (passed_over_[lane] >= StarvationLimit && !lanes_[lane].empty()) {
+        return lane;
+      }
+    }
+    for (std::size_t lane = 0; lane < LaneCount; ++lane) {
+      if (!lanes_[lane].empty()) {
+        return lane;
+      }
+    }
+    return 0;
+  }
+
+  auto OnServed(std::size_t served) -> void {
+    passed_over_[served] = 0;
+    for (auto lane = served + 1; lane < LaneCount; ++lane) {
+      if (!lanes_[lane].empty()) {
+        ++passed_over_[lane];
+      }
+    }
+  }
+
+  Lanes lanes_{};
+  std::array<std::size_t, LaneCount> passed_over_{};
+};
+
+}  // namespace common
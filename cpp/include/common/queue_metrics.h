@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "common/latency_histogram.h"
+#include "common/time_util.h"
+
+namespace common {
+
+// eventpp mixin, listed in a queue's policies with
+//
+//   using Mixins = eventpp::MixinList<QueueMetrics>;
+//
+// counting what goes through an EventQueue: events enqueued and dispatched,
+// the depth and its high-water mark, and how long events sit before
+// process() dispatches them. Counters are relaxed atomics, read from any
+// thread with Metrics().
+//
+// Each enqueue() takes a TimeUtil::Cycles() stamp in arrival order, and
+// each queued dispatch is paired with the oldest stamp left. That is exact
+// for a FIFO queue; with PriorityQueueList's lanes it can swap which event
+// is charged which wait, but the mean, the spread and the oldest wait stay
+// right. Past kStampCapacity queued events the extra ones are not timed,
+// nor is anything enqueued before the last of them is dispatched; the
+// untimed run is tracked by FIFO position, so the dispatches skipped are
+// the run's own and every stamp still meets its event.
+template <typename Base>
+class QueueMetrics : public Base {
+ private:
+  static constexpr std::size_t kStampCapacity = 16384;
+
+  struct SpinLock {
+    auto lock() -> void {
+      while (locked_.test_and_set(std::memory_order_acquire)) {
+      }
+    }
+
+    auto unlock() -> void { locked_.clear(std::memory_order_release); }
+
+    std::atomic_flag locked_ = ATOMIC_FLAG_INIT;
+  };
+
+ public:
+  struct Snapshot {
+    std::uint64_t enqueued{0};
+    std::uint64_t dispatched{0};
+    std::uint64_t depth{0};
+    std::uint64_t high_water{0};
+    // How long the oldest event still queued has waited, 0 when empty.
+    std::uint64_t oldest_wait_nanos{0};
+    LatencyHistogram::Counts residency;
+  };
+
+  template <typename... A>
+  auto enqueue(A&&... args) -> void {
+    {
+      // Before the event is queued, so its dispatch always finds a stamp.
+      std::lock_guard<SpinLock> lock(stamps_lock_);
+      if (untimed_begin_ == untimed_end_ && stamp_count_ < kStampCapacity) {
+        stamps_[(stamp_head_ + stamp_count_) % kStampCapacity] =
+            TimeUtil::Cycles();
+        ++stamp_count_;
+      } else {
+        if (untimed_begin_ == untimed_end_) {
+          untimed_begin_ = untimed_end_ = in_position_;
+        }
+        ++untimed_end_;
+      }
+      ++in_position_;
+    }
+    auto enqueued = enqueued_.fetch_add(1, std::memory_order_relaxed) + 1;
+    auto depth = enqueued - dispatched_.load(std::memory_order_relaxed);
+    auto high_water = high_water_.load(std::memory_order_relaxed);
+    while (depth > high_water &&
+           !high_water_.compare_exchange_weak(high_water, depth,
+                                              std::memory_order_relaxed)) {
+    }
+    Base::enqueue(std::forward<A>(args)...);
+  }
+
+  auto process() -> bool {
+    Processing processing;
+    return Base::process();
+  }
+
+  auto processOne() -> bool {
+    Processing processing;
+    return Base::processOne();
+  }
+
+  template <typename F>
+  auto processIf(F&& func) -> bool {
+    Processing processing;
+    return Base::processIf(std::forward<F>(func));
+  }
+
+  template <typename QueuedEvent>
+  auto takeEvent(QueuedEvent* queued_event) -> bool {
+    if (!Base::takeEvent(queued_event)) {
+      return false;
+    }
+    Dequeued();
+    return true;
+  }
+
+  // Called by eventpp before each dispatch; only queued ones are counted.
+  template <typename... A>
+  auto mixinBeforeDispatch(A&&... /*args*/) const -> bool {
+    if (Processing::Depth() > 0) {
+      Dequeued();
+    }
+    return true;
+  }
+
+  auto Metrics() const -> Snapshot {
+    Snapshot snapshot;
+    snapshot.dispatched = dispatched_.load(std::memory_order_relaxed);
+    snapshot.enqueued = enqueued_.load(std::memory_order_relaxed);
+    snapshot.depth = snapshot.enqueued > snapshot.dispatched
+                         ? snapshot.enqueued - snapshot.dispatched
+                         : 0;
+    snapshot.high_water = high_water_.load(std::memory_order_relaxed);
+    snapshot.residency = residency_.Snapshot();
+
+    std::uint64_t oldest{0};
+    {
+      std::lock_guard<SpinLock> lock(stamps_lock_);
+      if (stamp_count_ > 0) {
+        oldest = stamps_[stamp_head_];
+      }
+    }
+    if (oldest != 0) {
+      auto now = TimeUtil::Cycles();
+      snapshot.oldest_wait_nanos =
+          now > oldest ? TimeUtil::CyclesToNanos(now - oldest) : 0;
+    }
+    return snapshot;
+  }
+
+ private:
+  // Marks this thread as dispatching from the queue, as opposed to a direct
+  // dispatch(), which the queue never held.
+  struct Processing {
+    Processing() { ++Depth(); }
+    ~Processing() { --Depth(); }
+
+    Processing(const Processing&) = delete;
+    auto operator=(const Processing&) -> Processing& = delete;
+
+    static auto Depth() -> int& {
+      thread_local int depth{0};
+      return depth;
+    }
+  };
+
+  auto Dequeued() const -> void {
+    std::uint64_t stamp{0};
+    {
+      std::lock_guard<SpinLock> lock(stamps_lock_);
+      auto position = out_position_++;
+      if (untimed_begin_ != untimed_end_ && position >= untimed_begin_) {
+        if (position + 1 >= untimed_end_) {
+          untimed_begin_ = untimed_end_;
+        }
+      } else if (stamp_count_ > 0) {
+        stamp = stamps_[stamp_head_];
+        stamp_head_ = (stamp_head_ + 1) % kStampCapacity;
+        --stamp_count_;
+      }
+    }
+    dispatched_.fetch_add(1, std::memory_order_relaxed);
+    if (stamp != 0) {
+      auto now = TimeUtil::Cycles();
+      residency_.Record(now > stamp ? TimeUtil::CyclesToNanos(now - stamp)
+                                    : 0);
+    }
+  }
+
+  // Dispatching is const in eventpp, hence mutable.
+  mutable SpinLock stamps_lock_;
+  mutable std::array<std::uint64_t, kStampCapacity> stamps_{};
+  mutable std::size_t stamp_head_{0};
+  mutable std::size_t stamp_count_{0};
+  // FIFO positions of the next event in and out, and the untimed run
+  // [untimed_begin_, untimed_end_), empty when the two are equal.
+  mutable std::uint64_t in_position_{0};
+  mutable std::uint64_t out_position_{0};
+  mutable std::uint64_t untimed_begin_{0};
+  mutable std::uint64_t untimed_end_{0};
+
+  std::atomic<std::uint64_t> enqueued_{0};
+  mutable std::atomic<std::uint64_t> dispatched_{0};
+  std::atomic<std::uint64_t> high_water_{0};
+  mutable LatencyHistogram residency_;
+};
+
+}  // namespace common
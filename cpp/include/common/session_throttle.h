@@ -0,0 +1,327 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "quickfix/Exceptions.h"
+#include "quickfix/SessionSettings.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// What happens to a message that finds its bucket empty.
+enum class ThrottleAction : std::uint8_t {
+  kReject,      // answer it with a reject and drop it
+  kQueue,       // hold it back until the bucket refills
+  kDisconnect,  // drop it and log the session out
+};
+
+enum class ThrottleDecision : std::uint8_t {
+  kAdmit,
+  kDeferred,
+  kReject,
+  kDisconnect,
+};
+
+// Tokens refill continuously at rate per second up to burst. A deferred
+// message takes its token in advance, driving the bucket negative; the debt
+// is how long the message must wait.
+class TokenBucket {
+ private:
+  static constexpr double kNanosPerSecond = 1e9;
+
+ public:
+  TokenBucket(double rate, double burst)
+      : rate_(rate), burst_(burst), tokens_(burst) {}
+
+  auto Refill(std::uint64_t now) -> void {
+    if (now > last_) {
+      if (last_ != 0) {
+        tokens_ = std::min(burst_, tokens_ + static_cast<double>(now - last_) *
+                                                 rate_ / kNanosPerSecond);
+      }
+      last_ = now;
+    }
+  }
+
+  auto Available() const -> bool { return tokens_ >= 1; }
+
+  // Whether a token can be borrowed without the debt passing max_debt tokens.
+  auto CanBorrow(double max_debt) const -> bool {
+    return tokens_ - 1 >= -max_debt;
+  }
+
+  // Takes a token, returning the nanoseconds until it was actually due.
+  auto Take() -> std::uint64_t {
+    tokens_ -= 1;
+    return tokens_ >= 0 ? 0
+                        : static_cast<std::uint64_t>(
+                              std::ceil(-tokens_ / rate_ * kNanosPerSecond));
+  }
+
+ private:
+  double rate_;
+  double burst_;
+  double tokens_;
+  std::uint64_t last_{0};
+};
+
+// Inbound application message throttles, one set per session, read from the
+// session settings (inherited from [DEFAULT] like any other key):
+//
+//   ThrottleRate=1000          messages per second, all MsgTypes together
+//   ThrottleBurst=100          defaults to ThrottleRate
+//   ThrottleMsgTypeRates=D:500,F:200
+//                              per MsgType, burst equal to the rate (at
+//                              least 1)
+//   ThrottleAction=reject      reject, queue or disconnect
+//   ThrottleQueueDepth=1000    messages held back per session when queueing;
+//                              beyond it they are rejected
+//
+// Admit() runs on the thread delivering the session's messages; QuickFIX
+// never delivers two messages for one session at once, so the buckets are
+// unsynchronized. Held-back Items are handed to Release() on another thread.
+template <typename Item>
+class SessionThrottles {
+ public:
+  static constexpr auto kThrottleRate = "ThrottleRate";
+  static constexpr auto kThrottleBurst = "ThrottleBurst";
+  static constexpr auto kThrottleMsgTypeRates = "ThrottleMsgTypeRates";
+  static constexpr auto kThrottleAction = "ThrottleAction";
+  static constexpr auto kThrottleQueueDepth = "ThrottleQueueDepth";
+
+  static constexpr std::size_t kDefaultQueueDepth = 1000;
+
+  static auto FromSettings(const FIX::SessionSettings& settings)
+      -> SessionThrottles {
+    SessionThrottles throttles;
+    for (const auto& session_id : settings.getSessions()) {
+      const auto& dictionary = settings.get(session_id);
+      if (!dictionary.has(kThrottleRate) &&
+          !dictionary.has(kThrottleMsgTypeRates)) {
+        continue;
+      }
+
+      auto throttle = std::make_unique<Throttle>();
+      if (dictionary.has(kThrottleRate)) {
+        auto rate =
+            CheckRate(kThrottleRate, dictionary.getDouble(kThrottleRate));
+        auto burst = dictionary.has(kThrottleBurst)
+                         ? dictionary.getDouble(kThrottleBurst)
+                         : rate;
+        throttle->session.emplace(rate, std::max(burst, 1.0));
+      }
+      if (dictionary.has(kThrottleMsgTypeRates)) {
+        std::stringstream list(dictionary.getString(kThrottleMsgTypeRates));
+        std::string entry;
+        while (std::getline(list, entry, ',')) {
+          auto colon = entry.find(':');
+          if (colon == std::string::npos) {
+            throw FIX::ConfigError(std::string(kThrottleMsgTypeRates) +
+                                   ": expected MsgType:rate, got " + entry);
+          }
+          auto text = entry.substr(colon + 1);
+          double rate{0};
+          auto [end, error] =
+              std::from_chars(text.data(), text.data() + text.size(), rate);
+          if (error != std::errc() || end != text.data() + text.size()) {
+            throw FIX::ConfigError(std::string(kThrottleMsgTypeRates) +
+                                   ": expected MsgType:rate, got " + entry);
+          }
+          throttle->msg_types.emplace_back(
+              entry.substr(0, colon),
+              TokenBucket(CheckRate(std::string(kThrottleMsgTypeRates) +
+                                        " entry " + entry,
+                                    rate),
+                          std::max(rate, 1.0)));
+        }
+      }
+      if (dictionary.has(kThrottleAction)) {
+        throttle->action = ParseAction(dictionary.getString(kThrottleAction));
+      }
+      throttle->queue_depth =
+          dictionary.has(kThrottleQueueDepth)
+              ? static_cast<double>(dictionary.getInt(kThrottleQueueDepth))
+              : kDefaultQueueDepth;
+
+      throttles.throttles_.emplace_back(session_id, std::move(throttle));
+    }
+    return throttles;
+  }
+
+  // Sessions without throttles always admit. make_item is only called for a
+  // message that is held back.
+  template <typename MakeItem>
+  auto Admit(const FIX::SessionID& session_id, const std::string& msg_type,
+             std::uint64_t now, MakeItem&& make_item) -> ThrottleDecision {
+    auto* throttle = Find(session_id);
+    if (throttle == nullptr) {
+      return ThrottleDecision::kAdmit;
+    }
+
+    TokenBucket* type_bucket{nullptr};
+    for (auto& [type, bucket] : throttle->msg_types) {
+      if (type == msg_type) {
+        type_bucket = &bucket;
+        break;
+      }
+    }
+
+    auto& session = throttle->session;
+    if (session) {
+      session->Refill(now);
+    }
+    if (type_bucket != nullptr) {
+      type_bucket->Refill(now);
+    }
+
+    // Anything already held back goes first, whatever the buckets say.
+    auto backlog = throttle->pending.load(std::memory_order_acquire) != 0;
+    if (!backlog && (!session || session->Available()) &&
+        (type_bucket == nullptr || type_bucket->Available())) {
+      if (session) {
+        session->Take();
+      }
+      if (type_bucket != nullptr) {
+        type_bucket->Take();
+      }
+      throttle->admitted.fetch_add(1, std::memory_order_relaxed);
+      return ThrottleDecision::kAdmit;
+    }
+
+    if (throttle->action == ThrottleAction::kQueue &&
+        (!session || session->CanBorrow(throttle->queue_depth)) &&
+        (type_bucket == nullptr ||
+         type_bucket->CanBorrow(throttle->queue_depth))) {
+      std::uint64_t delay{0};
+      if (session) {
+        delay = session->Take();
+      }
+      if (type_bucket != nullptr) {
+        delay = std::max(delay, type_bucket->Take());
+      }
+      // Release times must not go backwards within a session.
+      auto release_at = std::max(now + delay, throttle->last_release);
+      throttle->last_release = release_at;
+      {
+        std::lock_guard<std::mutex> lock(throttle->mutex);
+        throttle->deferred.emplace_back(release_at, make_item());
+      }
+      throttle->pending.fetch_add(1, std::memory_order_release);
+      throttle->queued.fetch_add(1, std::memory_order_relaxed);
+      return ThrottleDecision::kDeferred;
+    }
+
+    if (throttle->action == ThrottleAction::kDisconnect) {
+      throttle->disconnected.fetch_add(1, std::memory_order_relaxed);
+      return ThrottleDecision::kDisconnect;
+    }
+    throttle->rejected.fetch_add(1, std::memory_order_relaxed);
+    return ThrottleDecision::kReject;
+  }
+
+  // Hands every held-back Item due by now to release, in arrival order per
+  // session. Returns the earliest release time still pending, 0 for none.
+  template <typename OnRelease>
+  auto Release(std::uint64_t now, OnRelease&& release) -> std::uint64_t {
+    std::uint64_t next{0};
+    for (auto& [session_id, throttle] : throttles_) {
+      if (throttle->pending.load(std::memory_order_acquire) == 0) {
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(throttle->mutex);
+      auto& deferred = throttle->deferred;
+      while (!deferred.empty() && deferred.front().first <= now) {
+        auto item = std::move(deferred.front().second);
+        deferred.pop_front();
+        lock.unlock();
+        release(item);
+        throttle->pending.fetch_sub(1, std::memory_order_release);
+        lock.lock();
+      }
+      if (!deferred.empty() &&
+          (next == 0 || deferred.front().first < next)) {
+        next = deferred.front().first;
+      }
+    }
+    return next;
+  }
+
+  auto LogStats() const -> void {
+    for (const auto& [session_id, throttle] : throttles_) {
+      spdlog::info(
+          "throttle {}: admitted {}, queued {}, rejected {}, disconnected {}",
+          session_id.toString(),
+          throttle->admitted.load(std::memory_order_relaxed),
+          throttle->queued.load(std::memory_order_relaxed),
+          throttle->rejected.load(std::memory_order_relaxed),
+          throttle->disconnected.load(std::memory_order_relaxed));
+    }
+  }
+
+ private:
+  struct Throttle {
+    std::optional<TokenBucket> session;
+    std::vector<std::pair<std::string, TokenBucket>> msg_types;
+    ThrottleAction action{ThrottleAction::kReject};
+    double queue_depth{kDefaultQueueDepth};
+    std::uint64_t last_release{0};
+
+    std::mutex mutex;
+    std::deque<std::pair<std::uint64_t, Item>> deferred;
+    std::atomic<std::size_t> pending{0};
+
+    std::atomic<std::size_t> admitted{0};
+    std::atomic<std::size_t> queued{0};
+    std::atomic<std::size_t> rejected{0};
+    std::atomic<std::size_t> disconnected{0};
+  };
+
+  // A bucket that never refills would divide by zero in Take().
+  static auto CheckRate(const std::string& what, double rate) -> double {
+    if (!(rate > 0) || !std::isfinite(rate)) {
+      throw FIX::ConfigError(what + ": rate must be a positive number");
+    }
+    return rate;
+  }
+
+  static auto ParseAction(const std::string& action) -> ThrottleAction {
+    if (action == "reject") {
+      return ThrottleAction::kReject;
+    }
+    if (action == "queue") {
+      return ThrottleAction::kQueue;
+    }
+    if (action == "disconnect") {
+      return ThrottleAction::kDisconnect;
+    }
+    throw FIX::ConfigError(std::string(kThrottleAction) +
+                           ": expected reject, queue or disconnect, got " +
+                           action);
+  }
+
+  auto Find(const FIX::SessionID& session_id) -> Throttle* {
+    for (auto& [id, throttle] : throttles_) {
+      if (id == session_id) {
+        return throttle.get();
+      }
+    }
+    return nullptr;
+  }
+
+  std::vector<std::pair<FIX::SessionID, std::unique_ptr<Throttle>>> throttles_;
+};
+
+}  // namespace common
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/spsc_queue.h"
+
+namespace common {
+
+// N single-threaded workers, each fed by its own SPSC ring from one router
+// thread. Whatever a worker produces is posted to a per-worker outbound ring
+// and handed to the sender on a single sender thread, so output from any one
+// worker keeps its order. The optional sender flush runs after every pass
+// over the rings that sent something.
+//
+// An idle thread spins, then yields, then sleeps kParkInterval at a time, so
+// the workers cost next to nothing with no orders flowing; with busy_poll
+// they never sleep, trading a core each for wake-up latency.
+//
+// A worker's rings are allocated and constructed on the worker thread after
+// its start hook has run, so once the hook pins the thread the ring memory is
+// first touched on (and placed on) that cpu's NUMA node. The Allocator must
+// not hand out memory faulted in elsewhere; PoolAllocator takes arrays from
+// the heap for this reason.
+template <typename Inbound, typename Outbound,
+          template <typename> class Allocator = std::allocator>
+class ShardedWorkers {
+ public:
+  using InboundQueue = SpscQueue<Inbound, Allocator<Inbound>>;
+  using OutboundQueue = SpscQueue<Outbound, Allocator<Outbound>>;
+
+ private:
+  static constexpr auto kSpinCount = 256;
+  static constexpr auto kYieldCount = 4096;
+  static constexpr auto kParkInterval = std::chrono::microseconds(100);
+
+  // Spin briefly on an empty (or full) ring before giving up the core, and
+  // sleep once it has stayed that way for a while.
+  struct Backoff {
+    explicit Backoff(bool busy_poll) : busy_poll_(busy_poll) {}
+
+    auto Idle() -> void {
+      if (spins_ < kYieldCount) {
+        ++spins_;
+      }
+      if (spins_ <= kSpinCount) {
+        return;
+      }
+      if (busy_poll_ || spins_ < kYieldCount) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(kParkInterval);
+      }
+    }
+
+    auto Reset() -> void { spins_ = 0; }
+
+    bool busy_poll_;
+    int spins_{0};
+  };
+
+ public:
+  class Outbox {
+   public:
+    Outbox(std::size_t ring_size, bool busy_poll)
+        : queue_(ring_size), busy_poll_(busy_poll) {}
+
+    // Called from the owning worker thread only.
+    auto Post(Outbound&& item) -> void {
+      Backoff backoff(busy_poll_);
+      while (!queue_.TryPush(std::move(item))) {
+        backoff.Idle();
+      }
+    }
+
+   private:
+    friend class ShardedWorkers;
+    OutboundQueue queue_;
+    bool busy_poll_;
+  };
+
+  using Handler = std::function<void(Inbound&, Outbox&)>;
+  using Sender = std::function<void(Outbound&)>;
+  using SenderFlush = std::function<void()>;
+  using WorkerStart = std::function<void(std::size_t shard)>;
+  using SenderStart = std::function<void()>;
+
+  ShardedWorkers(std::size_t shard_count, std::size_t ring_size,
+                 Handler handler, Sender sender,
+                 SenderFlush sender_flush = nullptr)
+      : ring_size_(ring_size),
+        handler_(std::move(handler)),
+        sender_(std::move(sender)),
+        sender_flush_(std::move(sender_flush)) {
+    shards_.reserve(shard_count > 0 ? shard_count : 1);
+    do {
+      shards_.emplace_back(std::make_unique<Shard>());
+    } while (shards_.size() < shard_count);
+  }
+
+  ShardedWorkers(const ShardedWorkers&) = delete;
+  auto operator=(const ShardedWorkers&) -> ShardedWorkers& = delete;
+
+  ~ShardedWorkers() { Stop(); }
+
+  // Returns once every worker has run its start hook and allocated its
+  // rings; Route() must not be called before that.
+  auto Start(const WorkerStart& on_worker_start = nullptr,
+             const SenderStart& on_sender_start = nullptr,
+             bool busy_poll = false) -> void {
+    if (sender_thread_.joinable()) {
+      return;
+    }
+
+    busy_poll_ = busy_poll;
+    workers_running_ = true;
+    sender_running_ = true;
+
+    std::atomic<std::size_t> ready{0};
+    for (std::size_t index = 0; index < shards_.size(); ++index) {
+      shards_[index]->thread = std::thread([&, index]() {
+        auto& shard = *shards_[index];
+        if (on_worker_start) {
+          on_worker_start(index);
+        }
+        shard.inbound = std::make_unique<InboundQueue>(ring_size_);
+        shard.outbox = std::make_unique<Outbox>(ring_size_, busy_poll_);
+        ++ready;
+        Work(shard);
+      });
+    }
+
+    while (ready < shards_.size()) {
+      std::this_thread::yield();
+    }
+
+    sender_thread_ = std::thread([this, on_sender_start]() {
+      if (on_sender_start) {
+        on_sender_start();
+      }
+      Send();
+    });
+  }
+
+  // Lets every worker drain its inbound ring, then flushes what they posted.
+  auto Stop() -> void {
+    if (!sender_thread_.joinable()) {
+      return;
+    }
+
+    workers_running_ = false;
+    for (auto& shard : shards_) {
+      shard->thread.join();
+    }
+
+    sender_running_ = false;
+    sender_thread_.join();
+  }
+
+  auto ShardCount() const -> std::size_t { return shards_.size(); }
+
+  auto ShardFor(std::size_t hash) const -> std::size_t {
+    return hash % shards_.size();
+  }
+
+  // Called from the single router thread only. Blocks while the shard's ring
+  // is full, which pushes back on the router rather than dropping orders.
+  auto Route(std::size_t shard, Inbound&& item) -> void {
+    auto& queue = *shards_[shard]->inbound;
+    Backoff backoff(busy_poll_);
+    while (!queue.TryPush(std::move(item))) {
+      backoff.Idle();
+    }
+  }
+
+ private:
+  struct Shard {
+    std::unique_ptr<InboundQueue> inbound;
+    std::unique_ptr<Outbox> outbox;
+    std::thread thread;
+  };
+
+  auto Work(Shard& shard) -> void {
+    Inbound item;
+    Backoff backoff(busy_poll_);
+    while (true) {
+      // Sample the flag first so nothing routed before Stop() is left behind.
+      auto running = workers_running_.load();
+      if (shard.inbound->TryPop(item)) {
+        handler_(item, *shard.outbox);
+        backoff.Reset();
+      } else if (!running) {
+        break;
+      } else {
+        backoff.Idle();
+      }
+    }
+  }
+
+  auto Send() -> void {
+    Outbound item;
+    Backoff backoff(busy_poll_);
+    while (true) {
+      auto running = sender_running_.load();
+      auto sent = false;
+      for (auto& shard : shards_) {
+        while (shard->outbox->queue_.TryPop(item)) {
+          sender_(item);
+          sent = true;
+        }
+      }
+
+      if (sent) {
+        if (sender_flush_) {
+          sender_flush_();
+        }
+        backoff.Reset();
+      } else if (!running) {
+        break;
+      } else {
+        backoff.Idle();
+      }
+    }
+  }
+
+  std::size_t ring_size_;
+  Handler handler_;
+  Sender sender_;
+  SenderFlush sender_flush_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::thread sender_thread_;
+  bool busy_poll_{false};
+  std::atomic<bool> workers_running_{false};
+  std::atomic<bool> sender_running_{false};
+};
+
+}  // namespace common
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace common {
+
+// Bounded single-producer / single-consumer ring. Capacity is rounded up to a
+// power of two. Producer and consumer indices live on separate cache lines and
+// each side keeps a cached copy of the other's index so the shared lines are
+// only touched when the ring looks full (or empty). Slots are allocated and
+// default-constructed up front.
+template <typename T, typename Allocator = std::allocator<T>>
+class SpscQueue {
+ private:
+  static constexpr std::size_t kCacheLine = 64;
+
+  using AllocatorTraits = std::allocator_traits<Allocator>;
+
+  static auto RoundUp(std::size_t capacity) -> std::size_t {
+    std::size_t size{2};
+    while (size < capacity) {
+      size <<= 1U;
+    }
+    return size;
+  }
+
+ public:
+  explicit SpscQueue(std::size_t capacity,
+                     const Allocator& allocator = Allocator())
+      : mask_(RoundUp(capacity) - 1),
+        allocator_(allocator),
+        slots_(AllocatorTraits::allocate(allocator_, mask_ + 1)) {
+    for (std::size_t slot = 0; slot <= mask_; ++slot) {
+      AllocatorTraits::construct(allocator_, slots_ + slot);
+    }
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  auto operator=(const SpscQueue&) -> SpscQueue& = delete;
+
+  ~SpscQueue() {
+    for (std::size_t slot = 0; slot <= mask_; ++slot) {
+      AllocatorTraits::destroy(allocator_, slots_ + slot);
+    }
+    AllocatorTraits::deallocate(allocator_, slots_, mask_ + 1);
+  }
+
+  // Producer side.
+  auto TryPush(T&& item) -> bool {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  auto TryPop(T& item) -> bool {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    item = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  auto Empty() const -> bool {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  auto Size() const -> std::size_t {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  auto Capacity() const -> std::size_t { return mask_ + 1; }
+
+ private:
+  const std::size_t mask_;
+  Allocator allocator_;
+  T* slots_;
+
+  alignas(kCacheLine) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_{0};
+
+  alignas(kCacheLine) std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_{0};
+};
+
+}  // namespace common
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "quickfix/Dictionary.h"
+#include "quickfix/Exceptions.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+// Where a thread should run: a cpu to pin to (-1 leaves it floating) and a
+// SCHED_FIFO priority (0 keeps the default scheduler).
+struct ThreadPlacement {
+  int cpu{-1};
+  int priority{0};
+};
+
+// Thread placement read from the [DEFAULT] section of the session settings:
+//
+//   ProcessThreadCpu=1
+//   IoThreadCpu=2
+//   SenderThreadCpu=3
+//   JournalThreadCpu=8
+//   BookThreadCpus=4,5,6,7
+//   EventLoopCpus=9,10
+//   ThreadPriority=10
+//   BusyPoll=Y
+//
+// Every key is optional. Book workers and event loops beyond the listed cpus
+// float. BusyPoll keeps idle book workers and the sender spinning instead of
+// sleeping; worth it only with them pinned to cores of their own.
+struct ThreadConfig {
+  static constexpr auto kProcessThreadCpu = "ProcessThreadCpu";
+  static constexpr auto kIoThreadCpu = "IoThreadCpu";
+  static constexpr auto kSenderThreadCpu = "SenderThreadCpu";
+  static constexpr auto kJournalThreadCpu = "JournalThreadCpu";
+  static constexpr auto kBookThreadCpus = "BookThreadCpus";
+  static constexpr auto kEventLoopCpus = "EventLoopCpus";
+  static constexpr auto kThreadPriority = "ThreadPriority";
+  static constexpr auto kBusyPoll = "BusyPoll";
+
+  ThreadPlacement process;
+  ThreadPlacement io;
+  ThreadPlacement sender;
+  ThreadPlacement journal;
+  std::vector<ThreadPlacement> books;
+  std::vector<ThreadPlacement> loops;
+  bool busy_poll{false};
+
+  static auto FromSettings(const FIX::Dictionary& settings) -> ThreadConfig {
+    ThreadConfig config;
+    auto priority = GetInt(settings, kThreadPriority, 0);
+
+    config.process = {GetCpu(settings, kProcessThreadCpu), priority};
+    config.io = {GetCpu(settings, kIoThreadCpu), priority};
+    config.sender = {GetCpu(settings, kSenderThreadCpu), priority};
+    // The journal writer is never latency critical, so it stays off SCHED_FIFO.
+    config.journal = {GetCpu(settings, kJournalThreadCpu), 0};
+
+    config.books = GetCpus(settings, kBookThreadCpus, priority);
+    config.loops = GetCpus(settings, kEventLoopCpus, priority);
+    config.busy_poll = settings.has(kBusyPoll) && settings.getBool(kBusyPoll);
+
+    return config;
+  }
+
+  auto Book(std::size_t shard) const -> ThreadPlacement {
+    return shard < books.size() ? books[shard] : ThreadPlacement{};
+  }
+
+  auto Loop(std::size_t index) const -> ThreadPlacement {
+    return index < loops.size() ? loops[index] : ThreadPlacement{};
+  }
+
+ private:
+  static auto GetInt(const FIX::Dictionary& settings, const std::string& key,
+                     int fallback) -> int {
+    return settings.has(key) ? settings.getInt(key) : fallback;
+  }
+
+  // -1 (floating) when unset or set to -1.
+  static auto GetCpu(const FIX::Dictionary& settings, const std::string& key)
+      -> int {
+    auto cpu = GetInt(settings, key, -1);
+    return cpu == -1 ? cpu : CheckCpu(key, cpu);
+  }
+
+  static auto GetCpus(const FIX::Dictionary& settings, const std::string& key,
+                      int priority) -> std::vector<ThreadPlacement> {
+    std::vector<ThreadPlacement> placements;
+    if (settings.has(key)) {
+      std::stringstream cpus(settings.getString(key));
+      std::string cpu;
+      while (std::getline(cpus, cpu, ',')) {
+        auto first = cpu.find_first_not_of(' ');
+        cpu = first == std::string::npos
+                  ? std::string()
+                  : cpu.substr(first, cpu.find_last_not_of(' ') + 1 - first);
+        int value{0};
+        auto [end, error] =
+            std::from_chars(cpu.data(), cpu.data() + cpu.size(), value);
+        if (error != std::errc() || end != cpu.data() + cpu.size()) {
+          throw FIX::ConfigError(key + ": '" + cpu + "' is not a cpu number");
+        }
+        placements.push_back({CheckCpu(key, value), priority});
+      }
+    }
+    return placements;
+  }
+
+  // Only numbers no machine could have; a cpu missing from this one is
+  // left to Place() to warn about.
+  static auto CheckCpu(const std::string& key, int cpu) -> int {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      throw FIX::ConfigError(key + ": cpu " + std::to_string(cpu) +
+                             " is out of range");
+    }
+    return cpu;
+  }
+};
+
+struct ThreadUtil {
+  // Pins and names the calling thread. Failures are logged, not fatal: a
+  // missing cpu or CAP_SYS_NICE should not keep the engine from starting.
+  static auto Place(const ThreadPlacement& placement, const std::string& name)
+      -> void {
+    Placed() = true;
+    pthread_setname_np(pthread_self(), name.substr(0, kMaxNameLength).c_str());
+
+    if (placement.cpu >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(placement.cpu, &cpus);
+      auto rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (rc != 0) {
+        spdlog::warn("{}: unable to pin to cpu {}: {}", name, placement.cpu,
+                     std::strerror(rc));
+      }
+    }
+
+    if (placement.priority > 0) {
+      sched_param param{};
+      param.sched_priority = placement.priority;
+      auto rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if (rc != 0) {
+        spdlog::warn("{}: unable to set SCHED_FIFO priority {}: {}", name,
+                     placement.priority, std::strerror(rc));
+      }
+    }
+
+    unsigned cpu{0};
+    unsigned node{0};
+    syscall(SYS_getcpu, &cpu, &node, nullptr);
+    spdlog::info("{} thread running on cpu {}, numa node {}", name, cpu, node);
+  }
+
+  // For threads we don't create (QuickFIX's socket threads): places the
+  // calling thread the first time it reaches this point, unless it has been
+  // placed already (our own transport's event loops).
+  static auto PlaceOnce(const ThreadPlacement& placement,
+                        const std::string& name) -> void {
+    if (!Placed()) {
+      Place(placement, name);
+    }
+  }
+
+ private:
+  static constexpr std::size_t kMaxNameLength = 15;
+
+  static auto Placed() -> bool& {
+    thread_local bool placed{false};
+    return placed;
+  }
+};
+
+}  // namespace common
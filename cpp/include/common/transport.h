@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "common/event_loop.h"
+#include "common/io_uring.h"
+#include "common/loop_acceptor.h"
+#include "common/loop_initiator.h"
+#include "common/thread_util.h"
+#include "common/transport_config.h"
+#include "common/uring_loop.h"
+#include "quickfix/Exceptions.h"
+#include "quickfix/SocketAcceptor.h"
+#include "quickfix/SocketInitiator.h"
+#include "spdlog/spdlog.h"
+
+namespace common {
+
+using EpollAcceptor = LoopAcceptor<EventLoop>;
+using UringAcceptor = LoopAcceptor<UringLoop>;
+using EpollInitiator = LoopInitiator<EventLoop>;
+using UringInitiator = LoopInitiator<UringLoop>;
+
+// Transport=io_uring on a kernel (or under a seccomp policy) without it
+// runs on epoll instead.
+inline auto ResolveTransport(const TransportConfig& config) -> std::string {
+  if (config.transport == TransportConfig::kIoUring && !IoUring::Available()) {
+    spdlog::warn("io_uring is not available here, using epoll");
+    return TransportConfig::kEpoll;
+  }
+  return config.transport;
+}
+
+// QuickFIX's own sockets do not check BodyLength and CheckSum before the
+// session sees a message, so turning the session's check off there leaves
+// none at all.
+inline auto WarnUncheckedSessions(const FIX::SessionSettings& settings)
+    -> void {
+  static constexpr auto kValidateLengthAndChecksum =
+      "ValidateLengthAndChecksum";
+  for (const auto& session_id : settings.getSessions()) {
+    const auto& dictionary = settings.get(session_id);
+    if (dictionary.has(kValidateLengthAndChecksum) &&
+        !dictionary.getBool(kValidateLengthAndChecksum)) {
+      spdlog::warn("{}: {}=N on the socket transport, BodyLength and "
+                   "CheckSum are not checked",
+                   session_id.toString(), kValidateLengthAndChecksum);
+    }
+  }
+}
+
+// The acceptor for Transport, socket unless set.
+inline auto MakeAcceptor(FIX::Application& application,
+                         FIX::MessageStoreFactory& store_factory,
+                         const FIX::SessionSettings& settings,
+                         FIX::LogFactory& log_factory,
+                         const TransportConfig& config,
+                         const ThreadConfig& threads)
+    -> std::unique_ptr<FIX::Acceptor> {
+  auto transport = ResolveTransport(config);
+  if (transport == TransportConfig::kIoUring) {
+    return std::make_unique<UringAcceptor>(application, store_factory,
+                                           settings, log_factory, config,
+                                           threads);
+  }
+  if (transport == TransportConfig::kEpoll) {
+    return std::make_unique<EpollAcceptor>(application, store_factory,
+                                           settings, log_factory, config,
+                                           threads);
+  }
+  if (transport == TransportConfig::kSocket) {
+    WarnUncheckedSessions(settings);
+    return std::make_unique<FIX::SocketAcceptor>(application, store_factory,
+                                                 settings, log_factory);
+  }
+  throw FIX::ConfigError("unknown Transport " + transport);
+}
+
+// The initiator for Transport, likewise.
+inline auto MakeInitiator(FIX::Application& application,
+                          FIX::MessageStoreFactory& store_factory,
+                          const FIX::SessionSettings& settings,
+                          FIX::LogFactory& log_factory,
+                          const TransportConfig& config,
+                          const ThreadConfig& threads)
+    -> std::unique_ptr<FIX::Initiator> {
+  auto transport = ResolveTransport(config);
+  if (transport == TransportConfig::kIoUring) {
+    return std::make_unique<UringInitiator>(application, store_factory,
+                                            settings, log_factory, config,
+                                            threads);
+  }
+  if (transport == TransportConfig::kEpoll) {
+    return std::make_unique<EpollInitiator>(application, store_factory,
+                                            settings, log_factory, config,
+                                            threads);
+  }
+  if (transport == TransportConfig::kSocket) {
+    WarnUncheckedSessions(settings);
+    return std::make_unique<FIX::SocketInitiator>(application, store_factory,
+                                                  settings, log_factory);
+  }
+  throw FIX::ConfigError("unknown Transport " + transport);
+}
+
+}  // namespace common
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "quickfix/Dictionary.h"
+
+namespace common {
+
+// Socket transport read from the [DEFAULT] section of the session settings:
+//
+//   Transport=epoll            socket (QuickFIX's own, the default), epoll or
+//                              io_uring, which falls back to epoll where
+//                              the kernel does not have it
+//   EventLoops=4               loops sessions are spread over; defaults to
+//                              one per EventLoopCpus entry, at least one
+//   SendBatchMessages=64       per connection, before a batch is written early
+//   SendBatchDelayMicros=50    oldest held-back message, ditto
+//   SendQueueBytes=16777216    unsent bytes per connection before its
+//                              session is disconnected
+//
+// Event loops and batching only apply to the epoll and io_uring transports.
+struct TransportConfig {
+  static constexpr auto kTransport = "Transport";
+  static constexpr auto kEventLoops = "EventLoops";
+  static constexpr auto kSendBatchMessages = "SendBatchMessages";
+  static constexpr auto kSendBatchDelayMicros = "SendBatchDelayMicros";
+  static constexpr auto kSendQueueBytes = "SendQueueBytes";
+
+  static constexpr auto kSocket = "socket";
+  static constexpr auto kEpoll = "epoll";
+  static constexpr auto kIoUring = "io_uring";
+
+  static constexpr std::size_t kDefaultBatchMessages = 64;
+  static constexpr std::uint64_t kDefaultBatchDelayMicros = 50;
+  static constexpr std::size_t kDefaultSendQueueBytes = 16 << 20;
+
+  std::string transport{kSocket};
+  std::size_t event_loops{0};
+  std::size_t batch_messages{kDefaultBatchMessages};
+  std::uint64_t batch_delay_nanos{kDefaultBatchDelayMicros * 1000};
+  std::size_t send_queue_bytes{kDefaultSendQueueBytes};
+
+  static auto FromSettings(const FIX::Dictionary& settings) -> TransportConfig {
+    TransportConfig config;
+    if (settings.has(kTransport)) {
+      config.transport = settings.getString(kTransport);
+    }
+    if (settings.has(kEventLoops)) {
+      config.event_loops =
+          static_cast<std::size_t>(settings.getInt(kEventLoops));
+    }
+    if (settings.has(kSendBatchMessages)) {
+      config.batch_messages =
+          static_cast<std::size_t>(settings.getInt(kSendBatchMessages));
+    }
+    if (settings.has(kSendBatchDelayMicros)) {
+      config.batch_delay_nanos =
+          static_cast<std::uint64_t>(settings.getInt(kSendBatchDelayMicros)) *
+          1000;
+    }
+    if (settings.has(kSendQueueBytes)) {
+      config.send_queue_bytes =
+          static_cast<std::size_t>(settings.getInt(kSendQueueBytes));
+    }
+    return config;
+  }
+};
+
+}  // namespace common
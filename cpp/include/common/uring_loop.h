@@ -0,0 +1,195 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/connection_loop.h"
+#include "common/io_uring.h"
+#include "common/transport_config.h"
+#include "quickfix/Exceptions.h"
+
+namespace common {
+
+// A ConnectionLoop on io_uring. Every connection has one multishot receive
+// armed, which the kernel completes each time data arrives, in a buffer it
+// picks from the loop's registered buffer ring; the data is framed from
+// the connection's receive buffer like on epoll, and the ring buffer handed
+// straight back. A pass submits every re-arm and waits for completions in
+// one system call, where epoll needs a read per connection per wakeup.
+//
+// Sends stay with BatchedConnection, which sessions also use from other
+// threads; a connection whose socket fills up has a POLLOUT armed until it
+// drains. Kernels without multishot receive (before 6.0) get a single-shot
+// receive re-armed after each completion.
+class UringLoop : public ConnectionLoop {
+ private:
+  static constexpr unsigned kEntries = 256;
+  static constexpr std::size_t kBufferCount = 256;  // a power of two
+  static constexpr std::size_t kBufferSize = 16384;
+  static constexpr std::uint16_t kBufferGroup = 0;
+
+  // What a completion is for, in the low bits of its user_data; the rest
+  // is the peer id.
+  enum Operation : std::uint64_t { kReceive = 0, kWritable = 1, kWake = 2 };
+  static constexpr std::uint64_t kOperationBits = 2;
+  static constexpr std::uint64_t kOperationMask = (1U << kOperationBits) - 1;
+
+ public:
+  static constexpr auto kKind = "io_uring";
+
+  UringLoop(std::string name, SessionLookup lookup,
+            const TransportConfig& config, Disconnected disconnected = nullptr)
+      : ConnectionLoop(std::move(name), std::move(lookup), config,
+                       std::move(disconnected)),
+        ring_(kEntries),
+        wake_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (wake_fd_ < 0) {
+      throw FIX::RuntimeError(Name() + ": " + std::strerror(errno));
+    }
+    ring_.ProvideBuffers(kBufferCount, kBufferSize, kBufferGroup);
+    ArmWake();
+  }
+
+  ~UringLoop() override {
+    Stop();
+    CloseAll();
+    ::close(wake_fd_);
+  }
+
+ private:
+  auto Wait(int timeout_millis) -> void override {
+    ArmBlocked();
+    ring_.Enter(timeout_millis);
+    ring_.ForEachCompletion(
+        [this](const io_uring_cqe& completion) { Complete(completion); });
+  }
+
+  auto Wake() -> void override {
+    std::uint64_t wake{1};
+    static_cast<void>(::write(wake_fd_, &wake, sizeof(wake)));
+  }
+
+  auto Watch(Peer& peer) -> void override {
+    auto id = peer.id;
+    peer.connection->OnBlocked([this, id]() {
+      {
+        std::lock_guard<std::mutex> lock(blocked_mutex_);
+        blocked_.push_back(id);
+      }
+      Wake();
+    });
+    ArmReceive(peer);
+  }
+
+  // The armed operations finish, and are ignored, once the socket is shut
+  // down; closing it alone would leave them holding it open. Anything still
+  // unsubmitted goes first, so nothing can find the descriptor reused.
+  auto Unwatch(Peer& peer) -> void override {
+    ring_.Enter(0);
+    ::shutdown(peer.connection->Fd(), SHUT_RDWR);
+  }
+
+  auto Complete(const io_uring_cqe& completion) -> void {
+    auto operation = completion.user_data & kOperationMask;
+    if (operation == kWake) {
+      ArmWake();
+      TakeAdopted();
+      return;
+    }
+
+    auto* peer = Find(completion.user_data >> kOperationBits);
+    if (operation == kWritable) {
+      if (peer != nullptr) {
+        peer->connection->Flush();
+      }
+      return;
+    }
+
+    auto received{true};
+    if ((completion.flags & IORING_CQE_F_BUFFER) != 0) {
+      auto buffer = static_cast<std::uint16_t>(completion.flags >>
+                                               IORING_CQE_BUFFER_SHIFT);
+      if (peer != nullptr && completion.res > 0) {
+        received = Receive(*peer, ring_.Buffer(buffer),
+                           static_cast<std::size_t>(completion.res));
+      }
+      ring_.Recycle(buffer);
+    }
+    if (peer == nullptr) {
+      return;
+    }
+
+    if (completion.res == -EINVAL && multishot_) {
+      spdlog::info("{}: no multishot receive, re-arming each time", Name());
+      multishot_ = false;
+    } else if (completion.res == 0 ||
+               (completion.res < 0 && completion.res != -ENOBUFS &&
+                completion.res != -EINTR && completion.res != -EAGAIN)) {
+      received = false;
+    }
+    if (!received) {
+      Drop(*peer);
+    } else if ((completion.flags & IORING_CQE_F_MORE) == 0) {
+      ArmReceive(*peer);
+    }
+  }
+
+  auto ArmReceive(const Peer& peer) -> void {
+    auto& sqe = ring_.Prepare(IORING_OP_RECV, peer.connection->Fd(),
+                              UserData(peer.id, kReceive));
+    sqe.flags = IOSQE_BUFFER_SELECT;
+    sqe.buf_group = ring_.BufferGroup();
+    if (multishot_) {
+      sqe.ioprio = IORING_RECV_MULTISHOT;
+    }
+  }
+
+  auto ArmWake() -> void {
+    auto& sqe = ring_.Prepare(IORING_OP_READ, wake_fd_, kWake);
+    sqe.addr = reinterpret_cast<std::uint64_t>(&wake_value_);
+    sqe.len = sizeof(wake_value_);
+  }
+
+  // One POLLOUT for each connection that filled its socket since the last
+  // pass; its completion flushes the connection.
+  auto ArmBlocked() -> void {
+    {
+      std::lock_guard<std::mutex> lock(blocked_mutex_);
+      armed_.swap(blocked_);
+    }
+    for (auto id : armed_) {
+      if (auto* peer = Find(id); peer != nullptr) {
+        auto& sqe = ring_.Prepare(IORING_OP_POLL_ADD, peer->connection->Fd(),
+                                  UserData(id, kWritable));
+        sqe.poll32_events = POLLOUT;
+      }
+    }
+    armed_.clear();
+  }
+
+  static auto UserData(std::uint64_t id, Operation operation)
+      -> std::uint64_t {
+    return (id << kOperationBits) | operation;
+  }
+
+  IoUring ring_;
+  int wake_fd_;
+  std::uint64_t wake_value_{0};
+  bool multishot_{true};
+
+  std::mutex blocked_mutex_;
+  std::vector<std::uint64_t> blocked_;
+  std::vector<std::uint64_t> armed_;
+};
+
+}  // namespace common
@@ -1,8 +1,40 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "common/batched_connection.h"
+#include "common/compiled_dictionary.h"
+#include "common/decimal.h"
+#include "common/direct_sender.h"
+#include "common/fix_encoder.h"
+#include "common/fix_framing.h"
+#include "common/flight_recorder.h"
+#include "common/latency_trace.h"
+#include "common/message_view.h"
+#include "common/pool_allocator.h"
+#include "common/pooled_frame.h"
+#include "common/pre_trade_risk.h"
+#include "common/session_throttle.h"
+#include "common/sharded_workers.h"
+#include "common/thread_util.h"
 #include "common/time_util.h"
+#include "common/transport_config.h"
 #include "quickfix/Application.h"
 #include "quickfix/Message.h"
+#include "quickfix/Session.h"
+#include "quickfix/fix42/BusinessMessageReject.h"
 #include "quickfix/fix42/ExecutionReport.h"
 #include "quickfix/fix42/MessageCracker.h"
 #include "quickfix/fix42/NewOrderSingle.h"
@@ -13,42 +45,319 @@
 
 namespace fixserver {
 
+// An order routed to the book worker that owns its symbol, as the bytes it
+// arrived in.
+struct InboundOrder {
+  FIX::MsgType msg_type;
+  common::PooledFrame frame;
+  FIX::SessionID session_id;
+};
+
+// The NewOrderSingle fields the book worker needs. String members point into
+// the InboundOrder's frame.
+struct NewOrder {
+  std::string_view cl_ord_id;
+  std::string_view symbol;
+  char side{0};
+  char ord_type{0};
+  common::Decimal order_qty;
+  std::optional<common::Decimal> price;
+  std::string_view account;
+};
+
+using NewOrderView = common::MessageView<
+    NewOrder, common::ViewField<FIX::FIELD::ClOrdID, &NewOrder::cl_ord_id>,
+    common::ViewField<FIX::FIELD::Symbol, &NewOrder::symbol>,
+    common::ViewField<FIX::FIELD::Side, &NewOrder::side>,
+    common::ViewField<FIX::FIELD::OrdType, &NewOrder::ord_type>,
+    common::ViewField<FIX::FIELD::OrderQty, &NewOrder::order_qty>,
+    common::ViewField<FIX::FIELD::Price, &NewOrder::price, false>,
+    common::ViewField<FIX::FIELD::Account, &NewOrder::account, false>>;
+
+// The OrderCancelRequest fields the book worker needs.
+struct CancelRequest {
+  std::string_view orig_cl_ord_id;
+  std::string_view cl_ord_id;
+  std::string_view order_id;
+  std::string_view symbol;
+  char side{0};
+};
+
+using CancelRequestView = common::MessageView<
+    CancelRequest,
+    common::ViewField<FIX::FIELD::OrigClOrdID, &CancelRequest::orig_cl_ord_id>,
+    common::ViewField<FIX::FIELD::ClOrdID, &CancelRequest::cl_ord_id>,
+    common::ViewField<FIX::FIELD::OrderID, &CancelRequest::order_id, false>,
+    common::ViewField<FIX::FIELD::Symbol, &CancelRequest::symbol>,
+    common::ViewField<FIX::FIELD::Side, &CancelRequest::side>>;
+
+// Why the book worker turned an order down. Malformed messages get a
+// BusinessMessageReject; well-formed orders it will not accept get a
+// rejected ExecutionReport.
+enum class RejectReason : std::uint8_t {
+  kMissingField,
+  kBadFieldFormat,
+  kUnsupportedOrdType,
+  kUnknownSymbol,
+  kMaxOrderQty,
+  kMaxNotional,
+  kPriceBand,
+  kAccountLimit,
+  kOrderRate,
+  kMaxOpenOrders,
+  kCount,
+};
+
+inline auto RejectReasonName(RejectReason reason) -> const char* {
+  switch (reason) {
+    case RejectReason::kMissingField:
+      return "missing field";
+    case RejectReason::kBadFieldFormat:
+      return "bad field format";
+    case RejectReason::kUnsupportedOrdType:
+      return "unsupported OrdType";
+    case RejectReason::kUnknownSymbol:
+      return "unknown symbol";
+    case RejectReason::kMaxOrderQty:
+      return "order qty over limit";
+    case RejectReason::kMaxNotional:
+      return "notional over limit";
+    case RejectReason::kPriceBand:
+      return "price outside band";
+    case RejectReason::kAccountLimit:
+      return "account not tracked";
+    case RejectReason::kOrderRate:
+      return "order rate over limit";
+    case RejectReason::kMaxOpenOrders:
+      return "open orders over limit";
+    case RejectReason::kCount:
+      break;
+  }
+  return "unknown";
+}
+
+// An ExecutionReport for the sender to encode. String members point into
+// the OutboundMessage's frame.
+struct ExecutionReportFields {
+  std::uint64_t order_id{0};
+  std::uint64_t exec_id{0};
+  char exec_type{0};
+  char ord_status{0};
+  std::string_view cl_ord_id;
+  std::string_view symbol;
+  char side{0};
+  common::Decimal order_qty;
+  common::Decimal cum_qty;
+  common::Decimal avg_px;
+  std::optional<common::Decimal> last_px;  // a fill, of cum_qty
+  std::optional<int> ord_rej_reason;
+  std::string_view text;
+};
+
+// An OrderCancelReject for the sender to encode, likewise.
+struct OrderCancelRejectFields {
+  std::string_view order_id;
+  std::string_view cl_ord_id;
+  std::string_view orig_cl_ord_id;
+  char ord_status{0};
+  char cxl_rej_response_to{0};
+};
+
+// A response produced by a book worker, sent from the sender thread.
+// ExecutionReports and OrderCancelRejects are encoded straight into the
+// session's send buffer (see common::DirectSender); anything else is a
+// FIX::Message.
+struct OutboundMessage {
+  std::variant<FIX::Message, ExecutionReportFields, OrderCancelRejectFields>
+      message;
+  FIX::SessionID session_id;
+  common::PooledFrame frame;  // the order the fields were read from
+};
+
 template <typename EventQueuePtr>
 class Application : public FIX::Application, public FIX42::MessageCracker {
  private:
   using TimeUtil = common::TimeUtil;
+  using BookWorkers = common::ShardedWorkers<InboundOrder, OutboundMessage,
+                                             common::PoolAllocator>;
+  using Outbox = typename BookWorkers::Outbox;
+
+  static constexpr std::size_t kDefaultBookShards = 1;
+  static constexpr std::size_t kDefaultRingSize = 4096;
+
   const FIX::MsgType kNewOrderSingle{"D"};
   const FIX::MsgType kOrderCancelRequest{"F"};
 
  public:
-  Application(EventQueuePtr queue) : queue_(std::move(queue)) {
+  using Throttles = common::SessionThrottles<InboundOrder>;
+
+  Application(EventQueuePtr queue,
+              std::size_t book_shards = kDefaultBookShards,
+              std::size_t ring_size = kDefaultRingSize)
+      : queue_(std::move(queue)),
+        books_(
+            book_shards, ring_size,
+            [this](InboundOrder& order, Outbox& outbox) {
+              HandleOrder(order, outbox);
+            },
+            [this](OutboundMessage& outbound) { Send(outbound); },
+            []() { common::OutboundBatch::Flush(); }) {
     queue_->appendListener(
         kNewOrderSingle,
-        [&](const FIX::Message& message, const FIX::SessionID& sessionID) {
+        [&](common::PooledFrame& frame, const FIX::SessionID& sessionID) {
+          Stamp(common::TraceStage::kDequeued, frame);
           spdlog::info("onNewOrderSingle: {}=>{}", sessionID.toString(),
-                       message.toString());
+                       frame.View());
 
-          HandleNewOrderSingle(static_cast<FIX42::NewOrderSingle>(message),
-                               sessionID);
+          RouteOrder(kNewOrderSingle, frame, sessionID);
         });
 
     queue_->appendListener(
         kOrderCancelRequest,
-        [&](const FIX::Message& message, const FIX::SessionID& sessionID) {
+        [&](common::PooledFrame& frame, const FIX::SessionID& sessionID) {
+          Stamp(common::TraceStage::kDequeued, frame);
           spdlog::info("onOrderCancelRequest: {}=>{}", sessionID.toString(),
-                       message.toString());
+                       frame.View());
 
-          HandleOrderCancelRequest(
-              static_cast<FIX42::OrderCancelRequest>(message), sessionID);
+          RouteOrder(kOrderCancelRequest, frame, sessionID);
         });
   }
 
-  auto GenerateId() -> std::string {
-    return std::to_string(TimeUtil::EpochNanos());
+  auto Start(const common::ThreadConfig& threads) -> void {
+    io_placement_ = threads.io;
+    risk_.Configure(risk_limits_, symbols_);
+    books_.Start(
+        [&threads](std::size_t shard) {
+          common::ThreadUtil::Place(threads.Book(shard),
+                                    "book-" + std::to_string(shard));
+        },
+        [sender = threads.sender, batch = send_batch_]() {
+          common::ThreadUtil::Place(sender, "sender");
+          common::OutboundBatch::Enable(batch.batch_messages,
+                                        batch.batch_delay_nanos);
+        },
+        threads.busy_poll);
+  }
+
+  auto Stop() -> void {
+    books_.Stop();
+    throttles_.LogStats();
+    common::LatencyStats::LogStats();
+    for (std::size_t reason = 0; reason < reject_counts_.size(); ++reason) {
+      spdlog::info("rejects, {}: {}",
+                   RejectReasonName(static_cast<RejectReason>(reason)),
+                   reject_counts_[reason].load(std::memory_order_relaxed));
+    }
+  }
+
+  // Orders for any other symbol are rejected; an empty list accepts every
+  // non-empty symbol. Must be called before the sessions start.
+  auto SetSymbols(std::vector<std::string> symbols) -> void {
+    std::sort(symbols.begin(), symbols.end());
+    symbols_ = std::move(symbols);
+  }
+
+  auto RejectCount(RejectReason reason) const -> std::size_t {
+    return reject_counts_[static_cast<std::size_t>(reason)].load(
+        std::memory_order_relaxed);
+  }
+
+  // Must be called before Start().
+  auto SetRiskLimits(const common::RiskLimits& limits) -> void {
+    risk_limits_ = limits;
+  }
+
+  // Must be called before the sessions start.
+  auto SetScales(common::SymbolScales scales) -> void {
+    scales_ = std::move(scales);
+  }
+
+  // Responses from one pass of the sender over the book workers' rings are
+  // written together, see common::OutboundBatch. Must be called before
+  // Start().
+  auto SetSendBatch(const common::TransportConfig& config) -> void {
+    send_batch_ = config;
+  }
+
+  // Must be called before the sessions start.
+  auto SetThrottles(Throttles throttles) -> void {
+    throttles_ = std::move(throttles);
+  }
+
+  // Runs on the queue processing thread: enqueues held-back orders that are
+  // due. Returns when the next one is due, in epoch nanos, 0 for none.
+  auto ReleaseThrottled() -> std::uint64_t {
+    return throttles_.Release(TimeUtil::EpochNanos(), [&](InboundOrder& order) {
+      Stamp(common::TraceStage::kEnqueued, order.frame);
+      queue_->enqueue(order.msg_type, std::move(order.frame), order.session_id);
+    });
+  }
+
+  // Must be called before the sessions start.
+  auto SetValidators(common::SessionValidators validators) -> void {
+    validators_ = std::move(validators);
+  }
+
+  // Messages addressed to this session run through every stage but are
+  // serialized and dropped by the sender instead of going out.
+  static auto WarmupSessionID() -> const FIX::SessionID& {
+    static const FIX::SessionID session_id("FIX.4.2", "WARMUP", "WARMUP");
+    return session_id;
+  }
+
+  // Cracks count synthetic NewOrderSingle / OrderCancelRequest pairs onto the
+  // queue, validating each first against dictionary when one is given and
+  // against live_session_id's compiled dictionary when it has one. Each pair
+  // yields two responses, see WarmupDropped().
+  auto Warmup(std::size_t count, const FIX::SessionID& live_session_id,
+              const FIX::DataDictionary* dictionary) -> void {
+    const auto& session_id = WarmupSessionID();
+    const auto* validator = validators_.Find(live_session_id);
+    for (std::size_t i = 0; i < count; ++i) {
+      FIX::ClOrdID clOrdID("WARMUP" + std::to_string(i));
+      FIX::Symbol symbol(
+          symbols_.empty()
+              ? "WARMUP" + std::to_string(i % books_.ShardCount())
+              : symbols_[i % symbols_.size()]);
+      FIX::Side side(FIX::Side_BUY);
+
+      FIX42::NewOrderSingle newOrderSingle(
+          clOrdID, FIX::HandlInst('1'), symbol, side, FIX::TransactTime(),
+          FIX::OrdType(FIX::OrdType_LIMIT));
+      newOrderSingle.set(FIX::OrderQty(1));
+      newOrderSingle.set(FIX::Price(1));
+
+      FIX42::OrderCancelRequest orderCancelRequest(
+          FIX::OrigClOrdID(clOrdID.getValue()), clOrdID, symbol, side,
+          FIX::TransactTime());
+      orderCancelRequest.set(FIX::OrderID(clOrdID.getValue()));
+
+      if (dictionary != nullptr) {
+        Validate(*dictionary, newOrderSingle);
+        Validate(*dictionary, orderCancelRequest);
+      }
+      if (validator != nullptr) {
+        // Synthetic messages lack a full header; only the lookups matter.
+        const auto& compiled = *validator->dictionary;
+        compiled.Validate(newOrderSingle, validator->options);
+        compiled.Validate(orderCancelRequest, validator->options);
+      }
+
+      crack(newOrderSingle, session_id);
+      crack(orderCancelRequest, session_id);
+    }
+  }
+
+  auto WarmupDropped() const -> std::size_t {
+    return warmup_dropped_.load(std::memory_order_acquire);
   }
 
   auto onCreate(const FIX::SessionID& session_id) -> void override {
     spdlog::info("session created: {}", session_id.toString());
+    auto hash = common::FlightRecorder::Hash(session_id.toStringFrozen());
+    session_hashes_.emplace(session_id, hash);
+    common::FlightRecorder::Instance().NameSession(hash,
+                                                   session_id.toString());
   }
 
   auto onLogon(const FIX::SessionID& session_id) -> void override {
@@ -63,10 +372,12 @@ class Application : public FIX::Application, public FIX42::MessageCracker {
     spdlog::info("toAdmin: {}", message.toString());
   }
 
-  auto fromAdmin(const FIX::Message& message, const FIX::SessionID&)
+  auto fromAdmin(const FIX::Message& message, const FIX::SessionID& sessionID)
       EXCEPT(FIX::FieldNotFound, FIX::IncorrectDataFormat,
              FIX::IncorrectTagValue, FIX::RejectLogon) -> void override {
+    common::ThreadUtil::PlaceOnce(io_placement_, "io");
     spdlog::info("fromAdmin: {}", message.toString());
+    validators_.Check(message, sessionID);
   }
 
   auto toApp(FIX::Message& message, const FIX::SessionID&)
@@ -78,87 +389,498 @@ class Application : public FIX::Application, public FIX42::MessageCracker {
       EXCEPT(FIX::FieldNotFound, FIX::IncorrectDataFormat,
              FIX::IncorrectTagValue, FIX::UnsupportedMessageType)
           -> void override {
+    common::ThreadUtil::PlaceOnce(io_placement_, "io");
+    validators_.Check(message, sessionID);
     crack(message, sessionID);
   }
 
   auto onMessage(const FIX42::NewOrderSingle& message,
                  const FIX::SessionID& sessionID) -> void override {
-    FIX::MsgType msg_type;
-    message.getHeader().get(msg_type);
-    queue_->enqueue(msg_type, message, sessionID);
+    Enqueue(message, sessionID);
   }
 
   auto onMessage(const FIX42::OrderCancelRequest& message,
                  const FIX::SessionID& sessionID) -> void override {
+    Enqueue(message, sessionID);
+  }
+
+  // Runs on the session's I/O thread, so a flooding session is stopped
+  // before its messages take a place on the shared queue.
+  auto Enqueue(const FIX::Message& message, const FIX::SessionID& sessionID)
+      -> void {
     FIX::MsgType msg_type;
     message.getHeader().get(msg_type);
-    queue_->enqueue(msg_type, message, sessionID);
+
+    auto decision = throttles_.Admit(
+        sessionID, msg_type.getValue(), TimeUtil::EpochNanos(), [&]() {
+          return InboundOrder{msg_type, Frame(message, sessionID), sessionID};
+        });
+    switch (decision) {
+      case common::ThrottleDecision::kAdmit: {
+        auto frame = Frame(message, sessionID);
+        Stamp(common::TraceStage::kEnqueued, frame);
+        queue_->enqueue(msg_type, std::move(frame), sessionID);
+        break;
+      }
+      case common::ThrottleDecision::kDeferred:
+        break;
+      case common::ThrottleDecision::kReject:
+        RejectThrottled(message, msg_type, sessionID);
+        break;
+      case common::ThrottleDecision::kDisconnect:
+        if (auto* session = FIX::Session::lookupSession(sessionID);
+            session != nullptr) {
+          spdlog::warn("{}: throttle limit exceeded, logging out",
+                       sessionID.toString());
+          session->logout("throttle limit exceeded");
+        }
+        break;
+    }
   }
 
-  auto HandleNewOrderSingle(const FIX42::NewOrderSingle& message,
-                            const FIX::SessionID& sessionID) -> void {
-    FIX::Symbol symbol;
-    FIX::Side side;
-    FIX::OrdType ordType;
-    FIX::OrderQty orderQty;
-    FIX::Price price;
-    FIX::ClOrdID clOrdID;
-    FIX::Account account;
+  // The message as received when an event loop is dispatching it, else
+  // serialized again (QuickFIX's own transports, warm-up).
+  auto Frame(const FIX::Message& message, const FIX::SessionID& sessionID)
+      -> common::PooledFrame {
+    auto received = common::ReceivedFrame::Of(message);
+    auto frame = received.empty() ? common::PooledFrame(message.toString())
+                                  : common::PooledFrame(received);
+    if (common::FlightRecorder::Enabled()) {
+      frame.SetSessionHash(SessionHash(sessionID));
+    }
+    if (!received.empty()) {
+      Stamp(common::TraceStage::kReceived, frame,
+            common::ReceivedFrame::Cycles());
+    }
+    return frame;
+  }
 
-    message.get(ordType);
+  // Runs on the queue processing thread: every order for a symbol goes to the
+  // same book worker, so per-symbol ordering is preserved.
+  auto RouteOrder(const FIX::MsgType& msg_type, common::PooledFrame& frame,
+                  const FIX::SessionID& sessionID) -> void {
+    auto symbol = frame.Field(FIX::FIELD::Symbol).value_or(std::string_view());
+    auto shard = books_.ShardFor(std::hash<std::string_view>{}(symbol));
+    books_.Route(shard, InboundOrder{msg_type, std::move(frame), sessionID});
+  }
 
-    if (ordType != FIX::OrdType_LIMIT) {
-      throw FIX::IncorrectTagValue(ordType.getField());
+  // Runs on the book worker that owns the order's symbol. The frame goes back
+  // to its pool as soon as the order is handled, or once the response that
+  // quotes it is sent.
+  auto HandleOrder(InboundOrder& order, Outbox& outbox) -> void {
+    Stamp(common::TraceStage::kHandling, order.frame);
+    if (order.msg_type == kNewOrderSingle) {
+      HandleNewOrderSingle(order.frame, order.session_id, outbox);
+    } else if (order.msg_type == kOrderCancelRequest) {
+      HandleOrderCancelRequest(order.frame, order.session_id, outbox);
     }
+    order.frame.Release();
+  }
 
-    message.get(symbol);
-    message.get(side);
-    message.get(orderQty);
-    message.get(price);
-    message.get(clOrdID);
+  // Neither handler throws: a bad order is answered with a reject and
+  // counted, and the worker moves on.
+  auto HandleNewOrderSingle(common::PooledFrame& frame,
+                            const FIX::SessionID& sessionID, Outbox& outbox)
+      -> void {
+    auto message = frame.View();
+    NewOrder order{};
+    if (auto result = NewOrderView::Parse(message, order); !result) {
+      RejectMessage(message, kNewOrderSingle, result, sessionID, outbox);
+      return;
+    }
 
-    auto orderID = GenerateId();
-    auto execID = GenerateId();
+    if (order.ord_type != FIX::OrdType_LIMIT) {
+      RejectOrder(order, frame, RejectReason::kUnsupportedOrdType,
+                  FIX::OrdRejReason_BROKER_OPTION, sessionID, outbox);
+      return;
+    }
+    if (!order.price) {
+      RejectMessage(message, kNewOrderSingle,
+                    {common::ValidationError::kRequiredTagMissing,
+                     FIX::FIELD::Price},
+                    sessionID, outbox);
+      return;
+    }
+    if (!IsKnownSymbol(order.symbol)) {
+      RejectOrder(order, frame, RejectReason::kUnknownSymbol,
+                  FIX::OrdRejReason_UNKNOWN_SYMBOL, sessionID, outbox);
+      return;
+    }
+
+    // From here on the price is in the symbol's units, the qty in lots.
+    auto price = order.price->Rescale(scales_.PriceScale(order.symbol));
+    auto qty = order.order_qty.Rescale(scales_.QtyScale());
+    if (!price || !qty) {
+      RejectMessage(message, kNewOrderSingle,
+                    {common::ValidationError::kIncorrectDataFormat,
+                     price ? FIX::FIELD::OrderQty : FIX::FIELD::Price},
+                    sessionID, outbox);
+      return;
+    }
+    order.price = price;
+    order.order_qty = *qty;
 
-    FIX42::ExecutionReport executionReport(
-        FIX::OrderID(orderID), FIX::ExecID(execID),
-        FIX::ExecTransType(FIX::ExecTransType_NEW),
-        FIX::ExecType(FIX::ExecType_FILL),
-        FIX::OrdStatus(FIX::OrdStatus_FILLED), symbol, side, FIX::LeavesQty(0),
-        FIX::CumQty(orderQty), FIX::AvgPx(price));
+    // Warm-up orders run the checks without leaving state behind.
+    auto commit = sessionID != WarmupSessionID();
+    auto risk = risk_.Check(order.account, order.symbol, order.order_qty,
+                            *order.price, commit);
+    if (!risk) {
+      RejectOrder(order, frame, RiskRejectReason(risk.reject),
+                  FIX::OrdRejReason_ORDER_EXCEEDS_LIMIT, sessionID, outbox);
+      return;
+    }
 
-    executionReport.set(clOrdID);
-    executionReport.set(orderQty);
-    executionReport.set(FIX::LastShares(orderQty));
-    executionReport.set(FIX::LastPx(price));
+    ExecutionReportFields report;
+    report.order_id = TimeUtil::EpochNanos();
+    report.exec_id = TimeUtil::EpochNanos();
+    report.exec_type = FIX::ExecType_FILL;
+    report.ord_status = FIX::OrdStatus_FILLED;
+    report.cl_ord_id = order.cl_ord_id;
+    report.symbol = order.symbol;
+    report.side = order.side;
+    report.order_qty = order.order_qty;
+    report.cum_qty = order.order_qty;
+    report.avg_px = *order.price;
+    report.last_px = *order.price;
 
-    FIX::Session::sendToTarget(executionReport, sessionID);
+    if (commit) {
+      risk_.OnFilled(risk, *order.price);
+    }
+    Post(outbox, OutboundMessage{report, sessionID, std::move(frame)});
+  }
+
+  auto HandleOrderCancelRequest(common::PooledFrame& frame,
+                                const FIX::SessionID& sessionID,
+                                Outbox& outbox) -> void {
+    auto message = frame.View();
+    CancelRequest request{};
+    if (auto result = CancelRequestView::Parse(message, request); !result) {
+      RejectMessage(message, kOrderCancelRequest, result, sessionID, outbox);
+      return;
+    }
+
+    OrderCancelRejectFields reject;
+    reject.order_id = request.order_id.empty() ? "NONE" : request.order_id;
+    reject.cl_ord_id = request.cl_ord_id;
+    reject.orig_cl_ord_id = request.orig_cl_ord_id;
+    reject.ord_status = FIX::OrdStatus_DONE_FOR_DAY;
+    reject.cxl_rej_response_to = FIX::CxlRejResponseTo_ORDER_CANCEL_REQUEST;
+
+    Post(outbox, OutboundMessage{reject, sessionID, std::move(frame)});
+  }
+
+ private:
+  static auto Validate(const FIX::DataDictionary& dictionary,
+                       const FIX::Message& message) -> void {
+    try {
+      dictionary.validate(message);
+    } catch (const FIX::Exception&) {
+      // Synthetic messages lack a full header; only the lookups matter here.
+    }
+  }
+
+  auto IsKnownSymbol(std::string_view symbol) const -> bool {
+    if (symbols_.empty()) {
+      return !symbol.empty();
+    }
+    return std::binary_search(symbols_.begin(), symbols_.end(), symbol);
+  }
+
+  static auto RiskRejectReason(common::RiskReject reject) -> RejectReason {
+    switch (reject) {
+      case common::RiskReject::kOrderQty:
+        return RejectReason::kMaxOrderQty;
+      case common::RiskReject::kNotional:
+        return RejectReason::kMaxNotional;
+      case common::RiskReject::kPriceBand:
+        return RejectReason::kPriceBand;
+      case common::RiskReject::kOrderRate:
+        return RejectReason::kOrderRate;
+      case common::RiskReject::kOpenOrders:
+        return RejectReason::kMaxOpenOrders;
+      case common::RiskReject::kAccountTable:
+      case common::RiskReject::kNone:
+        break;
+    }
+    return RejectReason::kAccountLimit;
+  }
+
+  static auto Post(Outbox& outbox, OutboundMessage&& outbound) -> void {
+    Stamp(common::TraceStage::kHandled, outbound.frame);
+    outbox.Post(std::move(outbound));
   }
 
-  auto HandleOrderCancelRequest(const FIX42::OrderCancelRequest& message,
-                                const FIX::SessionID& sessionID) -> void {
-    FIX::OrigClOrdID origClOrdID;
+  // The hash onCreate() took, every session being created before the first
+  // message arrives; the warm-up session has none and is hashed here.
+  auto SessionHash(const FIX::SessionID& sessionID) const -> std::uint32_t {
+    auto found = session_hashes_.find(sessionID);
+    if (found != session_hashes_.end()) {
+      return found->second;
+    }
+    return common::FlightRecorder::Hash(sessionID.toStringFrozen());
+  }
+
+  static auto FlightRecordFor(common::FlightEvent event,
+                              common::TraceStage stage,
+                              common::PooledFrame& frame,
+                              std::uint64_t cycles, std::uint32_t value = 0)
+      -> common::FlightRecord {
+    return {cycles,
+            frame.OrderHash(),
+            frame.SessionHash(),
+            event,
+            stage,
+            0,
+            value};
+  }
+
+  // Stamps the frame's LatencyTrace and, when it is on, records the stage
+  // in the FlightRecorder. Returns the stamp, 0 with both off.
+  static auto Stamp(common::TraceStage stage, common::PooledFrame& frame,
+                    std::uint64_t cycles = 0) -> std::uint64_t {
+    auto flight = common::FlightRecorder::Enabled();
+    if (!common::LatencyTrace::kEnabled && !flight) {
+      return 0;
+    }
+    if (cycles == 0) {
+      cycles = TimeUtil::Cycles();
+    }
+    frame.Trace().Stamp(stage, cycles);
+    if (flight) {
+      if (frame.FirstSeen() == 0) {
+        frame.SetFirstSeen(cycles);
+      }
+      common::FlightRecorder::Record(FlightRecordFor(
+          common::FlightEvent::kStage, stage, frame, cycles));
+    }
+    return cycles;
+  }
+
+  auto CountReject(RejectReason reason) -> void {
+    reject_counts_[static_cast<std::size_t>(reason)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  // A well-formed order the book will not take: rejected ExecutionReport.
+  auto RejectOrder(const NewOrder& order, common::PooledFrame& frame,
+                   RejectReason reason, int ord_rej_reason,
+                   const FIX::SessionID& sessionID, Outbox& outbox) -> void {
+    CountReject(reason);
+    if (common::FlightRecorder::Enabled()) {
+      common::FlightRecorder::Record(FlightRecordFor(
+          common::FlightEvent::kReject, common::TraceStage::kHandling, frame,
+          TimeUtil::Cycles(), static_cast<std::uint32_t>(reason)));
+    }
+
+    ExecutionReportFields report;
+    report.order_id = TimeUtil::EpochNanos();
+    report.exec_id = TimeUtil::EpochNanos();
+    report.exec_type = FIX::ExecType_REJECTED;
+    report.ord_status = FIX::OrdStatus_REJECTED;
+    report.cl_ord_id = order.cl_ord_id;
+    report.symbol = order.symbol;
+    report.side = order.side;
+    report.order_qty = order.order_qty;
+    report.ord_rej_reason = ord_rej_reason;
+    report.text = RejectReasonName(reason);
+
+    Post(outbox, OutboundMessage{report, sessionID, std::move(frame)});
+  }
+
+  // The body of an ExecutionReport, written to a common::FixEncoder or set
+  // on a FIX::Message through common::MessageFields.
+  template <typename Fields>
+  static auto Encode(const ExecutionReportFields& report, Fields& fields)
+      -> void {
+    fields.Field(FIX::FIELD::OrderID, report.order_id);
+    fields.Field(FIX::FIELD::ExecID, report.exec_id);
+    fields.Field(FIX::FIELD::ExecTransType, FIX::ExecTransType_NEW);
+    fields.Field(FIX::FIELD::ExecType, report.exec_type);
+    fields.Field(FIX::FIELD::OrdStatus, report.ord_status);
+    fields.Field(FIX::FIELD::Symbol, report.symbol);
+    fields.Field(FIX::FIELD::Side, report.side);
+    fields.Field(FIX::FIELD::LeavesQty, 0);
+    fields.Field(FIX::FIELD::CumQty, report.cum_qty);
+    fields.Field(FIX::FIELD::AvgPx, report.avg_px);
+    fields.Field(FIX::FIELD::ClOrdID, report.cl_ord_id);
+    fields.Field(FIX::FIELD::OrderQty, report.order_qty);
+    if (report.last_px) {
+      fields.Field(FIX::FIELD::LastShares, report.cum_qty);
+      fields.Field(FIX::FIELD::LastPx, *report.last_px);
+    }
+    if (report.ord_rej_reason) {
+      fields.Field(FIX::FIELD::OrdRejReason, *report.ord_rej_reason);
+      fields.Field(FIX::FIELD::Text, report.text);
+    }
+  }
+
+  template <typename Fields>
+  static auto Encode(const OrderCancelRejectFields& reject, Fields& fields)
+      -> void {
+    fields.Field(FIX::FIELD::OrderID, reject.order_id);
+    fields.Field(FIX::FIELD::ClOrdID, reject.cl_ord_id);
+    fields.Field(FIX::FIELD::OrigClOrdID, reject.orig_cl_ord_id);
+    fields.Field(FIX::FIELD::OrdStatus, reject.ord_status);
+    fields.Field(FIX::FIELD::CxlRejResponseTo, reject.cxl_rej_response_to);
+  }
+
+  static auto MsgTypeOf(const ExecutionReportFields&) -> std::string_view {
+    return FIX::MsgType_ExecutionReport;
+  }
+
+  static auto MsgTypeOf(const OrderCancelRejectFields&) -> std::string_view {
+    return FIX::MsgType_OrderCancelReject;
+  }
+
+  // A message the book cannot read: BusinessMessageReject naming the tag.
+  auto RejectMessage(std::string_view message, const FIX::MsgType& msg_type,
+                     const common::ValidationResult& result,
+                     const FIX::SessionID& sessionID, Outbox& outbox) -> void {
+    auto missing =
+        result.error == common::ValidationError::kRequiredTagMissing;
+    auto reason =
+        missing ? RejectReason::kMissingField : RejectReason::kBadFieldFormat;
+    CountReject(reason);
+
+    FIX42::BusinessMessageReject businessMessageReject(
+        FIX::RefMsgType(msg_type.getValue()),
+        FIX::BusinessRejectReason(
+            missing
+                ? FIX::BusinessRejectReason_CONDITIONALLY_REQUIRED_FIELD_MISSING
+                : FIX::BusinessRejectReason_OTHER));
+
+    using common::FixFields;
+    if (auto seq_num = FixFields::Find(message, FIX::FIELD::MsgSeqNum)) {
+      int ref_seq_num{0};
+      const auto* end = seq_num->data() + seq_num->size();
+      if (std::from_chars(seq_num->data(), end, ref_seq_num).ptr == end) {
+        businessMessageReject.set(FIX::RefSeqNum(ref_seq_num));
+      }
+    }
+    if (auto cl_ord_id = FixFields::Find(message, FIX::FIELD::ClOrdID)) {
+      businessMessageReject.set(
+          FIX::BusinessRejectRefID(std::string(*cl_ord_id)));
+    }
+    businessMessageReject.set(FIX::Text(std::string(RejectReasonName(reason)) +
+                                        ": tag " + std::to_string(result.tag)));
+
+    Post(outbox, OutboundMessage{businessMessageReject, sessionID, {}});
+  }
+
+  // Sent straight from the I/O thread: the book workers never see the
+  // message, and a flooding session should not load the sender either.
+  static auto RejectThrottled(const FIX::Message& message,
+                              const FIX::MsgType& msg_type,
+                              const FIX::SessionID& sessionID) -> void {
+    FIX42::BusinessMessageReject businessMessageReject(
+        FIX::RefMsgType(msg_type.getValue()),
+        FIX::BusinessRejectReason(FIX::BusinessRejectReason_OTHER));
+
+    FIX::MsgSeqNum msgSeqNum;
+    if (message.getHeader().getFieldIfSet(msgSeqNum)) {
+      businessMessageReject.set(FIX::RefSeqNum(msgSeqNum.getValue()));
+    }
     FIX::ClOrdID clOrdID;
-    FIX::OrderID orderID;
-    FIX::Symbol symbol;
-    FIX::Side side;
+    if (message.getFieldIfSet(clOrdID)) {
+      businessMessageReject.set(FIX::BusinessRejectRefID(clOrdID.getValue()));
+    }
+    businessMessageReject.set(FIX::Text("throttle limit exceeded"));
 
-    message.get(origClOrdID);
-    message.get(clOrdID);
-    message.get(orderID);
-    message.get(symbol);
-    message.get(side);
+    try {
+      FIX::Session::sendToTarget(businessMessageReject, sessionID);
+    } catch (const FIX::SessionNotFound&) {
+      spdlog::warn("send failed, session not found: {}", sessionID.toString());
+    }
+  }
 
-    FIX42::OrderCancelReject orderCancelReject(
-        orderID, clOrdID, origClOrdID,
-        FIX::OrdStatus(FIX::OrdStatus_DONE_FOR_DAY),
-        FIX::CxlRejResponseTo('1'));
+  // Runs on the sender thread.
+  auto Send(OutboundMessage& outbound) -> void {
+    if (outbound.session_id == WarmupSessionID()) {
+      std::visit([this](const auto& message) { Serialize(message); },
+                 outbound.message);
+      warmup_dropped_.fetch_add(1, std::memory_order_release);
+      return;
+    }
+    auto& frame = outbound.frame;
+    const auto& sessionID = outbound.session_id;
+    Stamp(common::TraceStage::kSending, frame);
+    std::visit([&](auto& message) { SendTo(message, sessionID, frame); },
+               outbound.message);
+    auto sent = Stamp(common::TraceStage::kSent, frame);
+    common::LatencyStats::Record(frame.Trace());
+    if (common::FlightRecorder::Enabled()) {
+      common::FlightRecorder::Instance().Finished(
+          FlightRecordFor(common::FlightEvent::kStage,
+                          common::TraceStage::kSent, frame, sent),
+          frame.FirstSeen());
+    }
+  }
 
-    FIX::Session::sendToTarget(orderCancelReject, sessionID);
+  static auto SendTo(FIX::Message& message, const FIX::SessionID& sessionID,
+                     common::PooledFrame& /*frame*/) -> void {
+    try {
+      FIX::Session::sendToTarget(message, sessionID);
+    } catch (const FIX::SessionNotFound&) {
+      spdlog::warn("send failed, session not found: {}",
+                   sessionID.toString());
+    }
+  }
+
+  template <typename Fields>
+  static auto SendTo(const Fields& fields, const FIX::SessionID& sessionID,
+                     common::PooledFrame& frame) -> void {
+    auto sent = common::DirectSender::Send(
+        sessionID, MsgTypeOf(fields), [&](common::FixEncoder& encoder) {
+          Encode(fields, encoder);
+          Stamp(common::TraceStage::kSerialized, frame);
+        });
+    if (!sent) {
+      // Not on an event loop: through QuickFIX like any other message.
+      FIX::Message message;
+      message.getHeader().setField(
+          FIX::MsgType(std::string(MsgTypeOf(fields))));
+      common::MessageFields setter(message);
+      Encode(fields, setter);
+      SendTo(message, sessionID, frame);
+    }
+  }
+
+  // Warm-up: the same serialization as a live send.
+  auto Serialize(const FIX::Message& message) -> void { message.toString(); }
+
+  template <typename Fields>
+  auto Serialize(const Fields& fields) -> void {
+    warmup_encoder_.Begin(WarmupSessionID().getBeginString().getValue());
+    warmup_encoder_.Field(FIX::FIELD::MsgType, MsgTypeOf(fields));
+    Encode(fields, warmup_encoder_);
+    warmup_encoder_.Finish();
   }
 
- private:
   EventQueuePtr queue_;
+  BookWorkers books_;
+  common::ThreadPlacement io_placement_;
+  common::TransportConfig send_batch_;
+  common::SessionValidators validators_;
+  // SessionIDs hashed by the string QuickFIX already keeps for them.
+  struct SessionIDHash {
+    auto operator()(const FIX::SessionID& session_id) const -> std::size_t {
+      return std::hash<std::string>()(session_id.toStringFrozen());
+    }
+  };
+
+  // Filled by onCreate(), before the sessions start.
+  std::unordered_map<FIX::SessionID, std::uint32_t, SessionIDHash>
+      session_hashes_;
+  Throttles throttles_;
+  std::vector<std::string> symbols_;
+  common::SymbolScales scales_;
+  common::RiskLimits risk_limits_;
+  common::PreTradeRisk risk_;
+  std::array<std::atomic<std::size_t>,
+             static_cast<std::size_t>(RejectReason::kCount)>
+      reject_counts_{};
+  std::atomic<std::size_t> warmup_dropped_{0};
+  common::FixEncoder warmup_encoder_;  // sender thread only
 };
 
 }  // namespace fixserver
@@ -4,7 +4,10 @@
 
 #include "client_app.h"
 #include "common/application_traits.h"
+#include "common/journal_log.h"
+#include "common/mmap_store.h"
 #include "common/signal_handler.h"
+#include "common/transport.h"
 
 template <typename Traits>
 class FixClient {
@@ -22,16 +25,24 @@ class FixClient {
 
   auto Initialize() -> void {
     FIX::SessionSettings settings(config_);
-    FIX::FileStoreFactory store_factory(settings);
-    FIX::ScreenLogFactory log_factory(settings);
+    threads_ = common::ThreadConfig::FromSettings(settings.get());
+    application_.SetIoThreadPlacement(threads_.io);
+    Traits::ReserveArena(settings.get());
 
-    initiator_ = std::make_unique<FIX::SocketInitiator>(
-        application_, store_factory, settings, log_factory);
+    store_factory_ = std::make_unique<common::MmapStoreFactory>(settings);
+    log_factory_ =
+        std::make_unique<common::JournalLogFactory>(settings, threads_.journal);
+
+    initiator_ = common::MakeInitiator(
+        application_, *store_factory_, settings, *log_factory_,
+        common::TransportConfig::FromSettings(settings.get()), threads_);
   }
 
   auto Start() -> void {
     initiator_->start();
     process_thread_ = std::thread([&]() {
+      common::ThreadUtil::Place(threads_.process, "process");
+
       while (!initiator_->isStopped()) {
         if (queue_->emptyQueue()) {
           queue_->waitFor(Traits::kQueueWait);
@@ -50,13 +61,18 @@ class FixClient {
   auto Stop() -> void {
     initiator_->stop();
     process_thread_.join();
+    common::BlockPool::LogStats();
   }
 
  private:
   std::string config_;
   typename Traits::EventQueuePtr queue_;
   ClientApplication application_;
+  // The initiator keeps references to both factories.
+  std::unique_ptr<FIX::MessageStoreFactory> store_factory_;
+  std::unique_ptr<FIX::LogFactory> log_factory_;
   std::unique_ptr<FIX::Initiator> initiator_;
+  common::ThreadConfig threads_;
   std::thread process_thread_;
 };
 
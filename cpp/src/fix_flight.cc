@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/flight_recorder.h"
+#include "spdlog/spdlog.h"
+
+// Converts a flight recorder dump written by common::FlightRecorder to the
+// Chrome trace event JSON that chrome://tracing and ui.perfetto.dev load:
+// each record is an instant event on its thread's track, and each order
+// (ClOrdID hash) is an async slice from its first record to its last, across
+// threads. Written to OUT, or stdout.
+
+using common::FlightEvent;
+using common::FlightRecord;
+
+static auto Escape(const std::string& text) -> std::string {
+  std::string escaped;
+  for (auto c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    if (static_cast<unsigned char>(c) >= 0x20) {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+static auto EventName(const FlightRecord& record) -> std::string {
+  switch (record.event) {
+    case FlightEvent::kStage:
+      return common::TraceStageName(record.stage);
+    case FlightEvent::kReject:
+      return "reject";
+    case FlightEvent::kSpike:
+      return "spike";
+  }
+  return "unknown";
+}
+
+static auto TriggerName(common::FlightFileHeader::Trigger trigger)
+    -> const char* {
+  switch (trigger) {
+    case common::FlightFileHeader::Trigger::kSignal:
+      return "signal";
+    case common::FlightFileHeader::Trigger::kLatency:
+      return "latency";
+    case common::FlightFileHeader::Trigger::kNone:
+      break;
+  }
+  return "none";
+}
+
+struct OrderSpan {
+  std::uint64_t first{std::numeric_limits<std::uint64_t>::max()};
+  std::uint64_t last{0};
+  std::uint32_t first_thread{0};
+  std::uint32_t last_thread{0};
+};
+
+auto main(int argc, char** argv) -> int {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " FILE [OUT]." << std::endl;
+    return 1;
+  }
+
+  common::FlightReader reader(argv[1]);
+  if (!reader.Valid()) {
+    spdlog::error("{} is not a flight recorder dump", argv[1]);
+    return 1;
+  }
+
+  std::vector<common::FlightReader::Thread> threads;
+  common::FlightReader::Thread thread;
+  while (reader.Next(thread)) {
+    threads.push_back(std::move(thread));
+  }
+
+  // Times are written relative to the earliest record, in micros, which
+  // keeps nanosecond precision in a double.
+  auto origin = std::numeric_limits<std::uint64_t>::max();
+  for (const auto& each : threads) {
+    for (const auto& record : each.records) {
+      origin = std::min(origin, record.time);
+    }
+  }
+  auto micros = [&](std::uint64_t time) {
+    return fmt::format("{:.3f}", static_cast<double>(time - origin) / 1000);
+  };
+
+  const auto& header = reader.Header();
+  const auto& sessions = reader.Sessions();
+  auto session_name = [&](std::uint32_t session) {
+    auto known = sessions.find(session);
+    return known != sessions.end() ? Escape(known->second)
+                                   : fmt::format("{:08x}", session);
+  };
+
+  std::ofstream file;
+  if (argc > 2) {
+    file.open(argv[2]);
+  }
+  std::ostream& out = argc > 2 ? file : std::cout;
+
+  out << fmt::format(
+      "{{\"displayTimeUnit\":\"ns\",\"otherData\":{{\"dumped_nanos\":{},"
+      "\"origin_nanos\":{},\"trigger\":\"{}\"}},\"traceEvents\":[\n",
+      header.dumped_nanos, origin, TriggerName(header.trigger));
+  out << fmt::format(
+      "{{\"ph\":\"M\",\"pid\":{},\"name\":\"process_name\","
+      "\"args\":{{\"name\":\"fix_server {}\"}}}}",
+      header.pid, header.pid);
+
+  std::size_t count{0};
+  // ClOrdIDs are only unique per session.
+  std::map<std::pair<std::uint32_t, std::uint32_t>, OrderSpan> orders;
+  for (const auto& each : threads) {
+    out << fmt::format(
+        ",\n{{\"ph\":\"M\",\"pid\":{},\"tid\":{},\"name\":\"thread_name\","
+        "\"args\":{{\"name\":\"{}\"}}}}",
+        header.pid, each.thread_id, Escape(each.name));
+
+    for (const auto& record : each.records) {
+      ++count;
+      std::string args = fmt::format("\"session\":\"{}\",\"order\":\"{:08x}\"",
+                                     session_name(record.session),
+                                     record.order);
+      if (record.event == FlightEvent::kReject) {
+        args += fmt::format(",\"reason\":{}", record.value);
+      } else if (record.event == FlightEvent::kSpike) {
+        args += fmt::format(",\"micros\":{}", record.value);
+      }
+      out << fmt::format(
+          ",\n{{\"ph\":\"i\",\"s\":\"t\",\"pid\":{},\"tid\":{},\"ts\":{},"
+          "\"name\":\"{}\",\"cat\":\"{}\",\"args\":{{{}}}}}",
+          header.pid, each.thread_id, micros(record.time), EventName(record),
+          record.event == FlightEvent::kStage ? "stage" : "event", args);
+
+      if (record.order != 0) {
+        auto& span = orders[{record.session, record.order}];
+        if (record.time < span.first) {
+          span.first = record.time;
+          span.first_thread = each.thread_id;
+        }
+        if (record.time >= span.last) {
+          span.last = record.time;
+          span.last_thread = each.thread_id;
+        }
+      }
+    }
+  }
+
+  for (const auto& [key, span] : orders) {
+    auto [session, order] = key;
+    out << fmt::format(
+        ",\n{{\"ph\":\"b\",\"cat\":\"order\",\"id\":\"0x{:08x}{:08x}\","
+        "\"name\":\"{} order {:08x}\",\"pid\":{},\"tid\":{},\"ts\":{}}}",
+        session, order, session_name(session), order, header.pid,
+        span.first_thread, micros(span.first));
+    out << fmt::format(
+        ",\n{{\"ph\":\"e\",\"cat\":\"order\",\"id\":\"0x{:08x}{:08x}\","
+        "\"name\":\"{} order {:08x}\",\"pid\":{},\"tid\":{},\"ts\":{}}}",
+        session, order, session_name(session), order, header.pid,
+        span.last_thread, micros(span.last));
+  }
+  out << "\n]}\n";
+
+  spdlog::info("converted {} records from {} threads, {} orders", count,
+               threads.size(), orders.size());
+  return 0;
+}
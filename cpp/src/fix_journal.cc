@@ -0,0 +1,91 @@
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/journal_log.h"
+#include "spdlog/spdlog.h"
+
+// Converts a binary journal written by common::JournalLogFactory back to
+// QuickFIX FileLog text. With only FILE, every incoming and outgoing message
+// is printed to stdout; with OUTDIR, <session>.messages.log and
+// <session>.event.log are written per session, as FileLog would have.
+
+using common::JournalDirection;
+using common::JournalRecord;
+
+// FileLog's "YYYYMMDD-HH:MM:SS.nnnnnnnnn : " prefix, which fix_util expects.
+static auto FormatTimestamp(std::uint64_t epoch_nanos) -> std::string {
+  auto seconds = static_cast<std::time_t>(epoch_nanos / 1000000000);
+  std::tm utc{};
+  gmtime_r(&seconds, &utc);
+
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y%m%d-%H:%M:%S", &utc);
+  return fmt::format("{}.{:09} : ", date, epoch_nanos % 1000000000);
+}
+
+struct SessionFiles {
+  std::ofstream messages;
+  std::ofstream events;
+};
+
+auto main(int argc, char** argv) -> int {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " FILE [OUTDIR]." << std::endl;
+    return 1;
+  }
+
+  common::JournalReader reader(argv[1]);
+  if (!reader.Valid()) {
+    spdlog::error("{} is not a journal file", argv[1]);
+    return 1;
+  }
+
+  std::string out_dir = argc > 2 ? argv[2] : "";
+  std::map<std::uint16_t, std::string> names{{0, "GLOBAL"}};
+  std::map<std::uint16_t, std::unique_ptr<SessionFiles>> files;
+
+  auto get_files = [&](std::uint16_t session) -> SessionFiles& {
+    auto& entry = files[session];
+    if (!entry) {
+      auto prefix = out_dir + "/" + names[session];
+      entry = std::make_unique<SessionFiles>();
+      entry->messages.open(prefix + ".messages.log", std::ios::app);
+      entry->events.open(prefix + ".event.log", std::ios::app);
+    }
+    return *entry;
+  };
+
+  std::size_t count{0};
+  JournalRecord record{};
+  std::string payload;
+  while (reader.Next(record, payload)) {
+    ++count;
+
+    if (record.direction == JournalDirection::kSession) {
+      names[record.session] = payload;
+      continue;
+    }
+
+    auto is_message = record.direction == JournalDirection::kIncoming ||
+                      record.direction == JournalDirection::kOutgoing;
+    if (out_dir.empty()) {
+      if (is_message) {
+        std::cout << FormatTimestamp(record.timestamp) << payload << '\n';
+      }
+      continue;
+    }
+
+    auto& session_files = get_files(record.session);
+    auto& out = is_message ? session_files.messages : session_files.events;
+    out << FormatTimestamp(record.timestamp) << payload << '\n';
+  }
+
+  spdlog::info("converted {} records from {} sessions", count,
+               names.size() - 1);
+  return 0;
+}
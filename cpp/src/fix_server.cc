@@ -1,57 +1,295 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "common/application_traits.h"
+#include "common/flight_recorder.h"
+#include "common/journal_log.h"
+#include "common/metrics_region.h"
+#include "common/mmap_store.h"
 #include "common/signal_handler.h"
+#include "common/time_util.h"
+#include "common/transport.h"
 #include "server_app.h"
 
 template <typename Traits>
 class FixServer {
  private:
+  using TimeUtil = common::TimeUtil;
   using ServerApplication =
       fixserver::Application<typename Traits::EventQueuePtr>;
 
+  const FIX::MsgType kWarmupEvent{"WARMUP"};
+
  public:
   FixServer(std::string config)
       : config_(std::move(config)),
         queue_(std::make_shared<typename Traits::EventQueue>()),
-        application_(queue_),
+        application_(queue_, Traits::kBookShards, Traits::kBookRingSize),
         acceptor_{nullptr} {}
 
   auto Initialize() -> void {
     FIX::SessionSettings settings(config_);
-    FIX::FileStoreFactory store_factory(settings);
-    FIX::ScreenLogFactory log_factory(settings);
+    threads_ = common::ThreadConfig::FromSettings(settings.get());
+    Traits::ReserveArena(settings.get());
+    application_.SetValidators(
+        common::SessionValidators::FromSettings(settings));
+    application_.SetThrottles(
+        ServerApplication::Throttles::FromSettings(settings));
+
+    const auto& defaults = settings.get();
+    warmup_queue_depth_ =
+        defaults.has(Traits::kWarmupQueueDepthKey)
+            ? static_cast<std::size_t>(
+                  defaults.getInt(Traits::kWarmupQueueDepthKey))
+            : Traits::kWarmupQueueDepth;
+    warmup_messages_ = defaults.has(Traits::kWarmupMessagesKey)
+                           ? static_cast<std::size_t>(
+                                 defaults.getInt(Traits::kWarmupMessagesKey))
+                           : Traits::kWarmupMessages;
+    if (defaults.has(Traits::kQueueAlarmDepthKey)) {
+      queue_alarm_depth_ = static_cast<std::uint64_t>(
+          defaults.getInt(Traits::kQueueAlarmDepthKey));
+    }
+    if (defaults.has(Traits::kQueueAlarmWaitMicrosKey)) {
+      queue_alarm_wait_nanos_ =
+          static_cast<std::uint64_t>(
+              defaults.getInt(Traits::kQueueAlarmWaitMicrosKey)) *
+          1000;
+    }
+    if (defaults.has(Traits::kMetricsPathKey)) {
+      metrics_ = std::make_unique<common::MetricsRegion>(
+          defaults.getString(Traits::kMetricsPathKey));
+    }
+
+    if (defaults.has(Traits::kSymbolsKey)) {
+      std::vector<std::string> symbols;
+      std::stringstream list(defaults.getString(Traits::kSymbolsKey));
+      std::string symbol;
+      while (std::getline(list, symbol, ',')) {
+        symbols.push_back(symbol);
+      }
+      application_.SetSymbols(std::move(symbols));
+    }
+    application_.SetRiskLimits(common::RiskLimits::FromSettings(defaults));
+    application_.SetScales(common::SymbolScales::FromSettings(defaults));
+    common::FlightRecorder::Instance().Configure(defaults);
 
-    acceptor_ = std::make_unique<FIX::SocketAcceptor>(
-        application_, store_factory, settings, log_factory);
+    store_factory_ = std::make_unique<common::MmapStoreFactory>(settings);
+    log_factory_ =
+        std::make_unique<common::JournalLogFactory>(settings, threads_.journal);
+
+    auto transport = common::TransportConfig::FromSettings(defaults);
+    application_.SetSendBatch(transport);
+    acceptor_ = common::MakeAcceptor(application_, *store_factory_, settings,
+                                     *log_factory_, transport, threads_);
   }
 
+  // The processing thread warms up before the acceptor starts, so no logon is
+  // accepted until the queue, book workers and sender have all been exercised.
   auto Start() -> void {
-    acceptor_->start();
+    application_.Start(threads_);
+
+    running_ = true;
+    auto warmed_up = warmed_up_.get_future();
     process_thread_ = std::thread([&]() {
-      while (!acceptor_->isStopped()) {
+      common::ThreadUtil::Place(threads_.process, "process");
+      Warmup();
+      warmed_up_.set_value();
+
+      while (running_) {
+        auto next_release = application_.ReleaseThrottled();
         if (queue_->emptyQueue()) {
-          queue_->waitFor(Traits::kQueueWait);
+          queue_->waitFor(QueueWait(next_release));
         }
 
         queue_->process();
       }
     });
+
+    warmed_up.wait();
+    monitor_thread_ = std::thread([&]() { Monitor(); });
+    acceptor_->start();
   }
 
   auto Stop() -> void {
     acceptor_->stop();
+    {
+      std::lock_guard<std::mutex> lock(monitor_mutex_);
+      running_ = false;
+    }
+    monitor_cv_.notify_all();
+    if (monitor_thread_.joinable()) {
+      monitor_thread_.join();
+    }
     process_thread_.join();
+    application_.Stop();
+    LogQueueStats();
+    common::FlightRecorder::Instance().Stop();
+    common::BlockPool::LogStats();
   }
 
  private:
+  // Wakes up in time for the next throttled order, if one is held back.
+  static auto QueueWait(std::uint64_t next_release)
+      -> std::chrono::nanoseconds {
+    std::chrono::nanoseconds wait = Traits::kQueueWait;
+    if (next_release != 0) {
+      auto now = TimeUtil::EpochNanos();
+      wait = std::min(wait, std::chrono::nanoseconds(
+                                next_release > now ? next_release - now : 0));
+    }
+    return wait;
+  }
+
+  // Watches the event queue from its own thread, so a processing thread
+  // stuck behind the sessions is reported even while it is busy, and
+  // publishes the metrics region. Also recalibrates TscClock, so no thread
+  // stamping messages has to.
+  auto Monitor() -> void {
+    common::ThreadUtil::Place(common::ThreadPlacement{}, "monitor");
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
+    while (!monitor_cv_.wait_for(lock, Traits::kMonitorInterval,
+                                 [&]() { return !running_; })) {
+      common::TscClock::Instance().Recalibrate();
+      auto metrics = queue_->Metrics();
+      if (metrics_) {
+        PublishMetrics(metrics);
+      }
+      if ((queue_alarm_depth_ != 0 && metrics.depth > queue_alarm_depth_) ||
+          (queue_alarm_wait_nanos_ != 0 &&
+           metrics.oldest_wait_nanos > queue_alarm_wait_nanos_)) {
+        spdlog::warn(
+            "event queue falling behind: {} queued (high water {}), oldest "
+            "waiting {} us",
+            metrics.depth, metrics.high_water,
+            metrics.oldest_wait_nanos / 1000);
+      }
+    }
+  }
+
+  auto PublishMetrics(
+      const typename Traits::EventQueue::Snapshot& metrics) -> void {
+    using common::MetricKind;
+    metrics_->Clear();
+    metrics_->AddCounter("queue enqueued", metrics.enqueued);
+    metrics_->AddCounter("queue dispatched", metrics.dispatched);
+    metrics_->AddCounter("queue depth", metrics.depth, MetricKind::kGauge);
+    metrics_->AddCounter("queue high water", metrics.high_water,
+                         MetricKind::kGauge);
+    metrics_->AddCounter("queue oldest wait ns", metrics.oldest_wait_nanos,
+                         MetricKind::kGauge);
+    for (std::size_t index = 0;
+         index < static_cast<std::size_t>(fixserver::RejectReason::kCount);
+         ++index) {
+      auto reason = static_cast<fixserver::RejectReason>(index);
+      metrics_->AddCounter(
+          fmt::format("reject {}", fixserver::RejectReasonName(reason)),
+          application_.RejectCount(reason));
+    }
+
+    metrics_->AddHistogram("queue wait", metrics.residency);
+    if constexpr (common::LatencyTrace::kEnabled) {
+      using Interval = common::LatencyStats::Interval;
+      for (std::size_t index = 0;
+           index < common::LatencyStats::kIntervalCount; ++index) {
+        auto interval = static_cast<Interval>(index);
+        metrics_->AddHistogram(
+            fmt::format("latency {}",
+                        common::LatencyStats::IntervalName(interval)),
+            common::LatencyStats::Snapshot(interval));
+      }
+    }
+
+    for (const auto& counts : log_factory_->Counts()) {
+      metrics_->AddSession(counts.session, counts.incoming, counts.outgoing);
+    }
+    metrics_->Publish();
+  }
+
+  auto LogQueueStats() const -> void {
+    auto metrics = queue_->Metrics();
+    const auto& residency = metrics.residency;
+    spdlog::info(
+        "event queue: {} enqueued, {} dispatched, high water {}, waited mean "
+        "{} ns, p50 {} ns, p99 {} ns, max {} ns",
+        metrics.enqueued, metrics.dispatched, metrics.high_water,
+        residency.Mean(), residency.Percentile(0.5),
+        residency.Percentile(0.99), residency.max);
+  }
+
+  // Pre-populates the queue's free list, then runs synthetic orders through
+  // the cracker, queue, book workers and sender, and waits for them to drain.
+  auto Warmup() -> void {
+    auto start = TimeUtil::EpochNanos();
+    const auto& session_id = ServerApplication::WarmupSessionID();
+
+    for (std::size_t i = 0; i < warmup_queue_depth_; ++i) {
+      queue_->enqueue(kWarmupEvent, common::PooledFrame(), session_id);
+    }
+    queue_->process();
+
+    // The acceptor has already created its sessions, so this touches the
+    // same dictionary that will validate live traffic.
+    const FIX::DataDictionary* dictionary{nullptr};
+    const auto& live_session_id = Traits::GetSessionID();
+    auto* session = FIX::Session::lookupSession(live_session_id);
+    if (session != nullptr) {
+      const auto& provider = session->getDataDictionaryProvider();
+      dictionary = &provider.getSessionDataDictionary(
+          live_session_id.getBeginString());
+    }
+
+    auto dropped = application_.WarmupDropped();
+    application_.Warmup(warmup_messages_, live_session_id, dictionary);
+    queue_->process();
+
+    // A worker that threw or a lost response must not hold up startup.
+    auto deadline = std::chrono::steady_clock::now() + Traits::kWarmupTimeout;
+    auto expected = dropped + 2 * warmup_messages_;
+    while (application_.WarmupDropped() < expected) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        spdlog::warn("warm-up: {} of {} responses after {} s, going on",
+                     application_.WarmupDropped() - dropped,
+                     2 * warmup_messages_,
+                     std::chrono::seconds(Traits::kWarmupTimeout).count());
+        break;
+      }
+      std::this_thread::yield();
+    }
+
+    spdlog::info("warm-up: {} queue nodes, {} orders in {} us",
+                 warmup_queue_depth_, warmup_messages_,
+                 (TimeUtil::EpochNanos() - start) / 1000);
+  }
+
   std::string config_;
   typename Traits::EventQueuePtr queue_;
   ServerApplication application_;
+  // The acceptor keeps references to both factories.
+  std::unique_ptr<FIX::MessageStoreFactory> store_factory_;
+  std::unique_ptr<common::JournalLogFactory> log_factory_;
   std::unique_ptr<FIX::Acceptor> acceptor_;
+  common::ThreadConfig threads_;
+  std::size_t warmup_queue_depth_{Traits::kWarmupQueueDepth};
+  std::size_t warmup_messages_{Traits::kWarmupMessages};
+  std::uint64_t queue_alarm_depth_{0};
+  std::uint64_t queue_alarm_wait_nanos_{0};
+  std::unique_ptr<common::MetricsRegion> metrics_;
+  std::promise<void> warmed_up_;
+  std::atomic<bool> running_{false};
   std::thread process_thread_;
+  std::mutex monitor_mutex_;
+  std::condition_variable monitor_cv_;
+  std::thread monitor_thread_;
 };
 
 auto main(int argc, char** argv) -> int {
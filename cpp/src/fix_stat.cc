@@ -0,0 +1,142 @@
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "common/latency_histogram.h"
+#include "common/metrics_region.h"
+#include "spdlog/spdlog.h"
+
+// Prints the metrics fix_server publishes to its MetricsPath region, every
+// SECONDS (default 1): counters as totals and per-second rates, histograms
+// as percentiles over the last interval (the max is since the server
+// started), and messages in and out per session. It only maps the region
+// read-only; the server never waits on it.
+
+using common::LatencyHistogram;
+using common::MetricKind;
+using common::MetricsLayout;
+
+static auto Name(const std::array<char, MetricsLayout::kNameSize>& name)
+    -> std::string {
+  return {name.data()};
+}
+
+static auto FormatTime(std::uint64_t epoch_nanos) -> std::string {
+  auto seconds = static_cast<std::time_t>(epoch_nanos / 1000000000);
+  std::tm local{};
+  localtime_r(&seconds, &local);
+
+  char time[32];
+  std::strftime(time, sizeof(time), "%H:%M:%S", &local);
+  return time;
+}
+
+// Counts recorded since previous, with previous cumulative.
+static auto Since(LatencyHistogram::Counts counts,
+                  const LatencyHistogram::Counts& previous)
+    -> LatencyHistogram::Counts {
+  for (std::size_t index = 0; index < counts.buckets.size(); ++index) {
+    counts.buckets[index] -= std::min(counts.buckets[index],
+                                      previous.buckets[index]);
+  }
+  counts.count -= std::min(counts.count, previous.count);
+  counts.sum -= std::min(counts.sum, previous.sum);
+  return counts;
+}
+
+auto main(int argc, char** argv) -> int {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " FILE [SECONDS]." << std::endl;
+    return 1;
+  }
+
+  common::MetricsReader reader(argv[1]);
+  if (!reader.Valid()) {
+    spdlog::error("{} is not a metrics region", argv[1]);
+    return 1;
+  }
+  auto interval = std::chrono::seconds(argc > 2 ? std::stoi(argv[2]) : 1);
+
+  auto data = std::make_unique<MetricsLayout::Data>();
+  std::uint64_t previous_nanos{0};
+  std::map<std::string, std::uint64_t> previous_counters;
+  std::map<std::string, std::pair<std::uint64_t, std::uint64_t>>
+      previous_sessions;
+  std::map<std::string, LatencyHistogram::Counts> previous_histograms;
+
+  while (true) {
+    if (!reader.Read(*data)) {
+      spdlog::warn("no consistent read of {}", argv[1]);
+    } else if (data->published_nanos == 0) {
+      std::cout << "waiting for pid " << data->pid << " to publish"
+                << std::endl;
+    } else if (data->published_nanos == previous_nanos) {
+      std::cout << FormatTime(data->published_nanos) << " pid " << data->pid
+                << ": nothing new published" << std::endl;
+    } else {
+      auto seconds =
+          previous_nanos == 0
+              ? 0.0
+              : static_cast<double>(data->published_nanos - previous_nanos) /
+                    1e9;
+      auto rate = [&](std::uint64_t now, std::uint64_t before) {
+        return seconds > 0 && now >= before
+                   ? static_cast<double>(now - before) / seconds
+                   : 0.0;
+      };
+
+      std::cout << fmt::format("--- {} pid {} ---\n",
+                               FormatTime(data->published_nanos), data->pid);
+      for (std::uint32_t index = 0; index < data->counter_count; ++index) {
+        const auto& counter = data->counters[index];
+        auto name = Name(counter.name);
+        if (counter.kind == MetricKind::kGauge) {
+          std::cout << fmt::format("{:<32} {:>14}\n", name, counter.value);
+        } else {
+          auto& before = previous_counters[name];
+          std::cout << fmt::format("{:<32} {:>14} {:>12.0f}/s\n", name,
+                                   counter.value, rate(counter.value, before));
+          before = counter.value;
+        }
+      }
+
+      // The region keeps only a running max, so that column is lifetime.
+      std::cout << fmt::format("{:<32} {:>10} {:>10} {:>10} {:>10} {:>12}\n",
+                               "histogram (ns, last interval)", "count",
+                               "p50", "p99", "p99.9", "lifetime max");
+      for (std::uint32_t index = 0; index < data->histogram_count; ++index) {
+        const auto& histogram = data->histograms[index];
+        auto name = Name(histogram.name);
+        auto counts = MetricsLayout::ToCounts(histogram);
+        auto& before = previous_histograms[name];
+        auto recent = Since(counts, before);
+        std::cout << fmt::format(
+            "{:<32} {:>10} {:>10} {:>10} {:>10} {:>12}\n", name, recent.count,
+            recent.Percentile(0.5), recent.Percentile(0.99),
+            recent.Percentile(0.999), counts.max);
+        before = counts;
+      }
+
+      std::cout << fmt::format("{:<32} {:>10} {:>10} {:>14} {:>14}\n",
+                               "session", "in/s", "out/s", "in", "out");
+      for (std::uint32_t index = 0; index < data->session_count; ++index) {
+        const auto& session = data->sessions[index];
+        auto name = Name(session.name);
+        auto& before = previous_sessions[name];
+        std::cout << fmt::format("{:<32} {:>10.0f} {:>10.0f} {:>14} {:>14}\n",
+                                 name, rate(session.incoming, before.first),
+                                 rate(session.outgoing, before.second),
+                                 session.incoming, session.outgoing);
+        before = {session.incoming, session.outgoing};
+      }
+      std::cout << std::flush;
+      previous_nanos = data->published_nanos;
+    }
+
+    std::this_thread::sleep_for(interval);
+  }
+}
@@ -2,8 +2,10 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <thread>
 
+#include "common/fix_framing.h"
 #include "quickfix/Message.h"
 #include "spdlog/spdlog.h"
 
@@ -11,6 +13,15 @@ static constexpr auto kLineCountNotify = 10000000;
 static constexpr auto kFixTimestampLength = 30;
 static constexpr auto kDataDictFile = "/workspaces/quickfix/FIX44.xml";
 
+// Whether line holds exactly one message whose BodyLength and CheckSum
+// match its bytes.
+static auto Framed(std::string_view line) -> bool {
+  auto frame = common::FixFrame::Find(line);
+  return frame.status == common::FixFrame::Status::kComplete &&
+         frame.skip == 0 && frame.length == line.size() &&
+         common::FixFrame::ChecksumValid(line);
+}
+
 auto main(int argc, char** argv) -> int {
   if (argc < 2) {
     std::cout << "usage: " << argv[0] << " FILE." << std::endl;
@@ -35,6 +46,7 @@ auto main(int argc, char** argv) -> int {
   FIX::OfferPx offer_px;
   FIX::OfferSize offer_sz;
 
+  std::int32_t malformed{0};
   std::vector<std::string> error_vec;
   std::set<FIX::QuoteID> quote_id_set;
   std::set<FIX::QuoteID> non_standard_set;
@@ -45,33 +57,38 @@ auto main(int argc, char** argv) -> int {
 
     if (!str.empty()) {
       const auto& msg = str.substr(kFixTimestampLength);
-      const auto& fix_msg = FIX::Message(msg);
-
-      if (fix_msg.getFieldIfSet(quote_id) &&
-          fix_msg.getFieldIfSet(security_id)) {
-        quote_id_set.emplace(quote_id);
-        security_id_set.emplace(security_id);
-
-        auto has_settle_date = fix_msg.getFieldIfSet(settle_date);
-        if (has_settle_date) {
-          if (settle_date.getString() != "20220214") {
-            non_standard_set.insert(quote_id);
+      // BodyLength and CheckSum are checked here, so the parse need not.
+      if (!Framed(msg)) {
+        ++malformed;
+      } else {
+        const auto& fix_msg = FIX::Message(msg, false);
+
+        if (fix_msg.getFieldIfSet(quote_id) &&
+            fix_msg.getFieldIfSet(security_id)) {
+          quote_id_set.emplace(quote_id);
+          security_id_set.emplace(security_id);
+
+          auto has_settle_date = fix_msg.getFieldIfSet(settle_date);
+          if (has_settle_date) {
+            if (settle_date.getString() != "20220214") {
+              non_standard_set.insert(quote_id);
+            }
           }
-        }
 
-        if (non_standard_set.count(quote_id) == 1 && !has_settle_date) {
-          fix_msg.getField(bid_px);
-          fix_msg.getField(bid_sz);
-          fix_msg.getField(offer_px);
-          fix_msg.getField(offer_sz);
-
-          if (bid_px.getValue() != 0 || bid_sz.getValue() != 0 ||
-              offer_px.getValue() != 0 || offer_sz.getValue() != 0) {
-            spdlog::warn("invalid quote_id: {}", quote_id.getString());
-            // spdlog::warn(msg);
-            std::string copy = msg;
-            std::replace(copy.begin(), copy.end(), '\001', '|');
-            error_vec.emplace_back(copy);
+          if (non_standard_set.count(quote_id) == 1 && !has_settle_date) {
+            fix_msg.getField(bid_px);
+            fix_msg.getField(bid_sz);
+            fix_msg.getField(offer_px);
+            fix_msg.getField(offer_sz);
+
+            if (bid_px.getValue() != 0 || bid_sz.getValue() != 0 ||
+                offer_px.getValue() != 0 || offer_sz.getValue() != 0) {
+              spdlog::warn("invalid quote_id: {}", quote_id.getString());
+              // spdlog::warn(msg);
+              std::string copy = msg;
+              std::replace(copy.begin(), copy.end(), '\001', '|');
+              error_vec.emplace_back(copy);
+            }
           }
         }
       }
@@ -95,6 +112,7 @@ auto main(int argc, char** argv) -> int {
   spdlog::info(" {} unique quote_ids with non-standard settlement",
                non_standard_set.size());
   spdlog::info(" {} errors", error_vec.size());
+  spdlog::info(" {} lines with a bad BodyLength or CheckSum", malformed);
 
   for (auto& msg : error_vec) {
     std::cout << msg << std::endl;
@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "common/decimal.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::Decimal;
+
+TEST(DecimalTest, ParsesUnitsAndScale) {
+  auto price = Decimal::Parse("101.25");
+  ASSERT_TRUE(price);
+  EXPECT_EQ(price->Units(), 10125);
+  EXPECT_EQ(price->Scale(), 2);
+
+  auto negative = Decimal::Parse("-0.005");
+  ASSERT_TRUE(negative);
+  EXPECT_EQ(negative->Units(), -5);
+  EXPECT_EQ(negative->Scale(), 3);
+
+  EXPECT_EQ(Decimal::Parse("100.")->Scale(), 0);
+  EXPECT_EQ(Decimal::Parse(".5")->Units(), 5);
+}
+
+TEST(DecimalTest, RejectsWhatIsNotPlainDecimal) {
+  for (const auto* text :
+       {"", "-", ".", "1e5", "1.2.3", "+1", "1,5", " 1", "0x10",
+        "99999999999999999999", "0.0000000000000000001"}) {
+    EXPECT_FALSE(Decimal::Parse(text)) << text;
+  }
+  EXPECT_TRUE(Decimal::Parse("922337203685477580"));
+  EXPECT_TRUE(Decimal::Parse("0.000000000000000001"));
+}
+
+TEST(DecimalTest, FormatsShortestForm) {
+  EXPECT_EQ(Decimal::Parse("101.25")->ToString(), "101.25");
+  EXPECT_EQ(Decimal::Parse("1.2500")->ToString(), "1.25");
+  EXPECT_EQ(Decimal::Parse("100")->ToString(), "100");
+  EXPECT_EQ(Decimal::Parse("100.00")->ToString(), "100");
+  EXPECT_EQ(Decimal::Parse(".5")->ToString(), "0.5");
+  EXPECT_EQ(Decimal::Parse("-0.005")->ToString(), "-0.005");
+  EXPECT_EQ(Decimal::Parse("0.000")->ToString(), "0");
+  EXPECT_EQ(Decimal(-1, 18).ToString(), "-0.000000000000000001");
+}
+
+TEST(DecimalTest, FormatStopsAtTheEndOfTheBuffer) {
+  char out[4];
+  auto value = Decimal(12345, 2);
+  EXPECT_EQ(value.Format(out, out + sizeof(out)), out + sizeof(out));
+  char room[6];
+  auto* end = value.Format(room, room + sizeof(room));
+  EXPECT_EQ(std::string(room, end), "123.45");
+}
+
+TEST(DecimalTest, ComparesAcrossScales) {
+  EXPECT_EQ(*Decimal::Parse("1.10"), *Decimal::Parse("1.1"));
+  EXPECT_GT(*Decimal::Parse("1.01"), *Decimal::Parse("1"));
+  EXPECT_LT(*Decimal::Parse("-1"), *Decimal::Parse("0.0001"));
+  EXPECT_LT(Decimal(1, 18), Decimal(1, 0));
+}
+
+// Rescaling never rounds: a value with digits finer than the target scale,
+// or one that would overflow, has no value at that scale.
+TEST(DecimalTest, RescaleIsExactOrNothing) {
+  auto price = *Decimal::Parse("101.25");
+  EXPECT_FALSE(price.Rescale(1));
+  EXPECT_EQ(price.Rescale(4)->Units(), 1012500);
+  EXPECT_EQ(Decimal::Parse("1.2500")->Rescale(2)->Units(), 125);
+  EXPECT_EQ(Decimal::Parse("-7.00")->Rescale(0)->Units(), -7);
+  EXPECT_FALSE(Decimal::Parse("-7.01")->Rescale(0));
+  EXPECT_FALSE(Decimal(900000000000000000, 0).Rescale(2));
+  EXPECT_FALSE(price.Rescale(-1));
+  EXPECT_FALSE(price.Rescale(Decimal::kMaxScale + 1));
+}
+
+TEST(DecimalTest, ProductsCompareExactly) {
+  auto qty = *Decimal::Parse("10000");
+  auto price = *Decimal::Parse("100.5");
+  auto limit = *Decimal::Parse("1005000");
+  EXPECT_EQ(qty.Times(price), limit.Widen());
+  EXPECT_FALSE(qty.Times(price) > limit.Widen());
+  EXPECT_TRUE(qty.Times(price) > Decimal::Parse("1004999.99")->Widen());
+
+  auto large = Decimal(922337203685477580, 0);
+  EXPECT_GT(large.Times(large), Decimal(1, 18).Widen());
+}
+
+// Round trips, and agreement with printf's rounding of the same value at
+// its own scale.
+TEST(DecimalTest, RoundTripsRandomValues) {
+  std::mt19937_64 random(1);
+  for (int i = 0; i < 100000; ++i) {
+    auto units = static_cast<std::int64_t>(random() % 2000000000000ULL) -
+                 1000000000000LL;
+    auto scale = static_cast<int>(random() % 9);
+    Decimal value(units, scale);
+
+    auto back = Decimal::Parse(value.ToString());
+    ASSERT_TRUE(back) << value.ToString();
+    ASSERT_EQ(*back, value) << value.ToString();
+
+    double divisor{1};
+    for (int step = 0; step < scale; ++step) {
+      divisor *= 10;
+    }
+    char printed[64];
+    std::snprintf(printed, sizeof(printed), "%.*f", scale,
+                  static_cast<double>(units) / divisor);
+    ASSERT_EQ(*Decimal::Parse(printed), value) << printed;
+  }
+}
+
+}  // namespace
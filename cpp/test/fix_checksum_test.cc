@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "common/fix_checksum.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::FixChecksum;
+
+auto ScalarSum(std::string_view bytes) -> std::uint32_t {
+  std::uint32_t sum{0};
+  for (auto c : bytes) {
+    sum += static_cast<unsigned char>(c);
+  }
+  return sum;
+}
+
+// Every length around the 16- and 32-byte steps, from every alignment.
+TEST(FixChecksumTest, MatchesScalarSumForEveryLengthAndOffset) {
+  std::mt19937 random(42);
+  std::string data(300, '\0');
+  for (auto& c : data) {
+    c = static_cast<char>(random());
+  }
+
+  for (std::size_t offset = 0; offset < 32; ++offset) {
+    for (std::size_t size = 0; offset + size <= data.size(); ++size) {
+      std::string_view bytes(data.data() + offset, size);
+      ASSERT_EQ(FixChecksum::Sum(bytes.data(), bytes.size()),
+                ScalarSum(bytes))
+          << "offset " << offset << " size " << size;
+      ASSERT_EQ(FixChecksum::Of(bytes),
+                static_cast<std::uint8_t>(ScalarSum(bytes)));
+    }
+  }
+}
+
+TEST(FixChecksumTest, HighBytesAreUnsigned) {
+  std::string bytes(1000, static_cast<char>(0xff));
+  EXPECT_EQ(FixChecksum::Sum(bytes.data(), bytes.size()), 255000U);
+  EXPECT_EQ(FixChecksum::Of(bytes), 255000 % 256);
+}
+
+// Long enough for a 64-bit lane to pass 2^32, which the sum wraps at.
+TEST(FixChecksumTest, LargeInputWrapsAtThirtyTwoBits) {
+  std::string bytes(std::size_t{20} << 20, static_cast<char>(0xfe));
+  EXPECT_EQ(FixChecksum::Sum(bytes.data(), bytes.size()), ScalarSum(bytes));
+}
+
+TEST(FixChecksumTest, FormatsThreeDigits) {
+  char out[3];
+  FixChecksum::Format(7, out);
+  EXPECT_EQ(std::string_view(out, 3), "007");
+  FixChecksum::Format(255, out);
+  EXPECT_EQ(std::string_view(out, 3), "255");
+  FixChecksum::Format(40, out);
+  EXPECT_EQ(std::string_view(out, 3), "040");
+}
+
+TEST(FixChecksumTest, MatchesAKnownMessage) {
+  std::string_view message =
+      "8=FIX.4.2\0019=49\00135=5\00134=1\00149=ARCA\00152=20150916-04:14:05.306"
+      "\00156=TW\001";
+  EXPECT_EQ(FixChecksum::Of(message), ScalarSum(message) % 256);
+}
+
+}  // namespace
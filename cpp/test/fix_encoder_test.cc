@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "common/decimal.h"
+#include "common/fix_encoder.h"
+#include "common/fix_framing.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::FixEncoder;
+
+// What the encoder should produce for body: the header with BodyLength,
+// then the CheckSum, computed byte by byte.
+auto Expected(const std::string& body) -> std::string {
+  auto message = "8=FIX.4.2\0019=" + std::to_string(body.size()) + "\001" +
+                 body;
+  unsigned sum{0};
+  for (auto c : message) {
+    sum += static_cast<unsigned char>(c);
+  }
+  char trailer[8];
+  std::snprintf(trailer, sizeof(trailer), "10=%03u\001", sum % 256);
+  return message + trailer;
+}
+
+// A body of exactly size bytes: MsgType then a padded Text field.
+auto Encode(FixEncoder& encoder, std::size_t size) -> std::string {
+  const std::string msg_type = "35=8\001";
+  auto padding = size - msg_type.size() - 4;  // "58=" and SOH
+  encoder.Begin("FIX.4.2");
+  encoder.Field(35, '8');
+  encoder.Field(58, std::string(padding, 'x'));
+  return encoder.Finish();
+}
+
+TEST(FixEncoderTest, WritesFieldsInOrder) {
+  FixEncoder encoder;
+  encoder.Begin("FIX.4.2");
+  encoder.Field(35, 'D');
+  encoder.Field(49, std::string_view("CLIENT"));
+  encoder.Field(34, 12);
+  encoder.Field(38, std::int64_t{-5});
+  encoder.Field(44, common::Decimal(10125, 2));
+  EXPECT_EQ(encoder.Finish(),
+            Expected("35=D\00149=CLIENT\00134=12\00138=-5\00144=101.25\001"));
+}
+
+// BodyLength has room for three digits; shorter and longer bodies are
+// moved once Finish() knows the length.
+TEST(FixEncoderTest, BodyLengthOfEveryWidth) {
+  FixEncoder encoder;
+  for (std::size_t size :
+       {10U, 99U, 100U, 512U, 999U, 1000U, 4096U, 10000U, 123456U}) {
+    auto message = Encode(encoder, size);
+    std::string body = "35=8\00158=" + std::string(size - 9, 'x') + "\001";
+    ASSERT_EQ(message, Expected(body)) << "body of " << size;
+
+    auto frame = common::FixFrame::Find(message);
+    EXPECT_EQ(frame.status, common::FixFrame::Status::kComplete);
+    EXPECT_EQ(frame.length, message.size());
+    EXPECT_TRUE(common::FixFrame::ChecksumValid(message));
+  }
+}
+
+// Each message starts afresh, whatever width the one before needed.
+TEST(FixEncoderTest, ReusesBufferAcrossMessages) {
+  FixEncoder encoder;
+  for (std::size_t size : {5000U, 20U, 300U, 20U}) {
+    std::string body = "35=8\00158=" + std::string(size - 9, 'x') + "\001";
+    EXPECT_EQ(Encode(encoder, size), Expected(body));
+  }
+}
+
+TEST(FixEncoderTest, TakenMessageLeavesEncoderUsable) {
+  FixEncoder encoder;
+  encoder.Begin("FIX.4.2");
+  encoder.Field(35, '0');
+  std::string taken;
+  taken.swap(encoder.Finish());
+  EXPECT_EQ(taken, Expected("35=0\001"));
+
+  encoder.Begin("FIX.4.2");
+  encoder.Field(35, '1');
+  EXPECT_EQ(encoder.Finish(), Expected("35=1\001"));
+}
+
+TEST(FixEncoderTest, TimestampHasMilliseconds) {
+  FixEncoder encoder;
+  // 2021-03-04 05:06:07.089 UTC
+  std::uint64_t nanos = 1614834367ULL * 1000000000ULL + 89123456ULL;
+  encoder.Begin("FIX.4.2");
+  encoder.Timestamp(52, nanos);
+  encoder.Timestamp(60, nanos + 1000000000ULL);
+  EXPECT_EQ(encoder.Finish(), Expected("52=20210304-05:06:07.089\001"
+                                       "60=20210304-05:06:08.089\001"));
+}
+
+TEST(FixEncoderTest, TimestampFollowsPrecision) {
+  FixEncoder encoder;
+  std::uint64_t nanos = 1614834367ULL * 1000000000ULL + 89123456ULL;
+  encoder.Begin("FIX.4.2");
+  encoder.Timestamp(52, nanos, 0);
+  encoder.Timestamp(52, nanos, 6);
+  encoder.Timestamp(52, nanos, 9);
+  EXPECT_EQ(encoder.Finish(), Expected("52=20210304-05:06:07\001"
+                                       "52=20210304-05:06:07.089123\001"
+                                       "52=20210304-05:06:07.089123456\001"));
+}
+
+TEST(FixEncoderTest, DoublesInShortestFixedNotation) {
+  char out[64];
+  auto* end = FixEncoder::Format(0.1, out, out + sizeof(out));
+  EXPECT_EQ(std::string_view(out, end - out), "0.1");
+  end = FixEncoder::Format(1e6, out, out + sizeof(out));
+  EXPECT_EQ(std::string_view(out, end - out), "1000000");
+}
+
+}  // namespace
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/fix_framing.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::FixFields;
+using common::FixFrame;
+using Status = common::FixFrame::Status;
+
+// A complete message around body, with its BodyLength and CheckSum.
+auto Message(const std::string& body) -> std::string {
+  auto message = "8=FIX.4.2\0019=" + std::to_string(body.size()) + "\001" +
+                 body;
+  unsigned sum{0};
+  for (auto c : message) {
+    sum += static_cast<unsigned char>(c);
+  }
+  char trailer[8];
+  std::snprintf(trailer, sizeof(trailer), "10=%03u\001", sum % 256);
+  return message + trailer;
+}
+
+const std::string kBody = "35=D\00149=CLIENT\00156=SERVER\00111=ORDER1\001";
+
+TEST(FixFrameTest, FindsCompleteMessage) {
+  auto message = Message(kBody);
+  auto frame = FixFrame::Find(message);
+  EXPECT_EQ(frame.status, Status::kComplete);
+  EXPECT_EQ(frame.skip, 0U);
+  EXPECT_EQ(frame.length, message.size());
+  EXPECT_TRUE(FixFrame::ChecksumValid(message));
+}
+
+TEST(FixFrameTest, SplitsBackToBackMessages) {
+  auto first = Message(kBody);
+  auto second = Message("35=F\00111=ORDER2\00141=ORDER1\001");
+  auto stream = first + second;
+
+  std::string_view data(stream);
+  auto frame = FixFrame::Find(data);
+  ASSERT_EQ(frame.status, Status::kComplete);
+  EXPECT_EQ(data.substr(frame.skip, frame.length), first);
+
+  data.remove_prefix(frame.skip + frame.length);
+  frame = FixFrame::Find(data);
+  ASSERT_EQ(frame.status, Status::kComplete);
+  EXPECT_EQ(data.substr(frame.skip, frame.length), second);
+}
+
+TEST(FixFrameTest, EveryPrefixIsIncompleteUntilTheLastByte) {
+  auto message = Message(kBody);
+  for (std::size_t size = 0; size < message.size(); ++size) {
+    auto frame = FixFrame::Find(std::string_view(message).substr(0, size));
+    EXPECT_EQ(frame.status, Status::kIncomplete) << "at " << size;
+    EXPECT_EQ(frame.skip, 0U) << "at " << size;
+    if (frame.length != 0) {
+      EXPECT_EQ(frame.length, message.size()) << "at " << size;
+    }
+  }
+}
+
+TEST(FixFrameTest, SkipsBytesBeforeBeginString) {
+  auto message = Message(kBody);
+  auto stream = "garbage\001" + message;
+  auto frame = FixFrame::Find(stream);
+  ASSERT_EQ(frame.status, Status::kComplete);
+  EXPECT_EQ(frame.skip, 8U);
+  EXPECT_EQ(frame.length, message.size());
+}
+
+TEST(FixFrameTest, KeepsTrailingEightThatMayStartAMessage) {
+  auto frame = FixFrame::Find("noise8");
+  EXPECT_EQ(frame.status, Status::kIncomplete);
+  EXPECT_EQ(frame.skip, 5U);
+
+  frame = FixFrame::Find("noise");
+  EXPECT_EQ(frame.skip, 5U);
+}
+
+TEST(FixFrameTest, RejectsMissingBodyLength) {
+  auto frame = FixFrame::Find("8=FIX.4.2\00135=D\001");
+  EXPECT_EQ(frame.status, Status::kMalformed);
+}
+
+TEST(FixFrameTest, RejectsNonDigitBodyLength) {
+  auto frame = FixFrame::Find("8=FIX.4.2\0019=1x\00135=D\001");
+  EXPECT_EQ(frame.status, Status::kMalformed);
+}
+
+TEST(FixFrameTest, RejectsHugeBodyLength) {
+  auto frame = FixFrame::Find("8=FIX.4.2\0019=999999999999\001");
+  EXPECT_EQ(frame.status, Status::kMalformed);
+}
+
+TEST(FixFrameTest, RejectsBodyLengthThatMissesTheTrailer) {
+  auto message = Message(kBody);
+  auto length = std::to_string(kBody.size());
+  auto wrong = std::to_string(kBody.size() - 1);
+  message.replace(message.find("9=" + length) + 2, length.size(), wrong);
+  auto frame = FixFrame::Find(message + "pad");
+  EXPECT_EQ(frame.status, Status::kMalformed);
+}
+
+TEST(FixFrameTest, DetectsBadChecksum) {
+  auto message = Message(kBody);
+  auto digit = message.size() - 2;
+  message[digit] = message[digit] == '0' ? '1' : '0';
+  ASSERT_EQ(FixFrame::Find(message).status, Status::kComplete);
+  EXPECT_FALSE(FixFrame::ChecksumValid(message));
+}
+
+TEST(FixFieldsTest, VisitsFieldsInOrder) {
+  std::vector<std::pair<int, std::string>> fields;
+  EXPECT_TRUE(FixFields::ForEach("35=D\00111=A\00155=IBM\001",
+                                 [&](int tag, std::string_view value) {
+                                   fields.emplace_back(tag, value);
+                                   return true;
+                                 }));
+  EXPECT_EQ(fields, (std::vector<std::pair<int, std::string>>{
+                        {35, "D"}, {11, "A"}, {55, "IBM"}}));
+}
+
+TEST(FixFieldsTest, RejectsBadFields) {
+  auto ignore = [](int, std::string_view) { return true; };
+  EXPECT_FALSE(FixFields::ForEach("=D\001", ignore));
+  EXPECT_FALSE(FixFields::ForEach("3x=D\001", ignore));
+  EXPECT_FALSE(FixFields::ForEach("35=D", ignore));
+}
+
+TEST(FixFieldsTest, FindsFirstValue) {
+  auto message = Message(kBody);
+  EXPECT_EQ(FixFields::Find(message, 11), "ORDER1");
+  EXPECT_EQ(FixFields::Find(message, 8), "FIX.4.2");
+  EXPECT_FALSE(FixFields::Find(message, 44).has_value());
+}
+
+}  // namespace
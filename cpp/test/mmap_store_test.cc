@@ -0,0 +1,217 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/mmap_store.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::MmapStore;
+using common::StoreSync;
+
+// A fresh store file per test, removed afterwards.
+class MmapStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() /
+            ("mmap_store_test_" +
+             std::string(::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name()) +
+             ".mmap");
+    std::filesystem::remove(path_);
+  }
+
+  void TearDown() override { std::filesystem::remove(path_); }
+
+  auto Open(std::size_t capacity = 1U << 16U,
+            StoreSync sync = StoreSync::kNone) -> std::unique_ptr<MmapStore> {
+    return std::make_unique<MmapStore>(FIX::UtcTimeStamp(), path_.string(),
+                                       capacity, sync,
+                                       std::chrono::milliseconds(1));
+  }
+
+  static auto App(int seqnum) -> std::string {
+    return "8=FIX.4.2\0019=20\00135=8\00134=" + std::to_string(seqnum) +
+           "\00110=000\001";
+  }
+
+  static auto Heartbeat(int seqnum) -> std::string {
+    return "8=FIX.4.2\0019=20\00135=0\00134=" + std::to_string(seqnum) +
+           "\00110=000\001";
+  }
+
+  std::filesystem::path path_;
+};
+
+TEST_F(MmapStoreTest, GetReturnsStoredApplicationMessages) {
+  auto store = Open();
+  for (int seqnum = 1; seqnum <= 5; ++seqnum) {
+    store->set(seqnum, App(seqnum));
+  }
+
+  std::vector<std::string> messages;
+  store->get(2, 4, messages);
+  EXPECT_EQ(messages, (std::vector<std::string>{App(2), App(3), App(4)}));
+}
+
+TEST_F(MmapStoreTest, GetSkipsSessionMessagesButKeepsTrailingOne) {
+  auto store = Open();
+  store->set(1, App(1));
+  store->set(2, Heartbeat(2));
+  store->set(3, App(3));
+  store->set(4, Heartbeat(4));
+  store->set(5, Heartbeat(5));
+
+  std::vector<std::string> messages;
+  store->get(1, 5, messages);
+  EXPECT_EQ(messages,
+            (std::vector<std::string>{App(1), App(3), Heartbeat(5)}));
+}
+
+TEST_F(MmapStoreTest, GetClampsEndToLastStored) {
+  auto store = Open();
+  store->set(1, App(1));
+  store->set(2, App(2));
+
+  std::vector<std::string> messages;
+  store->get(2, 1000000, messages);
+  EXPECT_EQ(messages, (std::vector<std::string>{App(2)}));
+}
+
+TEST_F(MmapStoreTest, GetRangeBeyondIndexIsEmpty) {
+  auto store = Open();
+  store->set(1, App(1));
+  store->set(2, App(2));
+
+  std::vector<std::string> messages{"stale"};
+  store->get(500, 1000, messages);
+  EXPECT_TRUE(messages.empty());
+
+  store->get(500, 0, messages);
+  EXPECT_TRUE(messages.empty());
+}
+
+TEST_F(MmapStoreTest, ResetForgetsMessagesAndSequenceNumbers) {
+  auto store = Open();
+  store->set(1, App(1));
+  store->setNextSenderMsgSeqNum(7);
+  store->setNextTargetMsgSeqNum(9);
+
+  store->reset(FIX::UtcTimeStamp());
+  EXPECT_EQ(store->getNextSenderMsgSeqNum(), 1);
+  EXPECT_EQ(store->getNextTargetMsgSeqNum(), 1);
+
+  std::vector<std::string> messages;
+  store->get(1, 10, messages);
+  EXPECT_TRUE(messages.empty());
+}
+
+TEST_F(MmapStoreTest, ReopenRebuildsIndexAndSequenceNumbers) {
+  {
+    auto store = Open();
+    store->set(1, App(1));
+    store->set(2, Heartbeat(2));
+    store->incrNextSenderMsgSeqNum();
+    store->incrNextSenderMsgSeqNum();
+  }
+
+  auto store = Open();
+  EXPECT_EQ(store->getNextSenderMsgSeqNum(), 3);
+  EXPECT_EQ(store->Find(1), App(1));
+  EXPECT_TRUE(store->IsAdmin(2));
+  EXPECT_FALSE(store->IsAdmin(1));
+}
+
+TEST_F(MmapStoreTest, GrowsPastInitialCapacity) {
+  auto store = Open(8192);
+  std::string large(3000, 'x');
+  for (int seqnum = 1; seqnum <= 20; ++seqnum) {
+    store->set(seqnum, App(seqnum) + large);
+  }
+
+  EXPECT_EQ(store->Find(1), App(1) + large);
+  EXPECT_EQ(store->Find(20), App(20) + large);
+}
+
+// A session that starts at a high seqnum indexes from there, not from 1.
+TEST_F(MmapStoreTest, IndexStartsAtFirstStoredSeqnum) {
+  auto store = Open();
+  const FIX::SEQNUM first = 4000000000ULL;
+  for (auto seqnum = first; seqnum < first + 3; ++seqnum) {
+    store->set(seqnum, App(static_cast<int>(seqnum - first)));
+  }
+
+  EXPECT_EQ(store->Find(first + 1), App(1));
+  EXPECT_TRUE(store->Find(1).empty());
+  std::vector<std::string> messages;
+  store->get(1, first + 1, messages);
+  EXPECT_EQ(messages, (std::vector<std::string>{App(0), App(1)}));
+
+  // An earlier seqnum close by extends the index downwards.
+  store->set(first - 2, App(7));
+  store->get(first - 5, first, messages);
+  EXPECT_EQ(messages, (std::vector<std::string>{App(7), App(0)}));
+}
+
+// A jump far past the indexed range restarts the index rather than
+// allocating for every seqnum skipped.
+TEST_F(MmapStoreTest, FarJumpRestartsTheIndex) {
+  auto store = Open();
+  store->set(1, App(1));
+  store->set(2, App(2));
+  const FIX::SEQNUM far = 1ULL << 40U;
+  store->set(far, App(3));
+
+  EXPECT_EQ(store->Find(far), App(3));
+  EXPECT_TRUE(store->Find(1).empty());
+  std::vector<std::string> messages;
+  store->get(1, far, messages);
+  EXPECT_EQ(messages, (std::vector<std::string>{App(3)}));
+}
+
+// A record whose prefix claims a seqnum never sent ends the log there.
+TEST_F(MmapStoreTest, ReopenDropsRecordsFromABadPrefix) {
+  {
+    auto store = Open();
+    for (int seqnum = 1; seqnum <= 3; ++seqnum) {
+      store->set(seqnum, App(seqnum));
+      store->incrNextSenderMsgSeqNum();
+    }
+  }
+
+  // The second record starts right after the first, padded to 8 bytes.
+  const auto second = 4096 + ((16 + App(1).size() + 7) / 8 * 8);
+  {
+    std::fstream file(path_, std::ios::in | std::ios::out | std::ios::binary);
+    const std::uint64_t corrupt = 1ULL << 62U;
+    file.seekp(static_cast<std::streamoff>(second));
+    file.write(reinterpret_cast<const char*>(&corrupt), sizeof(corrupt));
+  }
+
+  auto store = Open();
+  EXPECT_EQ(store->Find(1), App(1));
+  EXPECT_TRUE(store->Find(2).empty());
+  EXPECT_TRUE(store->Find(3).empty());
+
+  // What is stored next goes where the bad record was.
+  store->set(2, App(2));
+  EXPECT_EQ(store->Find(2), App(2));
+}
+
+// Growing while the flusher syncs every millisecond keeps every record.
+TEST_F(MmapStoreTest, GrowsWhilePeriodicFlushRuns) {
+  auto store = Open(8192, StoreSync::kPeriodic);
+  std::string large(3000, 'x');
+  for (int seqnum = 1; seqnum <= 200; ++seqnum) {
+    store->set(seqnum, App(seqnum) + large);
+  }
+  for (int seqnum = 1; seqnum <= 200; ++seqnum) {
+    ASSERT_EQ(store->Find(seqnum), App(seqnum) + large);
+  }
+}
+
+}  // namespace
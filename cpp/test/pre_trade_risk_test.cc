@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/decimal.h"
+#include "common/pre_trade_risk.h"
+#include "common/time_util.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::Decimal;
+using common::PreTradeRisk;
+using common::RiskLimits;
+using common::RiskReject;
+
+auto D(const char* text) -> Decimal { return *Decimal::Parse(text); }
+
+auto Risk(const RiskLimits& limits,
+          const std::vector<std::string>& symbols = {"IBM", "MSFT"})
+    -> PreTradeRisk {
+  PreTradeRisk risk;
+  risk.Configure(limits, symbols);
+  return risk;
+}
+
+TEST(PreTradeRiskTest, UnsetLimitsPassEverything) {
+  auto risk = Risk(RiskLimits{});
+  auto result = risk.Check("ACCT", "IBM", D("1000000000"), D("99999.99"));
+  EXPECT_TRUE(result);
+  EXPECT_NE(result.account, nullptr);
+  EXPECT_EQ(result.symbol, 0);
+}
+
+TEST(PreTradeRiskTest, OrderQtyIsInclusive) {
+  RiskLimits limits;
+  limits.max_order_qty = D("100");
+  auto risk = Risk(limits);
+  EXPECT_TRUE(risk.Check("ACCT", "IBM", D("100"), D("1")));
+  EXPECT_TRUE(risk.Check("ACCT", "IBM", D("100.000"), D("1")));
+  EXPECT_EQ(risk.Check("ACCT", "IBM", D("100.001"), D("1")).reject,
+            RiskReject::kOrderQty);
+}
+
+// Qty times price is compared exactly, whatever the scales.
+TEST(PreTradeRiskTest, NotionalIsExact) {
+  RiskLimits limits;
+  limits.max_order_notional = D("1005000");
+  auto risk = Risk(limits);
+  EXPECT_TRUE(risk.Check("ACCT", "IBM", D("10000"), D("100.5")));
+  EXPECT_EQ(risk.Check("ACCT", "IBM", D("10000"), D("100.5000001")).reject,
+            RiskReject::kNotional);
+  EXPECT_EQ(risk.Check("ACCT", "IBM", D("10000.01"), D("100.5")).reject,
+            RiskReject::kNotional);
+}
+
+// The band applies once a symbol has filled, and only to listed symbols.
+TEST(PreTradeRiskTest, PriceBandFromLastFill) {
+  RiskLimits limits;
+  limits.price_band_percent = D("5");
+  auto risk = Risk(limits);
+
+  auto first = risk.Check("ACCT", "IBM", D("1"), D("500.00"));
+  ASSERT_TRUE(first);
+  risk.OnFilled(first, D("100.00"));
+
+  EXPECT_TRUE(risk.Check("ACCT", "IBM", D("1"), D("105.00")));
+  EXPECT_TRUE(risk.Check("ACCT", "IBM", D("1"), D("95.00")));
+  EXPECT_EQ(risk.Check("ACCT", "IBM", D("1"), D("105.01")).reject,
+            RiskReject::kPriceBand);
+  EXPECT_EQ(risk.Check("ACCT", "IBM", D("1"), D("94.99")).reject,
+            RiskReject::kPriceBand);
+
+  EXPECT_TRUE(risk.Check("ACCT", "MSFT", D("1"), D("500.00")));
+  auto unlisted = risk.Check("ACCT", "AAPL", D("1"), D("500.00"));
+  EXPECT_TRUE(unlisted);
+  EXPECT_EQ(unlisted.symbol, -1);
+}
+
+TEST(PreTradeRiskTest, OpenOrdersPerAccount) {
+  RiskLimits limits;
+  limits.max_open_orders = 2;
+  auto risk = Risk(limits);
+
+  auto first = risk.Check("A", "IBM", D("1"), D("1"));
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(risk.Check("A", "IBM", D("1"), D("1")));
+  EXPECT_EQ(risk.Check("A", "IBM", D("1"), D("1")).reject,
+            RiskReject::kOpenOrders);
+  EXPECT_TRUE(risk.Check("B", "IBM", D("1"), D("1")));
+
+  // A rejected order did not count; a filled one frees its place.
+  risk.OnFilled(first, D("1"));
+  EXPECT_TRUE(risk.Check("A", "IBM", D("1"), D("1")));
+  EXPECT_EQ(risk.Check("A", "IBM", D("1"), D("1")).reject,
+            RiskReject::kOpenOrders);
+}
+
+// Within one second at most MaxOrdersPerSecond orders per account pass.
+// Retried if the second turns over part way.
+TEST(PreTradeRiskTest, OrderRatePerAccountPerSecond) {
+  constexpr std::uint64_t kSecond = 1000000000;
+  for (int attempt = 0; attempt < 5; ++attempt) {
+    RiskLimits limits;
+    limits.max_orders_per_second = 3;
+    auto risk = Risk(limits);
+
+    auto started = common::TimeUtil::EpochNanos() / kSecond;
+    std::vector<RiskReject> rejects;
+    for (int order = 0; order < 4; ++order) {
+      rejects.push_back(risk.Check("A", "IBM", D("1"), D("1")).reject);
+    }
+    auto other = risk.Check("B", "IBM", D("1"), D("1")).reject;
+    if (common::TimeUtil::EpochNanos() / kSecond != started) {
+      continue;
+    }
+
+    EXPECT_EQ(rejects, (std::vector<RiskReject>{
+                           RiskReject::kNone, RiskReject::kNone,
+                           RiskReject::kNone, RiskReject::kOrderRate}));
+    EXPECT_EQ(other, RiskReject::kNone);
+    return;
+  }
+  FAIL() << "every attempt crossed a second boundary";
+}
+
+// Warm-up checks run the lookups but claim nothing and count nothing.
+TEST(PreTradeRiskTest, CheckWithoutCommitChangesNothing) {
+  RiskLimits limits;
+  limits.max_open_orders = 1;
+  auto risk = Risk(limits);
+
+  auto dry = risk.Check("A", "IBM", D("1"), D("1"), false);
+  EXPECT_TRUE(dry);
+  EXPECT_EQ(dry.account, nullptr);
+
+  ASSERT_TRUE(risk.Check("A", "IBM", D("1"), D("1")));
+  EXPECT_TRUE(risk.Check("A", "IBM", D("1"), D("1"), false));
+  EXPECT_EQ(risk.Check("A", "IBM", D("1"), D("1")).reject,
+            RiskReject::kOpenOrders);
+}
+
+// The table holds twice RiskMaxAccounts rounded up to a power of two;
+// accounts past that, or with names too long to store, are rejected.
+TEST(PreTradeRiskTest, AccountTableFull) {
+  RiskLimits limits;
+  limits.max_accounts = 2;
+  auto risk = Risk(limits);
+
+  for (int account = 0; account < 4; ++account) {
+    ASSERT_TRUE(risk.Check("ACCT" + std::to_string(account), "IBM", D("1"),
+                           D("1")))
+        << account;
+  }
+  EXPECT_EQ(risk.Check("ACCT4", "IBM", D("1"), D("1")).reject,
+            RiskReject::kAccountTable);
+  EXPECT_TRUE(risk.Check("ACCT0", "IBM", D("1"), D("1")));
+
+  EXPECT_EQ(risk.Check(std::string(33, 'x'), "IBM", D("1"), D("1")).reject,
+            RiskReject::kAccountTable);
+}
+
+// Workers racing to claim the same accounts end up sharing one slot each.
+TEST(PreTradeRiskTest, ConcurrentClaimsAgreeOnSlots) {
+  constexpr int kThreads = 8;
+  constexpr int kAccounts = 200;
+  RiskLimits limits;
+  limits.max_accounts = kAccounts;
+  auto risk = Risk(limits);
+
+  std::vector<std::vector<PreTradeRisk::Account*>> seen(kThreads);
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kThreads; ++thread) {
+    threads.emplace_back([&, thread]() {
+      while (!go.load()) {
+      }
+      for (int account = 0; account < kAccounts; ++account) {
+        auto result =
+            risk.Check("ACCT" + std::to_string(account), "IBM", D("1"), D("1"));
+        seen[thread].push_back(result.account);
+      }
+    });
+  }
+  go = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<PreTradeRisk::Account*> distinct;
+  for (int account = 0; account < kAccounts; ++account) {
+    auto* slot = seen[0][account];
+    ASSERT_NE(slot, nullptr);
+    for (int thread = 1; thread < kThreads; ++thread) {
+      EXPECT_EQ(seen[thread][account], slot) << account;
+    }
+    EXPECT_EQ(slot->open_orders.load(), kThreads);
+    EXPECT_EQ(std::string(slot->name.data(), slot->length),
+              "ACCT" + std::to_string(account));
+    distinct.push_back(slot);
+  }
+  std::sort(distinct.begin(), distinct.end());
+  EXPECT_EQ(std::unique(distinct.begin(), distinct.end()), distinct.end());
+}
+
+}  // namespace
@@ -0,0 +1,222 @@
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "common/priority_queue_list.h"
+#include "eventpp/eventqueue.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+// The event is the lane number; the argument tells events apart.
+struct LaneOfEvent {
+  template <typename QueuedEvent>
+  auto operator()(const QueuedEvent& queued) const -> std::size_t {
+    return static_cast<std::size_t>(queued.event);
+  }
+};
+
+template <std::size_t StarvationLimit>
+struct Policies {
+  template <typename Item>
+  using QueueList =
+      common::PriorityQueueList<Item, LaneOfEvent, 3, StarvationLimit>;
+};
+
+using Served = std::vector<std::pair<int, int>>;
+
+// An event queue over lanes 0 to 2 that records what it dispatches.
+template <std::size_t StarvationLimit = 64>
+class Lanes {
+ public:
+  using Queue = eventpp::EventQueue<int, void(int), Policies<StarvationLimit>>;
+
+  Lanes() {
+    for (int lane = 0; lane < 3; ++lane) {
+      queue.appendListener(
+          lane, [this, lane](int id) { served.emplace_back(lane, id); });
+    }
+  }
+
+  Queue queue;
+  Served served;
+};
+
+TEST(PriorityQueueListTest, ProcessServesLanesInOrderFifoWithin) {
+  Lanes<> lanes;
+  lanes.queue.enqueue(2, 1);
+  lanes.queue.enqueue(1, 2);
+  lanes.queue.enqueue(2, 3);
+  lanes.queue.enqueue(0, 4);
+  lanes.queue.enqueue(1, 5);
+  lanes.queue.enqueue(0, 6);
+
+  EXPECT_TRUE(lanes.queue.process());
+  EXPECT_EQ(lanes.served,
+            (Served{{0, 4}, {0, 6}, {1, 2}, {1, 5}, {2, 1}, {2, 3}}));
+  EXPECT_TRUE(lanes.queue.emptyQueue());
+}
+
+TEST(PriorityQueueListTest, ProcessOneTakesTheMostUrgent) {
+  Lanes<> lanes;
+  lanes.queue.enqueue(2, 1);
+  lanes.queue.enqueue(1, 2);
+  lanes.queue.enqueue(0, 3);
+
+  EXPECT_TRUE(lanes.queue.processOne());
+  EXPECT_EQ(lanes.served, (Served{{0, 3}}));
+
+  // Arrives behind the others but still goes first.
+  lanes.queue.enqueue(0, 4);
+  EXPECT_TRUE(lanes.queue.processOne());
+  EXPECT_TRUE(lanes.queue.processOne());
+  EXPECT_TRUE(lanes.queue.processOne());
+  EXPECT_FALSE(lanes.queue.processOne());
+  EXPECT_EQ(lanes.served, (Served{{0, 3}, {0, 4}, {1, 2}, {2, 1}}));
+}
+
+// A lane passed over StarvationLimit times in a row is served next, then
+// waits its turn again.
+TEST(PriorityQueueListTest, StarvedLaneIsHandedTheNextTurn) {
+  Lanes<2> lanes;
+  lanes.queue.enqueue(2, 1);
+  lanes.queue.enqueue(2, 2);
+  for (int id = 10; id < 16; ++id) {
+    lanes.queue.enqueue(0, id);
+  }
+
+  while (lanes.queue.processOne()) {
+  }
+  EXPECT_EQ(lanes.served, (Served{{0, 10},
+                                  {0, 11},
+                                  {2, 1},
+                                  {0, 12},
+                                  {0, 13},
+                                  {2, 2},
+                                  {0, 14},
+                                  {0, 15}}));
+}
+
+TEST(PriorityQueueListTest, StarvationCountsOnlyLanesHoldingItems) {
+  Lanes<2> lanes;
+  for (int id = 10; id < 13; ++id) {
+    lanes.queue.enqueue(0, id);
+  }
+  while (lanes.queue.processOne()) {
+  }
+
+  // Lane 2 was empty while lane 0 was served, so it has no claim yet.
+  lanes.queue.enqueue(0, 20);
+  lanes.queue.enqueue(2, 1);
+  lanes.queue.enqueue(0, 21);
+  lanes.queue.enqueue(0, 22);
+  while (lanes.queue.processOne()) {
+  }
+  EXPECT_EQ(lanes.served, (Served{{0, 10},
+                                  {0, 11},
+                                  {0, 12},
+                                  {0, 20},
+                                  {0, 21},
+                                  {2, 1},
+                                  {0, 22}}));
+}
+
+// Events left by processIf() are spliced back ahead of those enqueued
+// meanwhile, each in its own lane.
+TEST(PriorityQueueListTest, ProcessIfPutsLeftoversBackInFront) {
+  Lanes<> lanes;
+  lanes.queue.appendListener(0, [&](int id) {
+    if (id == 1) {
+      lanes.queue.enqueue(2, 30);
+      lanes.queue.enqueue(1, 31);
+    }
+  });
+  lanes.queue.enqueue(2, 10);
+  lanes.queue.enqueue(1, 11);
+  lanes.queue.enqueue(0, 1);
+
+  lanes.queue.processIf([](int id) { return id == 1; });
+  EXPECT_EQ(lanes.served, (Served{{0, 1}}));
+
+  lanes.served.clear();
+  lanes.queue.process();
+  EXPECT_EQ(lanes.served, (Served{{1, 11}, {1, 31}, {2, 10}, {2, 30}}));
+}
+
+// Items go back to the free list and are reused in whichever lane the next
+// event needs.
+TEST(PriorityQueueListTest, RecycledItemsMoveBetweenLanes) {
+  Lanes<> lanes;
+  for (int round = 0; round < 4; ++round) {
+    lanes.served.clear();
+    for (int id = 0; id < 6; ++id) {
+      lanes.queue.enqueue((id + round) % 3, id);
+    }
+    lanes.queue.process();
+    ASSERT_EQ(lanes.served.size(), 6U);
+    for (std::size_t index = 1; index < lanes.served.size(); ++index) {
+      EXPECT_LE(lanes.served[index - 1].first, lanes.served[index].first);
+    }
+  }
+}
+
+// The list on its own: anything classified past the last lane lands there,
+// and a splice to begin() goes ahead of the lane's items.
+struct FakeItem {
+  int lane{-1};
+  int id{0};
+
+  auto empty() const -> bool { return lane < 0; }
+  auto get() const -> int { return lane; }
+};
+
+struct LaneOfItem {
+  auto operator()(int lane) const -> std::size_t {
+    return static_cast<std::size_t>(lane);
+  }
+};
+
+using List = common::PriorityQueueList<FakeItem, LaneOfItem, 3>;
+
+auto Push(List& list, int lane, int id, bool front = false) -> void {
+  List one;
+  one.emplace_back() = FakeItem{lane, id};
+  auto pos = front ? std::as_const(list).begin() : std::as_const(list).end();
+  list.splice(pos, one, std::as_const(one).begin());
+}
+
+TEST(PriorityQueueListTest, SplicesIntoTheClassifiedLane) {
+  List list;
+  Push(list, 1, 1);
+  Push(list, 7, 2);
+  Push(list, 0, 3);
+  EXPECT_EQ(list.LaneSize(0), 1U);
+  EXPECT_EQ(list.LaneSize(1), 1U);
+  EXPECT_EQ(list.LaneSize(2), 1U);
+  EXPECT_EQ(list.size(), 3U);
+  EXPECT_EQ(list.front().id, 3);
+
+  Push(list, 0, 4, true);
+  Push(list, 0, 5);
+  std::vector<int> ids;
+  for (const auto& item : list) {
+    ids.push_back(item.id);
+  }
+  EXPECT_EQ(ids, (std::vector<int>{4, 3, 5, 1, 2}));
+}
+
+TEST(PriorityQueueListTest, SpliceAllKeepsLanesAndEmptiesTheSource) {
+  List list;
+  List other;
+  Push(list, 2, 1);
+  Push(other, 1, 2);
+  Push(other, 2, 3);
+
+  list.splice(std::as_const(list).end(), other);
+  EXPECT_TRUE(other.empty());
+  EXPECT_EQ(list.LaneSize(1), 1U);
+  EXPECT_EQ(list.LaneSize(2), 2U);
+  EXPECT_EQ(list.front().id, 2);
+}
+
+}  // namespace
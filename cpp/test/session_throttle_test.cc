@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <string>
+
+#include "common/session_throttle.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using common::ThrottleDecision;
+using Throttles = common::SessionThrottles<int>;
+
+constexpr std::uint64_t kSecond = 1000000000;
+
+const FIX::SessionID kSession("FIX.4.2", "CLIENT", "SERVER");
+
+auto Settings(const std::string& key, const std::string& value,
+              const std::string& action = "reject") -> FIX::SessionSettings {
+  FIX::Dictionary dictionary;
+  dictionary.setString(key, value);
+  dictionary.setString(Throttles::kThrottleAction, action);
+  FIX::SessionSettings settings;
+  settings.set(kSession, dictionary);
+  return settings;
+}
+
+auto Admit(Throttles& throttles, const std::string& msg_type,
+           std::uint64_t now) -> ThrottleDecision {
+  return throttles.Admit(kSession, msg_type, now, []() { return 0; });
+}
+
+TEST(SessionThrottleTest, MsgTypeRateLimitsOnlyThatType) {
+  auto throttles = Throttles::FromSettings(
+      Settings(Throttles::kThrottleMsgTypeRates, "D:2"));
+  auto now = kSecond;
+  EXPECT_EQ(Admit(throttles, "D", now), ThrottleDecision::kAdmit);
+  EXPECT_EQ(Admit(throttles, "D", now), ThrottleDecision::kAdmit);
+  EXPECT_EQ(Admit(throttles, "D", now), ThrottleDecision::kReject);
+  EXPECT_EQ(Admit(throttles, "F", now), ThrottleDecision::kAdmit);
+  EXPECT_EQ(Admit(throttles, "D", now + kSecond / 2), ThrottleDecision::kAdmit);
+}
+
+// A rate under one a second still holds a whole token, so it admits one
+// message every 1 / rate seconds rather than none at all.
+TEST(SessionThrottleTest, FractionalMsgTypeRateStillAdmits) {
+  auto throttles = Throttles::FromSettings(
+      Settings(Throttles::kThrottleMsgTypeRates, "D:0.5"));
+  auto now = kSecond;
+  EXPECT_EQ(Admit(throttles, "D", now), ThrottleDecision::kAdmit);
+  EXPECT_EQ(Admit(throttles, "D", now + kSecond), ThrottleDecision::kReject);
+  EXPECT_EQ(Admit(throttles, "D", now + 2 * kSecond),
+            ThrottleDecision::kAdmit);
+}
+
+TEST(SessionThrottleTest, QueuedMessagesAreReleasedWhenDue) {
+  auto throttles = Throttles::FromSettings(
+      Settings(Throttles::kThrottleRate, "10", "queue"));
+  auto now = kSecond;
+  for (int message = 0; message < 10; ++message) {
+    ASSERT_EQ(Admit(throttles, "D", now), ThrottleDecision::kAdmit);
+  }
+  EXPECT_EQ(Admit(throttles, "D", now), ThrottleDecision::kDeferred);
+
+  int released{0};
+  auto count = [&](int&) { ++released; };
+  EXPECT_EQ(throttles.Release(now, count), now + kSecond / 10);
+  EXPECT_EQ(released, 0);
+  EXPECT_EQ(throttles.Release(now + kSecond / 10, count), 0U);
+  EXPECT_EQ(released, 1);
+}
+
+TEST(SessionThrottleTest, RejectsRatesThatCannotRefill) {
+  for (const auto* rates : {"D:0", "D:-1", "D:abc", "D:", "D", "D:5x"}) {
+    EXPECT_THROW(Throttles::FromSettings(
+                     Settings(Throttles::kThrottleMsgTypeRates, rates)),
+                 FIX::ConfigError)
+        << rates;
+  }
+  EXPECT_THROW(
+      Throttles::FromSettings(Settings(Throttles::kThrottleRate, "0")),
+      FIX::ConfigError);
+}
+
+}  // namespace